@@ -0,0 +1,454 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * Throughput of the CRC kernels and the frame paths, swept over payload
+ * size and escape density. One CSV row per case on stdout:
+ *
+ *   benchmark,payload_bytes,escape_pct,iterations,ns_per_frame,mb_per_s
+ *
+ * mb_per_s counts payload bytes (10^6 per second). Frame cases whose
+ * encoded size would not fit the 16 bit buffer_index are left out.
+ * multi_decode hands the frame to BENCH_CHANNELS channels in turn, and
+ * parallel_decode decodes up to 8 MB of copies of it per call on every
+ * online CPU; both still report per frame.
+ *
+ * Usage: ahdlc_bench [--min-ms N] [--filter SUBSTRING]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../lib/inc/crc_16.h"
+#include "../lib/inc/frame_layer.h"
+#include "../lib/inc/multi_decoder.h"
+#include "../lib/inc/parallel_decoder.h"
+
+/* Enough for the largest payload with every byte escaped */
+#define BENCH_MAX_PAYLOAD (65536)
+#define BENCH_MAX_FRAME (2 * BENCH_MAX_PAYLOAD + 16)
+/* Copies of the frame back to back, for the capture and channel paths */
+#define BENCH_CAPTURE_BYTES (8u << 20)
+/* Channels the multi decoder cycles through, one input each per call */
+#define BENCH_CHANNELS (16)
+/* Scatter-gather cases split the payload into this many segments */
+#define BENCH_SEGMENTS (4)
+
+typedef struct {
+  const uint8_t *payload;
+  uint32_t payload_len;
+  const uint8_t *frame;    /* payload encoded as one frame */
+  uint32_t frame_len;
+  uint8_t *scratch;        /* BENCH_MAX_FRAME bytes */
+  const uint8_t *capture;  /* capture_frames copies of frame */
+  uint32_t capture_frames;
+  ahdlc_frame_encoder_t *enc;
+  ahdlc_frame_decoder_t *dec;
+  ahdlc_multi_decoder_t *multi;
+  uint32_t num_threads;    /* For the parallel decoder */
+}bench_input_t;
+
+typedef void (*bench_function)(bench_input_t *in, uint64_t iterations);
+
+typedef struct {
+  const char *name;
+  bench_function run;
+  uint8_t is_frame;        /* Limited to what one frame can hold */
+  uint8_t is_capture;      /* Decodes in->capture */
+}bench_case_t;
+
+/* Keeps results alive so the compiler cannot drop the work */
+static volatile uint32_t bench_sink;
+
+static void benchCrc16(bench_input_t *in, uint64_t iterations) {
+  uint64_t i;
+  for (i = 0; i < iterations; ++i) {
+    bench_sink += CRC16(0, in->payload, in->payload_len);
+  }
+}
+
+static void benchCrc16Sliced(bench_input_t *in, uint64_t iterations) {
+  uint64_t i;
+  for (i = 0; i < iterations; ++i) {
+    bench_sink += CRC16Sliced(0, in->payload, in->payload_len);
+  }
+}
+
+static void benchCrc16Folded(bench_input_t *in, uint64_t iterations) {
+  uint64_t i;
+  for (i = 0; i < iterations; ++i) {
+    bench_sink += CRC16Folded(0, in->payload, in->payload_len);
+  }
+}
+
+static void benchEncodeBuffer(bench_input_t *in, uint64_t iterations) {
+  uint64_t i;
+  for (i = 0; i < iterations; ++i) {
+    EncodeNewFrame(in->enc);
+    EncodeBuffer(in->enc, in->payload, in->payload_len);
+    bench_sink += in->enc->frame_info.buffer_index;
+  }
+}
+
+/* The payload as BENCH_SEGMENTS pieces, as a caller gathering it would */
+static void benchSplitPayload(const bench_input_t *in,
+                              ahdlc_segment_t *segments) {
+  uint32_t offset = 0;
+  uint32_t i;
+
+  for (i = 0; i < BENCH_SEGMENTS; ++i) {
+    uint32_t end = in->payload_len * (i + 1) / BENCH_SEGMENTS;
+    segments[i].base = in->payload + offset;
+    segments[i].len = end - offset;
+    offset = end;
+  }
+}
+
+static void benchEncodeSegments(bench_input_t *in, uint64_t iterations) {
+  ahdlc_segment_t segments[BENCH_SEGMENTS];
+  uint64_t i;
+
+  benchSplitPayload(in, segments);
+  for (i = 0; i < iterations; ++i) {
+    EncodeNewFrame(in->enc);
+    EncodeSegments(in->enc, segments, BENCH_SEGMENTS);
+    bench_sink += in->enc->frame_info.buffer_index;
+  }
+}
+
+/* Builds the iovecs only, the payload is not copied or sent */
+static void benchEncodeSegmentsIovec(bench_input_t *in, uint64_t iterations) {
+  ahdlc_segment_t segments[BENCH_SEGMENTS];
+  static ahdlc_segment_t iov[2 * BENCH_MAX_PAYLOAD + 8];
+  uint32_t num_iov;
+  uint64_t i;
+
+  benchSplitPayload(in, segments);
+  for (i = 0; i < iterations; ++i) {
+    EncodeNewFrame(in->enc);
+    EncodeSegmentsIovec(in->enc, segments, BENCH_SEGMENTS, iov,
+                        sizeof(iov) / sizeof(iov[0]), &num_iov);
+    bench_sink += num_iov;
+  }
+}
+
+static void benchEncodeByte(bench_input_t *in, uint64_t iterations) {
+  uint64_t i;
+  uint32_t j;
+  for (i = 0; i < iterations; ++i) {
+    EncodeNewFrame(in->enc);
+    for (j = 0; j < in->payload_len; ++j) {
+      EncodeAddByteToFrameBufferCRC16(in->enc, in->payload[j]);
+    }
+    EncodeFinalize(in->enc);
+    bench_sink += in->enc->frame_info.buffer_index;
+  }
+}
+
+static void benchDecodeFrameByte(bench_input_t *in, uint64_t iterations) {
+  uint64_t i;
+  uint32_t j;
+  for (i = 0; i < iterations; ++i) {
+    for (j = 0; j < in->frame_len; ++j) {
+      bench_sink += DecodeFrameByte(in->dec, in->frame[j]);
+    }
+  }
+}
+
+static void benchDecodeFrameByteCrc16(bench_input_t *in,
+                                      uint64_t iterations) {
+  uint64_t i;
+  uint32_t j;
+  for (i = 0; i < iterations; ++i) {
+    for (j = 0; j < in->frame_len; ++j) {
+      bench_sink += DecodeFrameByteCRC16(in->dec, in->frame[j]);
+    }
+  }
+}
+
+static void benchDecoderBuffer(bench_input_t *in, uint64_t iterations) {
+  uint64_t i;
+  for (i = 0; i < iterations; ++i) {
+    bench_sink += DecoderBuffer(in->dec, (uint8_t*)in->frame, in->frame_len);
+  }
+}
+
+static void benchDecoderBufferPerFrameCrc(bench_input_t *in,
+                                          uint64_t iterations) {
+  AhdlcDecoderSetCrcMode(in->dec, DECODE_CRC_PER_FRAME);
+  benchDecoderBuffer(in, iterations);
+  AhdlcDecoderSetCrcMode(in->dec, DECODE_CRC_PER_BYTE);
+}
+
+static void benchDecoderBufferNext(bench_input_t *in, uint64_t iterations) {
+  ahdlc_decoded_frame_t frame;
+  uint64_t i;
+  for (i = 0; i < iterations; ++i) {
+    uint32_t offset = 0;
+    while (DecoderBufferNext(in->dec, in->frame, in->frame_len, &offset,
+                             &frame) == AHDLC_COMPLETE) {
+      bench_sink += frame.payload_len;
+    }
+  }
+}
+
+/* Includes restoring the input, which decoding in place overwrites */
+static void benchDecodeInPlace(bench_input_t *in, uint64_t iterations) {
+  ahdlc_decoded_frame_t frame;
+  uint32_t num_frames;
+  uint32_t consumed;
+  uint64_t i;
+  for (i = 0; i < iterations; ++i) {
+    memcpy(in->scratch, in->frame, in->frame_len);
+    DecodeInPlace(in->dec, in->scratch, in->frame_len, &frame, 1,
+                  &num_frames, &consumed);
+    bench_sink += num_frames;
+  }
+}
+
+static void benchMultiFrame(void *ctx, uint32_t channel,
+                            const ahdlc_decoded_frame_t *frame) {
+  (void)ctx;
+  bench_sink += channel + frame->payload_len;
+}
+
+/* One frame per channel in turn, BENCH_CHANNELS inputs per call */
+static void benchMultiDecode(bench_input_t *in, uint64_t iterations) {
+  ahdlc_channel_input_t inputs[BENCH_CHANNELS];
+  uint64_t i = 0;
+  uint32_t n;
+
+  while (i < iterations) {
+    for (n = 0; n < BENCH_CHANNELS && i < iterations; ++n, ++i) {
+      inputs[n].channel = n;
+      inputs[n].data = in->frame;
+      inputs[n].len = in->frame_len;
+    }
+    bench_sink += AhdlcMultiDecode(in->multi, inputs, n);
+  }
+}
+
+/* Captures of up to capture_frames frames, one call each */
+static void benchParallelDecode(bench_input_t *in, uint64_t iterations) {
+  ahdlc_parallel_config_t config = {in->num_threads, 0,
+      BENCH_MAX_PAYLOAD + 16, CRC16};
+  ahdlc_parallel_result_t result;
+  uint64_t left = iterations;
+
+  while (left) {
+    uint32_t frames = (left < in->capture_frames) ? (uint32_t)left :
+        in->capture_frames;
+    if (AhdlcParallelDecode(in->capture, (size_t)frames * in->frame_len,
+                            &config, &result) == AHDLC_OK) {
+      bench_sink += (uint32_t)result.num_frames;
+      AhdlcParallelResultFree(&result);
+    }
+    left -= frames;
+  }
+}
+
+static const bench_case_t bench_cases[] = {
+  {"crc16", benchCrc16, 0, 0},
+  {"crc16_sliced", benchCrc16Sliced, 0, 0},
+  {"crc16_folded", benchCrc16Folded, 0, 0},
+  {"encode_buffer", benchEncodeBuffer, 1, 0},
+  {"encode_segments", benchEncodeSegments, 1, 0},
+  {"encode_segments_iovec", benchEncodeSegmentsIovec, 1, 0},
+  {"encode_byte_crc16", benchEncodeByte, 1, 0},
+  {"decode_frame_byte", benchDecodeFrameByte, 1, 0},
+  {"decode_frame_byte_crc16", benchDecodeFrameByteCrc16, 1, 0},
+  {"decoder_buffer", benchDecoderBuffer, 1, 0},
+  {"decoder_buffer_per_frame_crc", benchDecoderBufferPerFrameCrc, 1, 0},
+  {"decoder_buffer_next", benchDecoderBufferNext, 1, 0},
+  {"decode_in_place", benchDecodeInPlace, 1, 0},
+  {"multi_decode", benchMultiDecode, 1, 0},
+  {"parallel_decode", benchParallelDecode, 1, 1},
+};
+
+static const uint32_t bench_sizes[] = {16, 64, 256, 1024, 4096, 16384,
+                                       32768, 65536};
+static const uint32_t bench_densities[] = {0, 1, 50, 100};
+
+static double benchNow(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Fixed seed, so runs compare across builds */
+static uint32_t benchRandom(uint32_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+/* density percent of the bytes are frame_marker or escape_marker */
+static void benchFillPayload(uint8_t *payload, uint32_t len,
+                             uint32_t density) {
+  uint32_t state = 0x2545F491;
+  uint32_t i;
+
+  for (i = 0; i < len; ++i) {
+    if (benchRandom(&state) % 100 < density) {
+      payload[i] = (i & 1) ? escape_marker : frame_marker;
+    } else {
+      do {
+        payload[i] = (uint8_t)benchRandom(&state);
+      } while (payload[i] == frame_marker || payload[i] == escape_marker);
+    }
+  }
+}
+
+/* Guards against timing a path that fails */
+static int benchFrameDecodes(bench_input_t *in) {
+  ahdlc_decoded_frame_t frame;
+  uint32_t offset = 0;
+
+  return DecoderBufferNext(in->dec, in->frame, in->frame_len, &offset,
+                           &frame) == AHDLC_COMPLETE &&
+         frame.payload_len == in->payload_len &&
+         !memcmp(frame.payload, in->payload, in->payload_len);
+}
+
+/* Doubles the iteration count until a run takes at least min_seconds */
+static void benchRun(const bench_case_t *bench, bench_input_t *in,
+                     uint32_t density, double min_seconds) {
+  uint64_t iterations = 1;
+  double elapsed;
+
+  for (;;) {
+    double start = benchNow();
+    bench->run(in, iterations);
+    elapsed = benchNow() - start;
+    if (elapsed >= min_seconds) {
+      break;
+    }
+    iterations *= 2;
+  }
+
+  printf("%s,%u,%u,%llu,%.1f,%.1f\n", bench->name, in->payload_len, density,
+         (unsigned long long)iterations, elapsed * 1e9 / iterations,
+         in->payload_len * (double)iterations / elapsed / 1e6);
+  fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+  static uint8_t payload[BENCH_MAX_PAYLOAD];
+  static uint8_t frame[BENCH_MAX_FRAME];
+  static uint8_t scratch[BENCH_MAX_FRAME];
+  static uint8_t pdu[BENCH_MAX_PAYLOAD + 16];
+  static uint8_t capture[BENCH_CAPTURE_BYTES + BENCH_MAX_FRAME];
+  const uint32_t max_pdu = UINT16_MAX - AHDLC_MULTI_SLOT_SIZE(0);
+  uint32_t multi_storage_len = AHDLC_MULTI_DECODER_STORAGE_SIZE(
+      BENCH_CHANNELS, max_pdu);
+  void *multi_storage = malloc(multi_storage_len);
+  ahdlc_multi_decoder_t multi;
+  ahdlc_frame_encoder_t enc;
+  ahdlc_frame_decoder_t dec;
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  bench_input_t in;
+  const char *filter = NULL;
+  double min_seconds = 0.2;
+  uint32_t s, d, b;
+  int i;
+
+  for (i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--min-ms") && i + 1 < argc) {
+      min_seconds = atoi(argv[++i]) / 1000.0;
+    } else if (!strcmp(argv[i], "--filter") && i + 1 < argc) {
+      filter = argv[++i];
+    } else {
+      fprintf(stderr, "usage: %s [--min-ms N] [--filter SUBSTRING]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  enc.frame_buffer = frame;
+  enc.buffer_len = sizeof(frame);
+  ahdlcEncoderInit(&enc, CRC16);
+  dec.pdu_buffer = pdu;
+  dec.buffer_len = sizeof(pdu);
+  AhdlcDecoderInit(&dec, CRC16, NULL);
+  if (!multi_storage || AhdlcMultiDecoderInit(&multi, BENCH_CHANNELS,
+      max_pdu, multi_storage, multi_storage_len, CRC16, benchMultiFrame,
+      NULL) != AHDLC_OK) {
+    fprintf(stderr, "multi decoder init failed\n");
+    return 1;
+  }
+
+  in.payload = payload;
+  in.frame = frame;
+  in.scratch = scratch;
+  in.enc = &enc;
+  in.dec = &dec;
+  in.capture = capture;
+  in.multi = &multi;
+  in.num_threads = (cpus > 0) ? (uint32_t)cpus : 1;
+
+  printf("benchmark,payload_bytes,escape_pct,iterations,ns_per_frame,"
+         "mb_per_s\n");
+  for (b = 0; b < sizeof(bench_cases) / sizeof(bench_cases[0]); ++b) {
+    const bench_case_t *bench = &bench_cases[b];
+
+    if (filter && !strstr(bench->name, filter)) {
+      continue;
+    }
+    for (s = 0; s < sizeof(bench_sizes) / sizeof(bench_sizes[0]); ++s) {
+      for (d = 0; d < sizeof(bench_densities) / sizeof(bench_densities[0]);
+           ++d) {
+        uint32_t len = bench_sizes[s];
+        uint32_t specials = 0;
+        uint32_t j;
+
+        benchFillPayload(payload, len, bench_densities[d]);
+        for (j = 0; j < len; ++j) {
+          specials += (payload[j] == frame_marker ||
+                       payload[j] == escape_marker);
+        }
+        /* Markers plus header and CRC, every one escaped at worst */
+        if (bench->is_frame && 2 + 2 * 4 + len + specials > UINT16_MAX) {
+          continue;
+        }
+
+        in.payload_len = len;
+        EncodeNewFrame(&enc);
+        EncodeBuffer(&enc, payload, len);
+        in.frame_len = enc.frame_info.buffer_index;
+        if (bench->is_frame && !benchFrameDecodes(&in)) {
+          fprintf(stderr, "%s: %u byte frame does not decode\n",
+                  bench->name, len);
+          return 1;
+        }
+        if (bench->is_capture) {
+          in.capture_frames = 0;
+          do {
+            memcpy(&capture[in.capture_frames++ * in.frame_len], frame,
+                   in.frame_len);
+          } while (in.capture_frames * in.frame_len < BENCH_CAPTURE_BYTES);
+        }
+        benchRun(bench, &in, bench_densities[d], min_seconds);
+      }
+    }
+  }
+
+  free(multi_storage);
+  return 0;
+}
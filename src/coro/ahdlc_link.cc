@@ -0,0 +1,372 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "ahdlc_link.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace ahdlc {
+
+namespace {
+
+/* Markers plus every other byte escaped: flags, sequence, payload, CRC */
+size_t EncodedSizeMax(size_t payload_len) {
+  return 2 + 2 * (2 + payload_len + 2);
+}
+
+/* frame_info.buffer_index is 16 bits, no frame may run past it */
+constexpr size_t kMaxFrameBytes = UINT16_MAX;
+
+}  // namespace
+
+EventLoop::EventLoop()
+    : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)), num_events_(0) {}
+
+EventLoop::~EventLoop() {
+  if (epoll_fd_ >= 0) {
+    close(epoll_fd_);
+  }
+}
+
+bool EventLoop::Watch(int fd, Link *link) {
+  epoll_event event = {};
+
+  /* Edge triggered, links read and write until EAGAIN */
+  event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  event.data.ptr = link;
+  return epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+void EventLoop::Unwatch(int fd, Link *link) {
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+  /* The link may be going away with its events not handled yet */
+  for (int i = 0; i < num_events_; ++i) {
+    if (events_[i].data.ptr == link) {
+      events_[i].data.ptr = nullptr;
+    }
+  }
+  flush_.erase(std::remove(flush_.begin(), flush_.end(), link), flush_.end());
+}
+
+void EventLoop::Schedule(std::coroutine_handle<> handle) {
+  ready_.push_back(handle);
+}
+
+void EventLoop::ScheduleFlush(Link *link) {
+  flush_.push_back(link);
+}
+
+int EventLoop::RunOnce(int timeout_ms) {
+  int resumed = 0;
+
+  num_events_ = epoll_wait(epoll_fd_, events_, kMaxEvents,
+                           ready_.empty() ? timeout_ms : 0);
+  if (num_events_ < 0) {
+    num_events_ = 0;
+    if (errno != EINTR) {
+      return -1;
+    }
+  }
+  for (int i = 0; i < num_events_; ++i) {
+    Link *link = static_cast<Link*>(events_[i].data.ptr);
+    if (link) {
+      link->OnEvents(events_[i].events);
+    }
+  }
+  num_events_ = 0;
+
+  /* Only what is ready now, coroutines that yield again wait a turn */
+  for (size_t n = ready_.size(); n; --n) {
+    std::coroutine_handle<> handle = ready_.front();
+    ready_.pop_front();
+    handle.resume();
+    ++resumed;
+  }
+
+  /* One write() for everything each link queued this turn */
+  while (!flush_.empty()) {
+    Link *link = flush_.back();
+    flush_.pop_back();
+    link->flush_pending_ = false;
+    link->Flush();
+  }
+
+  return resumed;
+}
+
+Link::Link(EventLoop *loop, int fd, const LinkConfig &config)
+    : loop_(loop), fd_(fd), config_(config),
+      rx_(std::min(config.rx_buffer_size, kMaxFrameBytes)),
+      frames_(config.max_batch_frames),
+      tx_(config.tx_buffer_size) {
+  decoder_.pdu_buffer = rx_.data();
+  decoder_.buffer_len = 0;  /* DecodeInPlace() decodes into rx_ itself */
+  AhdlcDecoderInit(&decoder_, config_.crc_cb, nullptr);
+  AhdlcDecoderSetCrcMode(&decoder_, DECODE_CRC_PER_FRAME);
+
+  encoder_.frame_buffer = tx_.data();
+  encoder_.buffer_len = static_cast<uint32_t>(
+      std::min(tx_.size(), kMaxFrameBytes));
+  ahdlcEncoderInit(&encoder_, config_.crc_cb);
+
+  watched_ = !rx_.empty() && !frames_.empty() && loop_->Watch(fd_, this);
+  closed_ = !watched_;
+}
+
+Link::~Link() {
+  Close();
+}
+
+void Link::Close() {
+  if (watched_) {
+    loop_->Unwatch(fd_, this);
+    watched_ = false;
+  }
+  closed_ = true;
+  flush_pending_ = false;
+
+  if (reader_) {
+    loop_->Schedule(reader_);
+    reader_ = nullptr;
+  }
+  if (sender_) {
+    sender_->result_ = AHDLC_ERROR;
+    loop_->Schedule(sender_->handle_);
+    sender_ = nullptr;
+  }
+}
+
+void Link::OnEvents(uint32_t events) {
+  if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+    readable_ = true;
+  }
+  if (events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+    writable_ = true;
+    Flush();
+  }
+
+  /* Taken off the link first, so a Close() on the way does not wake them */
+  if (sender_) {
+    SendAwaiter *sender = sender_;
+    sender_ = nullptr;
+    sender->result_ = Queue(sender->payload_);
+    if (sender->result_ == AHDLC_BUFFER_TOO_SMALL) {
+      sender_ = sender;
+    } else {
+      loop_->Schedule(sender->handle_);
+    }
+  }
+  if (reader_) {
+    std::coroutine_handle<> reader = reader_;
+    reader_ = nullptr;
+    if (PollFrame() || closed_) {
+      loop_->Schedule(reader);
+    } else {
+      reader_ = reader;
+    }
+  }
+}
+
+void Link::CompactRx() {
+  if (rx_consumed_) {
+    memmove(rx_.data(), rx_.data() + rx_consumed_, rx_len_ - rx_consumed_);
+    rx_len_ -= rx_consumed_;
+    rx_consumed_ = 0;
+  }
+}
+
+/* Decodes what has not been yet, true if that gave frames */
+bool Link::Decode() {
+  uint32_t consumed;
+
+  CompactRx();
+  if (!rx_pending_) {
+    return false;
+  }
+
+  DecodeInPlace(&decoder_, rx_.data(), static_cast<uint32_t>(rx_len_),
+                frames_.data(), static_cast<uint32_t>(frames_.size()),
+                &num_frames_, &consumed);
+  next_frame_ = 0;
+  rx_consumed_ = consumed;
+  /* A full batch may have stopped short of more frames */
+  rx_pending_ = (num_frames_ == frames_.size());
+
+  if (!num_frames_ && !consumed && rx_len_ == rx_.size()) {
+    /* One frame fills the buffer and still does not end, drop it */
+    stats_.rx_dropped_bytes += rx_len_;
+    rx_len_ = 0;
+  }
+
+  return num_frames_ != 0;
+}
+
+/* Reads until EAGAIN or a full buffer, true if anything came in */
+bool Link::Fill() {
+  bool got = false;
+
+  CompactRx();
+  while (readable_ && !closed_ && rx_len_ < rx_.size()) {
+    ssize_t n = read(fd_, rx_.data() + rx_len_, rx_.size() - rx_len_);
+
+    ++stats_.read_calls;
+    if (n > 0) {
+      rx_len_ += static_cast<size_t>(n);
+      stats_.bytes_read += static_cast<uint64_t>(n);
+      rx_pending_ = true;
+      got = true;
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      readable_ = false;
+    } else {
+      /* End of file, or EIO from a pty whose other side went away */
+      Close();
+    }
+  }
+
+  return got;
+}
+
+/* True when frames_[next_frame_] is there to hand out */
+bool Link::PollFrame() {
+  if (next_frame_ < num_frames_) {
+    return true;
+  }
+  num_frames_ = next_frame_ = 0;
+
+  do {
+    if (Decode()) {
+      return true;
+    }
+  } while (Fill());
+
+  return false;
+}
+
+bool Link::FrameAwaiter::await_ready() {
+  /* Past a full batch, other links and coroutines get a turn first */
+  if (link_->burst_ >= link_->frames_.size()) {
+    return false;
+  }
+  return link_->PollFrame() || link_->closed_;
+}
+
+void Link::FrameAwaiter::await_suspend(std::coroutine_handle<> handle) {
+  link_->burst_ = 0;
+  if (link_->PollFrame() || link_->closed_) {
+    link_->loop_->Schedule(handle);
+  } else {
+    link_->reader_ = handle;
+  }
+}
+
+Frame Link::FrameAwaiter::await_resume() {
+  Frame frame = {};
+
+  if (!link_->PollFrame()) {
+    frame.status = AHDLC_ERROR;
+    return frame;
+  }
+
+  const ahdlc_decoded_frame_t &decoded = link_->frames_[link_->next_frame_++];
+  ++link_->burst_;
+  ++link_->stats_.frames_received;
+  frame.status = AHDLC_COMPLETE;
+  frame.payload = std::span<const uint8_t>(decoded.payload,
+                                           decoded.payload_len);
+  frame.control_bits = decoded.control_bits;
+  frame.sequence = decoded.sequence;
+  frame.ack_num = decoded.ack_num;
+  return frame;
+}
+
+/* Encodes a frame after those queued, AHDLC_BUFFER_TOO_SMALL to wait */
+ahdlc_op_return Link::Queue(std::span<const uint8_t> payload) {
+  size_t needed = EncodedSizeMax(payload.size());
+
+  if (closed_ || needed > tx_.size() || needed > kMaxFrameBytes) {
+    return AHDLC_ERROR;
+  }
+  if (tx_.size() - tx_len_ < needed) {
+    Flush();
+    if (closed_) {
+      return AHDLC_ERROR;
+    }
+    if (tx_head_) {
+      memmove(tx_.data(), tx_.data() + tx_head_, tx_len_ - tx_head_);
+      tx_len_ -= tx_head_;
+      tx_head_ = 0;
+    }
+    if (tx_.size() - tx_len_ < needed) {
+      return AHDLC_BUFFER_TOO_SMALL;
+    }
+  }
+
+  encoder_.frame_buffer = tx_.data() + tx_len_;
+  encoder_.buffer_len = static_cast<uint32_t>(
+      std::min(tx_.size() - tx_len_, kMaxFrameBytes));
+  if (EncodeNewFrame(&encoder_) != AHDLC_OK ||
+      EncodeBuffer(&encoder_, payload.data(),
+                   static_cast<uint32_t>(payload.size())) != AHDLC_OK) {
+    return AHDLC_ERROR;
+  }
+  tx_len_ += encoder_.frame_info.buffer_index;
+  ++stats_.frames_sent;
+
+  if (!flush_pending_) {
+    flush_pending_ = true;
+    loop_->ScheduleFlush(this);
+  }
+  return AHDLC_OK;
+}
+
+void Link::Flush() {
+  while (writable_ && !closed_ && tx_head_ < tx_len_) {
+    ssize_t n = write(fd_, tx_.data() + tx_head_, tx_len_ - tx_head_);
+
+    ++stats_.write_calls;
+    if (n > 0) {
+      tx_head_ += static_cast<size_t>(n);
+      stats_.bytes_written += static_cast<uint64_t>(n);
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      writable_ = false;
+    } else {
+      Close();
+    }
+  }
+
+  if (tx_head_ == tx_len_) {
+    tx_head_ = tx_len_ = 0;
+  }
+}
+
+bool Link::SendAwaiter::await_ready() {
+  result_ = link_->Queue(payload_);
+  return result_ != AHDLC_BUFFER_TOO_SMALL;
+}
+
+void Link::SendAwaiter::await_suspend(std::coroutine_handle<> handle) {
+  handle_ = handle;
+  link_->sender_ = this;
+}
+
+}  // namespace ahdlc
@@ -0,0 +1,229 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef CORO_AHDLC_LINK_H_
+#define CORO_AHDLC_LINK_H_
+
+/*
+ * C++20 coroutine layer over the frame encoder and decoder for Linux file
+ * descriptors: serial ttys, ptys and stream sockets. One EventLoop thread
+ * serves any number of links:
+ *
+ *   ahdlc::Task Echo(ahdlc::Link *link) {
+ *     for (;;) {
+ *       ahdlc::Frame frame = co_await link->NextFrame();
+ *       if (frame.status != AHDLC_COMPLETE) break;
+ *       co_await link->Send(frame.payload);
+ *     }
+ *   }
+ *
+ * A link reads whatever the fd has in one batch, decodes every frame in it
+ * in place with DecodeInPlace() and hands the frames out one per
+ * NextFrame() without suspending, so a payload is never copied between the
+ * fd and the coroutine. Frames sent while the loop runs ready coroutines
+ * are encoded back to back and go out in one write() per link per turn.
+ */
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <span>
+#include <vector>
+
+#include <sys/epoll.h>
+
+#include "../lib/inc/crc_16.h"
+#include "../lib/inc/frame_layer.h"
+
+namespace ahdlc {
+
+/* Coroutine that starts at once and frees itself when it returns */
+struct Task {
+  struct promise_type {
+    Task get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+class Link;
+
+/* Single threaded epoll reactor, links and their coroutines live on it */
+class EventLoop {
+ public:
+  EventLoop();
+  ~EventLoop();
+  EventLoop(const EventLoop&) = delete;
+  EventLoop& operator=(const EventLoop&) = delete;
+
+  bool ok() const { return epoll_fd_ >= 0; }
+
+  /*
+   * Waits up to timeout_ms for fd events, without waiting while coroutines
+   * are ready to run, then runs the ready coroutines and flushes what they
+   * sent. Returns the number of coroutines resumed, -1 on epoll failure.
+   */
+  int RunOnce(int timeout_ms);
+
+ private:
+  friend class Link;
+
+  static constexpr int kMaxEvents = 64;
+
+  bool Watch(int fd, Link *link);
+  void Unwatch(int fd, Link *link);
+  void Schedule(std::coroutine_handle<> handle);
+  void ScheduleFlush(Link *link);
+
+  int epoll_fd_;
+  std::deque<std::coroutine_handle<>> ready_;
+  std::vector<Link*> flush_;
+  epoll_event events_[kMaxEvents];
+  int num_events_;
+};
+
+struct LinkConfig {
+  crc_callback crc_cb = CRC16;
+  /* Largest read, and largest frame, at most UINT16_MAX bytes */
+  size_t rx_buffer_size = UINT16_MAX;
+  size_t tx_buffer_size = 64 * 1024;  /* Frames queued for one write() */
+  /* Frames decoded per pass, and handed out before other links get a turn */
+  uint32_t max_batch_frames = 64;
+};
+
+/* Counted per link, e.g. read_calls / frames_received for syscall cost */
+struct LinkStats {
+  uint64_t read_calls = 0;
+  uint64_t write_calls = 0;
+  uint64_t bytes_read = 0;
+  uint64_t bytes_written = 0;
+  uint64_t frames_received = 0;
+  uint64_t frames_sent = 0;
+  uint64_t rx_dropped_bytes = 0;  /* Frames too large for the read buffer */
+};
+
+struct Frame {
+  ahdlc_op_return status;  /* AHDLC_COMPLETE, or AHDLC_ERROR once closed */
+  /* Points into the read buffer, valid until the next NextFrame() */
+  std::span<const uint8_t> payload;
+  frame_control_field_t control_bits;
+  uint8_t sequence;
+  uint8_t ack_num;
+};
+
+/*
+ * Frames over a nonblocking fd, which stays owned by the caller. One
+ * coroutine at a time may wait in NextFrame() and one in Send(). A link must
+ * outlive the coroutines awaiting it; Close() wakes them with AHDLC_ERROR.
+ */
+class Link {
+ public:
+  Link(EventLoop *loop, int fd, const LinkConfig &config = LinkConfig());
+  ~Link();
+  Link(const Link&) = delete;
+  Link& operator=(const Link&) = delete;
+
+  bool ok() const { return watched_; }
+
+  class FrameAwaiter {
+   public:
+    explicit FrameAwaiter(Link *link) : link_(link) {}
+    bool await_ready();
+    void await_suspend(std::coroutine_handle<> handle);
+    Frame await_resume();
+
+   private:
+    Link *link_;
+  };
+
+  class SendAwaiter {
+   public:
+    SendAwaiter(Link *link, std::span<const uint8_t> payload)
+        : link_(link), payload_(payload), result_(AHDLC_ERROR) {}
+    bool await_ready();
+    void await_suspend(std::coroutine_handle<> handle);
+    /*
+     * AHDLC_OK once queued, AHDLC_ERROR if closed or if the frame could
+     * encode to more than the write buffer or UINT16_MAX bytes
+     */
+    ahdlc_op_return await_resume() { return result_; }
+
+   private:
+    friend class Link;
+    Link *link_;
+    std::span<const uint8_t> payload_;
+    ahdlc_op_return result_;
+    std::coroutine_handle<> handle_;
+  };
+
+  /* The next good frame, as soon as one has been read */
+  FrameAwaiter NextFrame() { return FrameAwaiter(this); }
+  /* Encodes payload into the write buffer, waiting for room if need be */
+  SendAwaiter Send(std::span<const uint8_t> payload) {
+    return SendAwaiter(this, payload);
+  }
+
+  /* Stops watching the fd and wakes any waiter with AHDLC_ERROR */
+  void Close();
+
+  const LinkStats &stats() const { return stats_; }
+  const ahdlc_decoder_stats &decoder_stats() const { return decoder_.stats; }
+
+ private:
+  friend class EventLoop;
+
+  void OnEvents(uint32_t events);
+  bool PollFrame();
+  bool Decode();
+  bool Fill();
+  void CompactRx();
+  ahdlc_op_return Queue(std::span<const uint8_t> payload);
+  void Flush();
+
+  EventLoop *loop_;
+  int fd_;
+  LinkConfig config_;
+  LinkStats stats_;
+  bool watched_ = false;
+  bool closed_ = false;
+  bool readable_ = true;   /* Until read() says EAGAIN */
+  bool writable_ = true;   /* Until write() says EAGAIN */
+  bool flush_pending_ = false;
+
+  ahdlc_frame_decoder_t decoder_;
+  std::vector<uint8_t> rx_;
+  size_t rx_len_ = 0;
+  size_t rx_consumed_ = 0;   /* Bytes the frames handed out came from */
+  bool rx_pending_ = false;  /* Bytes not run through the decoder yet */
+  std::vector<ahdlc_decoded_frame_t> frames_;
+  uint32_t num_frames_ = 0;
+  uint32_t next_frame_ = 0;
+  uint32_t burst_ = 0;       /* Frames handed out without suspending */
+  std::coroutine_handle<> reader_;
+
+  ahdlc_frame_encoder_t encoder_;
+  std::vector<uint8_t> tx_;
+  size_t tx_head_ = 0;       /* tx_[tx_head_, tx_len_) is still to send */
+  size_t tx_len_ = 0;
+  SendAwaiter *sender_ = nullptr;
+};
+
+}  // namespace ahdlc
+
+#endif /* CORO_AHDLC_LINK_H_ */
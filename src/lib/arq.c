@@ -0,0 +1,235 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "inc/arq.h"
+
+#include <string.h>
+
+#include "inc/frame_layer.h"
+
+/* Slot of a sequence number; windows divide 256, so this survives wrap */
+static uint32_t arqSlot(const ahdlc_arq_t *handle, uint8_t sequence) {
+  return sequence & (handle->config.window - 1);
+}
+
+ahdlc_op_return AhdlcArqInit(ahdlc_arq_t *handle,
+    const ahdlc_arq_config_t *config, uint8_t *storage, uint32_t storage_len) {
+  uint32_t window = config->window;
+
+  if (!window || window > AHDLC_ARQ_MAX_WINDOW || (window & (window - 1)) ||
+      !config->max_payload || config->max_payload > AHDLC_ARQ_MAX_PAYLOAD ||
+      config->max_retries > UINT8_MAX || !config->crc_cb ||
+      !config->send_cb || !config->deliver_cb || !config->clock_cb) {
+    return AHDLC_ERROR;
+  }
+  if (storage_len < AHDLC_ARQ_STORAGE_SIZE(window, config->max_payload)) {
+    return AHDLC_BUFFER_TOO_SMALL;
+  }
+
+  memset(handle, 0, sizeof(*handle));
+  handle->config = *config;
+  handle->tx_payloads = storage;
+  handle->rx_payloads = &storage[window * config->max_payload];
+
+  handle->encoder.frame_buffer = &storage[2 * window * config->max_payload];
+  handle->encoder.buffer_len = AHDLC_ARQ_ENCODED_SIZE(config->max_payload);
+  ahdlcEncoderInit(&handle->encoder, config->crc_cb);
+  return AhdlcEncoderSetSink(&handle->encoder, ENCODE_SEND_FRAME_TO_CALLBACK,
+                             config->send_cb, config->ctx);
+}
+
+uint32_t AhdlcArqInFlight(const ahdlc_arq_t *handle) {
+  return (uint8_t)(handle->tx_next - handle->tx_base);
+}
+
+/* Encodes and sends the frame held for sequence */
+static ahdlc_op_return arqTransmit(ahdlc_arq_t *handle, uint8_t sequence) {
+  uint32_t slot = arqSlot(handle, sequence);
+  ahdlc_frame_encoder_t *enc = &handle->encoder;
+
+  enc->frame_info.control_bits.value = 0;
+  enc->frame_info.control_bits.bit.ack_requested = AHDLC_TRUE;
+  enc->frame_info.sequence = sequence;
+  handle->tx_sent_ms[slot] = handle->config.clock_cb(handle->config.ctx);
+  ++handle->stats.frames_sent;
+
+  EncodeNewFrame(enc);
+  return EncodeBuffer(enc,
+      &handle->tx_payloads[slot * handle->config.max_payload],
+      handle->tx_len[slot]);
+}
+
+/* Acknowledges everything before rx_next, plus the frames held after it */
+static ahdlc_op_return arqSendAck(ahdlc_arq_t *handle) {
+  ahdlc_frame_encoder_t *enc = &handle->encoder;
+  uint8_t sack[AHDLC_ARQ_SACK_SIZE];
+  uint32_t bits = 0;
+  uint32_t i;
+
+  for (i = 1; i < handle->config.window; ++i) {
+    uint32_t slot = arqSlot(handle, (uint8_t)(handle->rx_next + i));
+    if (handle->rx_held & (1u << slot)) {
+      bits |= 1u << (i - 1);
+    }
+  }
+  for (i = 0; i < AHDLC_ARQ_SACK_SIZE; ++i) {
+    sack[i] = (uint8_t)(bits >> (8 * i));
+  }
+
+  enc->frame_info.control_bits.value = 0;
+  enc->frame_info.control_bits.bit.frame_is_ack = AHDLC_TRUE;
+  enc->frame_info.sequence = handle->tx_next;
+  enc->frame_info.ack_num = handle->rx_next;
+  ++handle->stats.acks_sent;
+
+  EncodeNewFrame(enc);
+  return EncodeBuffer(enc, sack, bits ? AHDLC_ARQ_SACK_SIZE : 0);
+}
+
+ahdlc_op_return AhdlcArqSend(ahdlc_arq_t *handle, const uint8_t *payload,
+    uint32_t len) {
+  uint32_t slot = arqSlot(handle, handle->tx_next);
+
+  if (len > handle->config.max_payload) {
+    return AHDLC_ERROR;
+  }
+  if (AhdlcArqInFlight(handle) == handle->config.window) {
+    return AHDLC_BUFFER_TOO_SMALL;
+  }
+
+  memcpy(&handle->tx_payloads[slot * handle->config.max_payload], payload,
+         len);
+  handle->tx_len[slot] = (uint16_t)len;
+  handle->tx_retries[slot] = 0;
+  handle->tx_acked &= ~(1u << slot);
+
+  /* In flight even if the link failed, the timer will resend it */
+  return arqTransmit(handle, handle->tx_next++);
+}
+
+static ahdlc_op_return arqReceiveAck(ahdlc_arq_t *handle,
+                                     const ahdlc_decoded_frame_t *frame) {
+  uint32_t acked = (uint8_t)(frame->ack_num - handle->tx_base);
+  uint32_t bits = 0;
+  uint32_t i;
+
+  ++handle->stats.acks_received;
+  if (acked > AhdlcArqInFlight(handle)) {
+    ++handle->stats.stale_ack_cnt;
+    return AHDLC_OK;
+  }
+
+  for (i = 0; i < acked; ++i) {
+    handle->tx_acked &= ~(1u << arqSlot(handle, handle->tx_base++));
+  }
+
+  for (i = 0; i < frame->payload_len && i < AHDLC_ARQ_SACK_SIZE; ++i) {
+    bits |= (uint32_t)frame->payload[i] << (8 * i);
+  }
+  for (i = 0; bits; ++i, bits >>= 1) {
+    uint8_t sequence = (uint8_t)(frame->ack_num + 1 + i);
+    if ((bits & 1) &&
+        (uint8_t)(sequence - handle->tx_base) < AhdlcArqInFlight(handle)) {
+      handle->tx_acked |= 1u << arqSlot(handle, sequence);
+    }
+  }
+
+  return AHDLC_OK;
+}
+
+static ahdlc_op_return arqReceiveData(ahdlc_arq_t *handle,
+                                      const ahdlc_decoded_frame_t *frame) {
+  const ahdlc_arq_config_t *config = &handle->config;
+  uint32_t ahead = (uint8_t)(frame->sequence - handle->rx_next);
+  uint32_t slot = arqSlot(handle, frame->sequence);
+
+  if (frame->payload_len > config->max_payload) {
+    return AHDLC_BUFFER_TOO_SMALL;
+  }
+
+  if (ahead == 0) {
+    config->deliver_cb(config->ctx, frame->payload, frame->payload_len);
+    ++handle->stats.frames_delivered;
+    slot = arqSlot(handle, ++handle->rx_next);
+
+    /* Frames held behind it are in order now */
+    while (handle->rx_held & (1u << slot)) {
+      handle->rx_held &= ~(1u << slot);
+      config->deliver_cb(config->ctx,
+          &handle->rx_payloads[slot * config->max_payload],
+          handle->rx_len[slot]);
+      ++handle->stats.frames_delivered;
+      slot = arqSlot(handle, ++handle->rx_next);
+    }
+  } else if (ahead < config->window) {
+    if (handle->rx_held & (1u << slot)) {
+      ++handle->stats.duplicate_cnt;
+    } else {
+      memcpy(&handle->rx_payloads[slot * config->max_payload],
+             frame->payload, frame->payload_len);
+      handle->rx_len[slot] = (uint16_t)frame->payload_len;
+      handle->rx_held |= 1u << slot;
+    }
+  } else if ((uint8_t)(handle->rx_next - frame->sequence) <= config->window) {
+    /* Already delivered, our ack was probably lost */
+    ++handle->stats.duplicate_cnt;
+  } else {
+    ++handle->stats.out_of_window_cnt;
+    return AHDLC_OK;
+  }
+
+  if (frame->control_bits.bit.ack_requested) {
+    return arqSendAck(handle);
+  }
+  return AHDLC_OK;
+}
+
+ahdlc_op_return AhdlcArqReceive(ahdlc_arq_t *handle,
+    const ahdlc_decoded_frame_t *frame) {
+  if (frame->control_bits.bit.frame_is_ack) {
+    return arqReceiveAck(handle, frame);
+  }
+  return arqReceiveData(handle, frame);
+}
+
+ahdlc_op_return AhdlcArqPoll(ahdlc_arq_t *handle) {
+  const ahdlc_arq_config_t *config = &handle->config;
+  uint32_t now = config->clock_cb(config->ctx);
+  ahdlc_op_return code = AHDLC_OK;
+  uint8_t sequence;
+
+  for (sequence = handle->tx_base; sequence != handle->tx_next; ++sequence) {
+    uint32_t slot = arqSlot(handle, sequence);
+
+    if ((handle->tx_acked & (1u << slot)) ||
+        now - handle->tx_sent_ms[slot] < config->retransmit_ms) {
+      continue;
+    }
+    if (config->max_retries &&
+        handle->tx_retries[slot] >= config->max_retries) {
+      /* Reported again each retransmit_ms until it is acked */
+      handle->tx_sent_ms[slot] = now;
+      ++handle->stats.retry_exhausted_cnt;
+      code = AHDLC_ERROR;
+      continue;
+    }
+
+    ++handle->tx_retries[slot];
+    ++handle->stats.retransmit_cnt;
+    arqTransmit(handle, sequence);
+  }
+
+  return code;
+}
@@ -0,0 +1,103 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "inc/byte_ring.h"
+
+#include <string.h>
+
+#include "inc/frame_layer.h"
+
+ahdlc_op_return AhdlcRingInit(ahdlc_byte_ring_t *ring, uint8_t *buffer,
+    uint32_t size) {
+  if (!buffer || !size || (size & (size - 1))) {
+    return AHDLC_ERROR;
+  }
+
+  ring->buffer = buffer;
+  ring->size = size;
+  ahdlcStoreRelease(&ring->head, 0);
+  ahdlcStoreRelease(&ring->tail, 0);
+  ring->high_water = 0;
+  ring->overflow_cnt = 0;
+
+  return AHDLC_OK;
+}
+
+uint32_t AhdlcRingWrite(ahdlc_byte_ring_t *ring, const uint8_t *data,
+    uint32_t len) {
+  uint32_t head = ahdlcLoadRelaxed(&ring->head);
+  uint32_t fill = head - ahdlcLoadAcquire(&ring->tail);
+  uint32_t at = head & (ring->size - 1);
+  uint32_t first;
+
+  if (len > ring->size - fill) {
+    ring->overflow_cnt += len - (ring->size - fill);
+    len = ring->size - fill;
+  }
+
+  /* Up to the end of the buffer, then from its start */
+  first = (len < ring->size - at) ? len : ring->size - at;
+  memcpy(&ring->buffer[at], data, first);
+  memcpy(ring->buffer, &data[first], len - first);
+  ahdlcStoreRelease(&ring->head, head + len);
+
+  fill += len;
+  if (fill > ring->high_water) {
+    ring->high_water = fill;
+  }
+
+  return len;
+}
+
+ahdlc_op_return AhdlcRingPutByte(ahdlc_byte_ring_t *ring, uint8_t byte) {
+  return AhdlcRingWrite(ring, &byte, 1) ? AHDLC_OK : AHDLC_BUFFER_TOO_SMALL;
+}
+
+uint32_t AhdlcRingFill(ahdlc_byte_ring_t *ring) {
+  return ahdlcLoadAcquire(&ring->head) - ahdlcLoadRelaxed(&ring->tail);
+}
+
+uint32_t AhdlcRingPeek(ahdlc_byte_ring_t *ring, const uint8_t **data) {
+  uint32_t tail = ahdlcLoadRelaxed(&ring->tail);
+  uint32_t fill = ahdlcLoadAcquire(&ring->head) - tail;
+  uint32_t at = tail & (ring->size - 1);
+
+  *data = &ring->buffer[at];
+  return (fill < ring->size - at) ? fill : ring->size - at;
+}
+
+void AhdlcRingConsume(ahdlc_byte_ring_t *ring, uint32_t len) {
+  ahdlcStoreRelease(&ring->tail, ahdlcLoadRelaxed(&ring->tail) + len);
+}
+
+ahdlc_op_return AhdlcRingDecodeNext(ahdlc_byte_ring_t *ring,
+    ahdlc_frame_decoder_t *decoder, ahdlc_decoded_frame_t *frame) {
+  const uint8_t *data;
+  uint32_t len;
+
+  /* At most two spans, before and after the wrap */
+  while ((len = AhdlcRingPeek(ring, &data)) != 0) {
+    uint32_t offset = 0;
+    ahdlc_op_return code = DecoderBufferNext(decoder, data, len, &offset,
+                                             frame);
+
+    AhdlcRingConsume(ring, offset);
+    if (code == AHDLC_COMPLETE) {
+      return code;
+    }
+  }
+
+  return AHDLC_OK;
+}
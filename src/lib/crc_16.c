@@ -15,9 +15,30 @@
 
 #include "inc/crc_16.h"
 
+/* Bytes per step of CRC16Sliced(). 1 keeps only crc16_tbl (512 bytes), 4, 8
+ * and 16 add 3, 7 and 15 more tables of the same size. */
+#ifndef CRC16_SLICE_BY
+#define CRC16_SLICE_BY (8)
+#endif
+
+#if CRC16_SLICE_BY != 1 && CRC16_SLICE_BY != 4 && CRC16_SLICE_BY != 8 \
+    && CRC16_SLICE_BY != 16
+#error "CRC16_SLICE_BY must be 1, 4, 8 or 16"
+#endif
+
+#include <string.h>
+
+#include "crc_16_slice_tbl.h"
+#include "inc/crc_16_gen.h"
+
+/* Period of the CRC in bytes, see CRC16Folded() */
+#define CRC16_FOLD_SPAN    (16)
+/* Below this the table kernels are as fast */
+#define CRC16_FOLD_MIN_LEN (64)
+
 /* implements 0x8005 (x^16 + x^15 + x^2 + 1) */
 
-static const uint16_t crc16_tbl[256] = {
+const uint16_t crc16_tbl[256] = {
   0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
   0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
   0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
@@ -60,3 +81,81 @@ uint16_t CRC16(uint16_t crc, const uint8_t *buf, uint32_t len) {
   }
   return crc;
 }
+
+/* RFC 1662 FCS-16 kernel: x^16 + x^12 + x^5 + 1, reflected, low byte first */
+AHDLC_CRC16_DEFINE_BASIS(crc16_ccitt, 0x8408, REFLECTED)
+const uint16_t crc16_ccitt_tbl[256] = AHDLC_CRC16_TABLE(crc16_ccitt);
+AHDLC_CRC16_DEFINE_UPDATE(crc16CcittKernel, crc16_ccitt_tbl, LOW)
+
+uint16_t CRC16CCITT(uint16_t crc, const uint8_t *buf, uint32_t len) {
+  return crc16CcittKernel(crc, buf, len);
+}
+
+/*
+ * The CRC update is linear, and running a block from state crc is the same
+ * as running it from zero with crc folded into its first two bytes. Each
+ * byte of a block can then be looked up independently, in the table for the
+ * number of bytes that follow it, and the results combined with XOR.
+ */
+uint16_t CRC16Sliced(uint16_t crc, const uint8_t *buf, uint32_t len) {
+#if CRC16_SLICE_BY > 1
+  while (len >= CRC16_SLICE_BY) {
+    uint32_t i;
+    uint16_t next = crc16_tbl[buf[CRC16_SLICE_BY - 1]] ^
+        crc16_slice_tbl[CRC16_SLICE_BY - 2][buf[0] ^ (crc >> 8)] ^
+        crc16_slice_tbl[CRC16_SLICE_BY - 3][buf[1] ^ (crc & 0xFF)];
+
+    for (i = 2; i < CRC16_SLICE_BY - 1; ++i) {
+      next ^= crc16_slice_tbl[CRC16_SLICE_BY - 2 - i][buf[i]];
+    }
+
+    crc = next;
+    buf += CRC16_SLICE_BY;
+    len -= CRC16_SLICE_BY;
+  }
+#endif
+
+  return CRC16(crc, buf, len);
+}
+
+/*
+ * Writing A for what one zero byte does to the CRC register, the table above
+ * (the reflected 0xA001 table, run MSB first) gives A^(k + 16) == A^k for all
+ * k >= 2: its minimal polynomial is x^2 * (x + 1)^10, which divides
+ * x^2 * (x^16 + 1). A byte therefore contributes the same to the CRC as the
+ * byte 16 positions after it, as long as that one is not the last byte, so
+ * a buffer can be XOR folded into 16 bytes plus its last byte. Carry-less
+ * multiply folding degenerates to the same thing, its x^128 fold constant
+ * being 1.
+ */
+uint16_t CRC16Folded(uint16_t crc, const uint8_t *buf, uint32_t len) {
+  uint64_t acc[CRC16_FOLD_SPAN / sizeof(uint64_t)] = {0, 0};
+  uint8_t folded[CRC16_FOLD_SPAN + 1];
+  uint32_t head;
+
+  if (len < CRC16_FOLD_MIN_LEN) {
+    return CRC16Sliced(crc, buf, len);
+  }
+
+  /* Leave a multiple of CRC16_FOLD_SPAN plus the last byte */
+  head = (len - 1) % CRC16_FOLD_SPAN;
+  crc = CRC16Sliced(crc, buf, head);
+  buf += head;
+  len -= head;
+
+  for (; len > CRC16_FOLD_SPAN; len -= CRC16_FOLD_SPAN) {
+    uint64_t word[CRC16_FOLD_SPAN / sizeof(uint64_t)];
+    memcpy(word, buf, sizeof(word));
+    acc[0] ^= word[0];
+    acc[1] ^= word[1];
+    buf += CRC16_FOLD_SPAN;
+  }
+
+  memcpy(folded, acc, CRC16_FOLD_SPAN);
+  folded[CRC16_FOLD_SPAN] = buf[0];
+  /* Running from crc is running from zero with crc in the first two bytes */
+  folded[0] ^= (uint8_t)(crc >> 8);
+  folded[1] ^= (uint8_t)(crc & 0xFF);
+
+  return CRC16Sliced(0, folded, sizeof(folded));
+}
@@ -0,0 +1,541 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/* Tables for CRC16Sliced(), generated from crc16_tbl. Row k holds the CRC of
+ * a byte followed by k + 1 zero bytes; crc16_tbl is the byte on its own. */
+
+#ifndef LIB_CRC_16_SLICE_TBL_H_
+#define LIB_CRC_16_SLICE_TBL_H_
+
+#if CRC16_SLICE_BY > 1
+static const uint16_t crc16_slice_tbl[CRC16_SLICE_BY - 1][256] = {
+  {
+    0x0000, 0x9100, 0x11C1, 0x80C1, 0x5040, 0xC140, 0x4181, 0xD081,
+    0x5380, 0xC280, 0x4241, 0xD341, 0x03C0, 0x92C0, 0x1201, 0x8301,
+    0x5400, 0xC500, 0x45C1, 0xD4C1, 0x0440, 0x9540, 0x1581, 0x8481,
+    0x0780, 0x9680, 0x1641, 0x8741, 0x57C0, 0xC6C0, 0x4601, 0xD701,
+    0x5B00, 0xCA00, 0x4AC1, 0xDBC1, 0x0B40, 0x9A40, 0x1A81, 0x8B81,
+    0x0880, 0x9980, 0x1941, 0x8841, 0x58C0, 0xC9C0, 0x4901, 0xD801,
+    0x0F00, 0x9E00, 0x1EC1, 0x8FC1, 0x5F40, 0xCE40, 0x4E81, 0xDF81,
+    0x5C80, 0xCD80, 0x4D41, 0xDC41, 0x0CC0, 0x9DC0, 0x1D01, 0x8C01,
+    0x4500, 0xD400, 0x54C1, 0xC5C1, 0x1540, 0x8440, 0x0481, 0x9581,
+    0x1680, 0x8780, 0x0741, 0x9641, 0x46C0, 0xD7C0, 0x5701, 0xC601,
+    0x1100, 0x8000, 0x00C1, 0x91C1, 0x4140, 0xD040, 0x5081, 0xC181,
+    0x4280, 0xD380, 0x5341, 0xC241, 0x12C0, 0x83C0, 0x0301, 0x9201,
+    0x1E00, 0x8F00, 0x0FC1, 0x9EC1, 0x4E40, 0xDF40, 0x5F81, 0xCE81,
+    0x4D80, 0xDC80, 0x5C41, 0xCD41, 0x1DC0, 0x8CC0, 0x0C01, 0x9D01,
+    0x4A00, 0xDB00, 0x5BC1, 0xCAC1, 0x1A40, 0x8B40, 0x0B81, 0x9A81,
+    0x1980, 0x8880, 0x0841, 0x9941, 0x49C0, 0xD8C0, 0x5801, 0xC901,
+    0x7900, 0xE800, 0x68C1, 0xF9C1, 0x2940, 0xB840, 0x3881, 0xA981,
+    0x2A80, 0xBB80, 0x3B41, 0xAA41, 0x7AC0, 0xEBC0, 0x6B01, 0xFA01,
+    0x2D00, 0xBC00, 0x3CC1, 0xADC1, 0x7D40, 0xEC40, 0x6C81, 0xFD81,
+    0x7E80, 0xEF80, 0x6F41, 0xFE41, 0x2EC0, 0xBFC0, 0x3F01, 0xAE01,
+    0x2200, 0xB300, 0x33C1, 0xA2C1, 0x7240, 0xE340, 0x6381, 0xF281,
+    0x7180, 0xE080, 0x6041, 0xF141, 0x21C0, 0xB0C0, 0x3001, 0xA101,
+    0x7600, 0xE700, 0x67C1, 0xF6C1, 0x2640, 0xB740, 0x3781, 0xA681,
+    0x2580, 0xB480, 0x3441, 0xA541, 0x75C0, 0xE4C0, 0x6401, 0xF501,
+    0x3C00, 0xAD00, 0x2DC1, 0xBCC1, 0x6C40, 0xFD40, 0x7D81, 0xEC81,
+    0x6F80, 0xFE80, 0x7E41, 0xEF41, 0x3FC0, 0xAEC0, 0x2E01, 0xBF01,
+    0x6800, 0xF900, 0x79C1, 0xE8C1, 0x3840, 0xA940, 0x2981, 0xB881,
+    0x3B80, 0xAA80, 0x2A41, 0xBB41, 0x6BC0, 0xFAC0, 0x7A01, 0xEB01,
+    0x6700, 0xF600, 0x76C1, 0xE7C1, 0x3740, 0xA640, 0x2681, 0xB781,
+    0x3480, 0xA580, 0x2541, 0xB441, 0x64C0, 0xF5C0, 0x7501, 0xE401,
+    0x3300, 0xA200, 0x22C1, 0xB3C1, 0x6340, 0xF240, 0x7281, 0xE381,
+    0x6080, 0xF180, 0x7141, 0xE041, 0x30C0, 0xA1C0, 0x2101, 0xB001
+  },
+  {
+    0x0000, 0xACC1, 0xCDC0, 0x6101, 0x7C00, 0xD0C1, 0xB1C0, 0x1D01,
+    0xBD40, 0x1181, 0x7080, 0xDC41, 0xC140, 0x6D81, 0x0C80, 0xA041,
+    0xFF01, 0x53C0, 0x32C1, 0x9E00, 0x8301, 0x2FC0, 0x4EC1, 0xE200,
+    0x4241, 0xEE80, 0x8F81, 0x2340, 0x3E41, 0x9280, 0xF381, 0x5F40,
+    0xFB41, 0x5780, 0x3681, 0x9A40, 0x8741, 0x2B80, 0x4A81, 0xE640,
+    0x4601, 0xEAC0, 0x8BC1, 0x2700, 0x3A01, 0x96C0, 0xF7C1, 0x5B00,
+    0x0440, 0xA881, 0xC980, 0x6541, 0x7840, 0xD481, 0xB580, 0x1941,
+    0xB900, 0x15C1, 0x74C0, 0xD801, 0xC500, 0x69C1, 0x08C0, 0xA401,
+    0xF3C1, 0x5F00, 0x3E01, 0x92C0, 0x8FC1, 0x2300, 0x4201, 0xEEC0,
+    0x4E81, 0xE240, 0x8341, 0x2F80, 0x3281, 0x9E40, 0xFF41, 0x5380,
+    0x0CC0, 0xA001, 0xC100, 0x6DC1, 0x70C0, 0xDC01, 0xBD00, 0x11C1,
+    0xB180, 0x1D41, 0x7C40, 0xD081, 0xCD80, 0x6141, 0x0040, 0xAC81,
+    0x0880, 0xA441, 0xC540, 0x6981, 0x7480, 0xD841, 0xB940, 0x1581,
+    0xB5C0, 0x1901, 0x7800, 0xD4C1, 0xC9C0, 0x6501, 0x0400, 0xA8C1,
+    0xF781, 0x5B40, 0x3A41, 0x9680, 0x8B81, 0x2740, 0x4641, 0xEA80,
+    0x4AC1, 0xE600, 0x8701, 0x2BC0, 0x36C1, 0x9A00, 0xFB01, 0x57C0,
+    0xE2C1, 0x4E00, 0x2F01, 0x83C0, 0x9EC1, 0x3200, 0x5301, 0xFFC0,
+    0x5F81, 0xF340, 0x9241, 0x3E80, 0x2381, 0x8F40, 0xEE41, 0x4280,
+    0x1DC0, 0xB101, 0xD000, 0x7CC1, 0x61C0, 0xCD01, 0xAC00, 0x00C1,
+    0xA080, 0x0C41, 0x6D40, 0xC181, 0xDC80, 0x7041, 0x1140, 0xBD81,
+    0x1980, 0xB541, 0xD440, 0x7881, 0x6580, 0xC941, 0xA840, 0x0481,
+    0xA4C0, 0x0801, 0x6900, 0xC5C1, 0xD8C0, 0x7401, 0x1500, 0xB9C1,
+    0xE681, 0x4A40, 0x2B41, 0x8780, 0x9A81, 0x3640, 0x5741, 0xFB80,
+    0x5BC1, 0xF700, 0x9601, 0x3AC0, 0x27C1, 0x8B00, 0xEA01, 0x46C0,
+    0x1100, 0xBDC1, 0xDCC0, 0x7001, 0x6D00, 0xC1C1, 0xA0C0, 0x0C01,
+    0xAC40, 0x0081, 0x6180, 0xCD41, 0xD040, 0x7C81, 0x1D80, 0xB141,
+    0xEE01, 0x42C0, 0x23C1, 0x8F00, 0x9201, 0x3EC0, 0x5FC1, 0xF300,
+    0x5341, 0xFF80, 0x9E81, 0x3240, 0x2F41, 0x8380, 0xE281, 0x4E40,
+    0xEA41, 0x4680, 0x2781, 0x8B40, 0x9641, 0x3A80, 0x5B81, 0xF740,
+    0x5701, 0xFBC0, 0x9AC1, 0x3600, 0x2B01, 0x87C0, 0xE6C1, 0x4A00,
+    0x1540, 0xB981, 0xD880, 0x7441, 0x6940, 0xC581, 0xA480, 0x0841,
+    0xA800, 0x04C1, 0x65C0, 0xC901, 0xD400, 0x78C1, 0x19C0, 0xB501
+  },
+  {
+    0x0000, 0xBC00, 0x55C1, 0xE9C1, 0xE101, 0x5D01, 0xB4C0, 0x08C0,
+    0x31C0, 0x8DC0, 0x6401, 0xD801, 0xD0C1, 0x6CC1, 0x8500, 0x3900,
+    0x4140, 0xFD40, 0x1481, 0xA881, 0xA041, 0x1C41, 0xF580, 0x4980,
+    0x7080, 0xCC80, 0x2541, 0x9941, 0x9181, 0x2D81, 0xC440, 0x7840,
+    0xC241, 0x7E41, 0x9780, 0x2B80, 0x2340, 0x9F40, 0x7681, 0xCA81,
+    0xF381, 0x4F81, 0xA640, 0x1A40, 0x1280, 0xAE80, 0x4741, 0xFB41,
+    0x8301, 0x3F01, 0xD6C0, 0x6AC0, 0x6200, 0xDE00, 0x37C1, 0x8BC1,
+    0xB2C1, 0x0EC1, 0xE700, 0x5B00, 0x53C0, 0xEFC0, 0x0601, 0xBA01,
+    0x8440, 0x3840, 0xD181, 0x6D81, 0x6541, 0xD941, 0x3080, 0x8C80,
+    0xB580, 0x0980, 0xE041, 0x5C41, 0x5481, 0xE881, 0x0140, 0xBD40,
+    0xC500, 0x7900, 0x90C1, 0x2CC1, 0x2401, 0x9801, 0x71C0, 0xCDC0,
+    0xF4C0, 0x48C0, 0xA101, 0x1D01, 0x15C1, 0xA9C1, 0x4000, 0xFC00,
+    0x4601, 0xFA01, 0x13C0, 0xAFC0, 0xA700, 0x1B00, 0xF2C1, 0x4EC1,
+    0x77C1, 0xCBC1, 0x2200, 0x9E00, 0x96C0, 0x2AC0, 0xC301, 0x7F01,
+    0x0741, 0xBB41, 0x5280, 0xEE80, 0xE640, 0x5A40, 0xB381, 0x0F81,
+    0x3681, 0x8A81, 0x6340, 0xDF40, 0xD780, 0x6B80, 0x8241, 0x3E41,
+    0x8880, 0x3480, 0xDD41, 0x6141, 0x6981, 0xD581, 0x3C40, 0x8040,
+    0xB940, 0x0540, 0xEC81, 0x5081, 0x5841, 0xE441, 0x0D80, 0xB180,
+    0xC9C0, 0x75C0, 0x9C01, 0x2001, 0x28C1, 0x94C1, 0x7D00, 0xC100,
+    0xF800, 0x4400, 0xADC1, 0x11C1, 0x1901, 0xA501, 0x4CC0, 0xF0C0,
+    0x4AC1, 0xF6C1, 0x1F00, 0xA300, 0xABC0, 0x17C0, 0xFE01, 0x4201,
+    0x7B01, 0xC701, 0x2EC0, 0x92C0, 0x9A00, 0x2600, 0xCFC1, 0x73C1,
+    0x0B81, 0xB781, 0x5E40, 0xE240, 0xEA80, 0x5680, 0xBF41, 0x0341,
+    0x3A41, 0x8641, 0x6F80, 0xD380, 0xDB40, 0x6740, 0x8E81, 0x3281,
+    0x0CC0, 0xB0C0, 0x5901, 0xE501, 0xEDC1, 0x51C1, 0xB800, 0x0400,
+    0x3D00, 0x8100, 0x68C1, 0xD4C1, 0xDC01, 0x6001, 0x89C0, 0x35C0,
+    0x4D80, 0xF180, 0x1841, 0xA441, 0xAC81, 0x1081, 0xF940, 0x4540,
+    0x7C40, 0xC040, 0x2981, 0x9581, 0x9D41, 0x2141, 0xC880, 0x7480,
+    0xCE81, 0x7281, 0x9B40, 0x2740, 0x2F80, 0x9380, 0x7A41, 0xC641,
+    0xFF41, 0x4341, 0xAA80, 0x1680, 0x1E40, 0xA240, 0x4B81, 0xF781,
+    0x8FC1, 0x33C1, 0xDA00, 0x6600, 0x6EC0, 0xD2C0, 0x3B01, 0x8701,
+    0xBE01, 0x0201, 0xEBC0, 0x57C0, 0x5F00, 0xE300, 0x0AC1, 0xB6C1
+  },
+#if CRC16_SLICE_BY > 4
+  {
+    0x0000, 0xB101, 0xFEC0, 0x4FC1, 0x49C0, 0xF8C1, 0xB700, 0x0601,
+    0x14C1, 0xA5C0, 0xEA01, 0x5B00, 0x5D01, 0xEC00, 0xA3C1, 0x12C0,
+    0x70C0, 0xC1C1, 0x8E00, 0x3F01, 0x3900, 0x8801, 0xC7C0, 0x76C1,
+    0x6401, 0xD500, 0x9AC1, 0x2BC0, 0x2DC1, 0x9CC0, 0xD301, 0x6200,
+    0xD081, 0x6180, 0x2E41, 0x9F40, 0x9941, 0x2840, 0x6781, 0xD680,
+    0xC440, 0x7541, 0x3A80, 0x8B81, 0x8D80, 0x3C81, 0x7340, 0xC241,
+    0xA041, 0x1140, 0x5E81, 0xEF80, 0xE981, 0x5880, 0x1741, 0xA640,
+    0xB480, 0x0581, 0x4A40, 0xFB41, 0xFD40, 0x4C41, 0x0380, 0xB281,
+    0x2300, 0x9201, 0xDDC0, 0x6CC1, 0x6AC0, 0xDBC1, 0x9400, 0x2501,
+    0x37C1, 0x86C0, 0xC901, 0x7800, 0x7E01, 0xCF00, 0x80C1, 0x31C0,
+    0x53C0, 0xE2C1, 0xAD00, 0x1C01, 0x1A00, 0xAB01, 0xE4C0, 0x55C1,
+    0x4701, 0xF600, 0xB9C1, 0x08C0, 0x0EC1, 0xBFC0, 0xF001, 0x4100,
+    0xF381, 0x4280, 0x0D41, 0xBC40, 0xBA41, 0x0B40, 0x4481, 0xF580,
+    0xE740, 0x5641, 0x1980, 0xA881, 0xAE80, 0x1F81, 0x5040, 0xE141,
+    0x8341, 0x3240, 0x7D81, 0xCC80, 0xCA81, 0x7B80, 0x3441, 0x8540,
+    0x9780, 0x2681, 0x6940, 0xD841, 0xDE40, 0x6F41, 0x2080, 0x9181,
+    0xE600, 0x5701, 0x18C0, 0xA9C1, 0xAFC0, 0x1EC1, 0x5100, 0xE001,
+    0xF2C1, 0x43C0, 0x0C01, 0xBD00, 0xBB01, 0x0A00, 0x45C1, 0xF4C0,
+    0x96C0, 0x27C1, 0x6800, 0xD901, 0xDF00, 0x6E01, 0x21C0, 0x90C1,
+    0x8201, 0x3300, 0x7CC1, 0xCDC0, 0xCBC1, 0x7AC0, 0x3501, 0x8400,
+    0x3681, 0x8780, 0xC841, 0x7940, 0x7F41, 0xCE40, 0x8181, 0x3080,
+    0x2240, 0x9341, 0xDC80, 0x6D81, 0x6B80, 0xDA81, 0x9540, 0x2441,
+    0x4641, 0xF740, 0xB881, 0x0980, 0x0F81, 0xBE80, 0xF141, 0x4040,
+    0x5280, 0xE381, 0xAC40, 0x1D41, 0x1B40, 0xAA41, 0xE580, 0x5481,
+    0xC500, 0x7401, 0x3BC0, 0x8AC1, 0x8CC0, 0x3DC1, 0x7200, 0xC301,
+    0xD1C1, 0x60C0, 0x2F01, 0x9E00, 0x9801, 0x2900, 0x66C1, 0xD7C0,
+    0xB5C0, 0x04C1, 0x4B00, 0xFA01, 0xFC00, 0x4D01, 0x02C0, 0xB3C1,
+    0xA101, 0x1000, 0x5FC1, 0xEEC0, 0xE8C1, 0x59C0, 0x1601, 0xA700,
+    0x1581, 0xA480, 0xEB41, 0x5A40, 0x5C41, 0xED40, 0xA281, 0x1380,
+    0x0140, 0xB041, 0xFF80, 0x4E81, 0x4880, 0xF981, 0xB640, 0x0741,
+    0x6541, 0xD440, 0x9B81, 0x2A80, 0x2C81, 0x9D80, 0xD241, 0x6340,
+    0x7180, 0xC081, 0x8F40, 0x3E41, 0x3840, 0x8941, 0xC680, 0x7781
+  },
+  {
+    0x0000, 0x75C0, 0x4081, 0x3541, 0x36C1, 0x4301, 0x7640, 0x0380,
+    0xCE00, 0xBBC0, 0x8E81, 0xFB41, 0xF8C1, 0x8D01, 0xB840, 0xCD80,
+    0x2401, 0x51C1, 0x6480, 0x1140, 0x12C0, 0x6700, 0x5241, 0x2781,
+    0xEA01, 0x9FC1, 0xAA80, 0xDF40, 0xDCC0, 0xA900, 0x9C41, 0xE981,
+    0x1D01, 0x68C1, 0x5D80, 0x2840, 0x2BC0, 0x5E00, 0x6B41, 0x1E81,
+    0xD301, 0xA6C1, 0x9380, 0xE640, 0xE5C0, 0x9000, 0xA541, 0xD081,
+    0x3900, 0x4CC0, 0x7981, 0x0C41, 0x0FC1, 0x7A01, 0x4F40, 0x3A80,
+    0xF700, 0x82C0, 0xB781, 0xC241, 0xC1C1, 0xB401, 0x8140, 0xF480,
+    0xD941, 0xAC81, 0x99C0, 0xEC00, 0xEF80, 0x9A40, 0xAF01, 0xDAC1,
+    0x1741, 0x6281, 0x57C0, 0x2200, 0x2180, 0x5440, 0x6101, 0x14C1,
+    0xFD40, 0x8880, 0xBDC1, 0xC801, 0xCB81, 0xBE41, 0x8B00, 0xFEC0,
+    0x3340, 0x4680, 0x73C1, 0x0601, 0x0581, 0x7041, 0x4500, 0x30C0,
+    0xC440, 0xB180, 0x84C1, 0xF101, 0xF281, 0x8741, 0xB200, 0xC7C0,
+    0x0A40, 0x7F80, 0x4AC1, 0x3F01, 0x3C81, 0x4941, 0x7C00, 0x09C0,
+    0xE041, 0x9581, 0xA0C0, 0xD500, 0xD680, 0xA340, 0x9601, 0xE3C1,
+    0x2E41, 0x5B81, 0x6EC0, 0x1B00, 0x1880, 0x6D40, 0x5801, 0x2DC1,
+    0x8A81, 0xFF41, 0xCA00, 0xBFC0, 0xBC40, 0xC980, 0xFCC1, 0x8901,
+    0x4481, 0x3141, 0x0400, 0x71C0, 0x7240, 0x0780, 0x32C1, 0x4701,
+    0xAE80, 0xDB40, 0xEE01, 0x9BC1, 0x9841, 0xED81, 0xD8C0, 0xAD00,
+    0x6080, 0x1540, 0x2001, 0x55C1, 0x5641, 0x2381, 0x16C0, 0x6300,
+    0x9780, 0xE240, 0xD701, 0xA2C1, 0xA141, 0xD481, 0xE1C0, 0x9400,
+    0x5980, 0x2C40, 0x1901, 0x6CC1, 0x6F41, 0x1A81, 0x2FC0, 0x5A00,
+    0xB381, 0xC641, 0xF300, 0x86C0, 0x8540, 0xF080, 0xC5C1, 0xB001,
+    0x7D81, 0x0841, 0x3D00, 0x48C0, 0x4B40, 0x3E80, 0x0BC1, 0x7E01,
+    0x53C0, 0x2600, 0x1341, 0x6681, 0x6501, 0x10C1, 0x2580, 0x5040,
+    0x9DC0, 0xE800, 0xDD41, 0xA881, 0xAB01, 0xDEC1, 0xEB80, 0x9E40,
+    0x77C1, 0x0201, 0x3740, 0x4280, 0x4100, 0x34C0, 0x0181, 0x7441,
+    0xB9C1, 0xCC01, 0xF940, 0x8C80, 0x8F00, 0xFAC0, 0xCF81, 0xBA41,
+    0x4EC1, 0x3B01, 0x0E40, 0x7B80, 0x7800, 0x0DC0, 0x3881, 0x4D41,
+    0x80C1, 0xF501, 0xC040, 0xB580, 0xB600, 0xC3C0, 0xF681, 0x8341,
+    0x6AC0, 0x1F00, 0x2A41, 0x5F81, 0x5C01, 0x29C1, 0x1C80, 0x6940,
+    0xA4C0, 0xD100, 0xE441, 0x9181, 0x9201, 0xE7C1, 0xD280, 0xA740
+  },
+  {
+    0x0000, 0x27C1, 0x7101, 0x56C0, 0xD780, 0xF041, 0xA681, 0x8140,
+    0x9481, 0xB340, 0xE580, 0xC241, 0x4301, 0x64C0, 0x3200, 0x15C1,
+    0x1A00, 0x3DC1, 0x6B01, 0x4CC0, 0xCD80, 0xEA41, 0xBC81, 0x9B40,
+    0x8E81, 0xA940, 0xFF80, 0xD841, 0x5901, 0x7EC0, 0x2800, 0x0FC1,
+    0x08C0, 0x2F01, 0x79C1, 0x5E00, 0xDF40, 0xF881, 0xAE41, 0x8980,
+    0x9C41, 0xBB80, 0xED40, 0xCA81, 0x4BC1, 0x6C00, 0x3AC0, 0x1D01,
+    0x12C0, 0x3501, 0x63C1, 0x4400, 0xC540, 0xE281, 0xB441, 0x9380,
+    0x8641, 0xA180, 0xF740, 0xD081, 0x51C1, 0x7600, 0x20C0, 0x0701,
+    0xDBC1, 0xFC00, 0xAAC0, 0x8D01, 0x0C41, 0x2B80, 0x7D40, 0x5A81,
+    0x4F40, 0x6881, 0x3E41, 0x1980, 0x98C0, 0xBF01, 0xE9C1, 0xCE00,
+    0xC1C1, 0xE600, 0xB0C0, 0x9701, 0x1641, 0x3180, 0x6740, 0x4081,
+    0x5540, 0x7281, 0x2441, 0x0380, 0x82C0, 0xA501, 0xF3C1, 0xD400,
+    0xD301, 0xF4C0, 0xA200, 0x85C1, 0x0481, 0x2340, 0x7580, 0x5241,
+    0x4780, 0x6041, 0x3681, 0x1140, 0x9000, 0xB7C1, 0xE101, 0xC6C0,
+    0xC901, 0xEEC0, 0xB800, 0x9FC1, 0x1E81, 0x3940, 0x6F80, 0x4841,
+    0x5D80, 0x7A41, 0x2C81, 0x0B40, 0x8A00, 0xADC1, 0xFB01, 0xDCC0,
+    0x2681, 0x0140, 0x5780, 0x7041, 0xF101, 0xD6C0, 0x8000, 0xA7C1,
+    0xB200, 0x95C1, 0xC301, 0xE4C0, 0x6580, 0x4241, 0x1481, 0x3340,
+    0x3C81, 0x1B40, 0x4D80, 0x6A41, 0xEB01, 0xCCC0, 0x9A00, 0xBDC1,
+    0xA800, 0x8FC1, 0xD901, 0xFEC0, 0x7F80, 0x5841, 0x0E81, 0x2940,
+    0x2E41, 0x0980, 0x5F40, 0x7881, 0xF9C1, 0xDE00, 0x88C0, 0xAF01,
+    0xBAC0, 0x9D01, 0xCBC1, 0xEC00, 0x6D40, 0x4A81, 0x1C41, 0x3B80,
+    0x3441, 0x1380, 0x4540, 0x6281, 0xE3C1, 0xC400, 0x92C0, 0xB501,
+    0xA0C0, 0x8701, 0xD1C1, 0xF600, 0x7740, 0x5081, 0x0641, 0x2180,
+    0xFD40, 0xDA81, 0x8C41, 0xAB80, 0x2AC0, 0x0D01, 0x5BC1, 0x7C00,
+    0x69C1, 0x4E00, 0x18C0, 0x3F01, 0xBE41, 0x9980, 0xCF40, 0xE881,
+    0xE740, 0xC081, 0x9641, 0xB180, 0x30C0, 0x1701, 0x41C1, 0x6600,
+    0x73C1, 0x5400, 0x02C0, 0x2501, 0xA441, 0x8380, 0xD540, 0xF281,
+    0xF580, 0xD241, 0x8481, 0xA340, 0x2200, 0x05C1, 0x5301, 0x74C0,
+    0x6101, 0x46C0, 0x1000, 0x37C1, 0xB681, 0x9140, 0xC780, 0xE041,
+    0xEF80, 0xC841, 0x9E81, 0xB940, 0x3800, 0x1FC1, 0x4901, 0x6EC0,
+    0x7B01, 0x5CC0, 0x0A00, 0x2DC1, 0xAC81, 0x8B40, 0xDD80, 0xFA41
+  },
+  {
+    0x0000, 0xDB40, 0x25C0, 0xFE80, 0xDE40, 0x0500, 0xFB80, 0x20C0,
+    0x2E01, 0xF541, 0x0BC1, 0xD081, 0xF041, 0x2B01, 0xD581, 0x0EC1,
+    0xCB81, 0x10C1, 0xEE41, 0x3501, 0x15C1, 0xCE81, 0x3001, 0xEB41,
+    0xE580, 0x3EC0, 0xC040, 0x1B00, 0x3BC0, 0xE080, 0x1E00, 0xC540,
+    0x0601, 0xDD41, 0x23C1, 0xF881, 0xD841, 0x0301, 0xFD81, 0x26C1,
+    0x2800, 0xF340, 0x0DC0, 0xD680, 0xF640, 0x2D00, 0xD380, 0x08C0,
+    0xCD80, 0x16C0, 0xE840, 0x3300, 0x13C0, 0xC880, 0x3600, 0xED40,
+    0xE381, 0x38C1, 0xC641, 0x1D01, 0x3DC1, 0xE681, 0x1801, 0xC341,
+    0x9A40, 0x4100, 0xBF80, 0x64C0, 0x4400, 0x9F40, 0x61C0, 0xBA80,
+    0xB441, 0x6F01, 0x9181, 0x4AC1, 0x6A01, 0xB141, 0x4FC1, 0x9481,
+    0x51C1, 0x8A81, 0x7401, 0xAF41, 0x8F81, 0x54C1, 0xAA41, 0x7101,
+    0x7FC0, 0xA480, 0x5A00, 0x8140, 0xA180, 0x7AC0, 0x8440, 0x5F00,
+    0x9C41, 0x4701, 0xB981, 0x62C1, 0x4201, 0x9941, 0x67C1, 0xBC81,
+    0xB240, 0x6900, 0x9780, 0x4CC0, 0x6C00, 0xB740, 0x49C0, 0x9280,
+    0x57C0, 0x8C80, 0x7200, 0xA940, 0x8980, 0x52C0, 0xAC40, 0x7700,
+    0x79C1, 0xA281, 0x5C01, 0x8741, 0xA781, 0x7CC1, 0x8241, 0x5901,
+    0x5B81, 0x80C1, 0x7E41, 0xA501, 0x85C1, 0x5E81, 0xA001, 0x7B41,
+    0x7580, 0xAEC0, 0x5040, 0x8B00, 0xABC0, 0x7080, 0x8E00, 0x5540,
+    0x9000, 0x4B40, 0xB5C0, 0x6E80, 0x4E40, 0x9500, 0x6B80, 0xB0C0,
+    0xBE01, 0x6541, 0x9BC1, 0x4081, 0x6041, 0xBB01, 0x4581, 0x9EC1,
+    0x5D80, 0x86C0, 0x7840, 0xA300, 0x83C0, 0x5880, 0xA600, 0x7D40,
+    0x7381, 0xA8C1, 0x5641, 0x8D01, 0xADC1, 0x7681, 0x8801, 0x5341,
+    0x9601, 0x4D41, 0xB3C1, 0x6881, 0x4841, 0x9301, 0x6D81, 0xB6C1,
+    0xB800, 0x6340, 0x9DC0, 0x4680, 0x6640, 0xBD00, 0x4380, 0x98C0,
+    0xC1C1, 0x1A81, 0xE401, 0x3F41, 0x1F81, 0xC4C1, 0x3A41, 0xE101,
+    0xEFC0, 0x3480, 0xCA00, 0x1140, 0x3180, 0xEAC0, 0x1440, 0xCF00,
+    0x0A40, 0xD100, 0x2F80, 0xF4C0, 0xD400, 0x0F40, 0xF1C0, 0x2A80,
+    0x2441, 0xFF01, 0x0181, 0xDAC1, 0xFA01, 0x2141, 0xDFC1, 0x0481,
+    0xC7C0, 0x1C80, 0xE200, 0x3940, 0x1980, 0xC2C0, 0x3C40, 0xE700,
+    0xE9C1, 0x3281, 0xCC01, 0x1741, 0x3781, 0xECC1, 0x1241, 0xC901,
+    0x0C41, 0xD701, 0x2981, 0xF2C1, 0xD201, 0x0941, 0xF7C1, 0x2C81,
+    0x2240, 0xF900, 0x0780, 0xDCC0, 0xFC00, 0x2740, 0xD9C0, 0x0280
+  },
+#endif  /* CRC16_SLICE_BY > 4 */
+#if CRC16_SLICE_BY > 8
+  {
+    0x0000, 0x1B40, 0x1BC1, 0x0081, 0x1880, 0x03C0, 0x0341, 0x1801,
+    0x1D80, 0x06C0, 0x0641, 0x1D01, 0x0500, 0x1E40, 0x1EC1, 0x0581,
+    0x1641, 0x0D01, 0x0D80, 0x16C0, 0x0EC1, 0x1581, 0x1500, 0x0E40,
+    0x0BC1, 0x1081, 0x1000, 0x0B40, 0x1341, 0x0801, 0x0880, 0x13C0,
+    0x0380, 0x18C0, 0x1841, 0x0301, 0x1B00, 0x0040, 0x00C1, 0x1B81,
+    0x1E00, 0x0540, 0x05C1, 0x1E81, 0x0680, 0x1DC0, 0x1D41, 0x0601,
+    0x15C1, 0x0E81, 0x0E00, 0x1540, 0x0D41, 0x1601, 0x1680, 0x0DC0,
+    0x0841, 0x1301, 0x1380, 0x08C0, 0x10C1, 0x0B81, 0x0B00, 0x1040,
+    0x2B80, 0x30C0, 0x3041, 0x2B01, 0x3300, 0x2840, 0x28C1, 0x3381,
+    0x3600, 0x2D40, 0x2DC1, 0x3681, 0x2E80, 0x35C0, 0x3541, 0x2E01,
+    0x3DC1, 0x2681, 0x2600, 0x3D40, 0x2541, 0x3E01, 0x3E80, 0x25C0,
+    0x2041, 0x3B01, 0x3B80, 0x20C0, 0x38C1, 0x2381, 0x2300, 0x3840,
+    0x2800, 0x3340, 0x33C1, 0x2881, 0x3080, 0x2BC0, 0x2B41, 0x3001,
+    0x3580, 0x2EC0, 0x2E41, 0x3501, 0x2D00, 0x3640, 0x36C1, 0x2D81,
+    0x3E41, 0x2501, 0x2580, 0x3EC0, 0x26C1, 0x3D81, 0x3D00, 0x2640,
+    0x23C1, 0x3881, 0x3800, 0x2340, 0x3B41, 0x2001, 0x2080, 0x3BC0,
+    0x7A41, 0x6101, 0x6180, 0x7AC0, 0x62C1, 0x7981, 0x7900, 0x6240,
+    0x67C1, 0x7C81, 0x7C00, 0x6740, 0x7F41, 0x6401, 0x6480, 0x7FC0,
+    0x6C00, 0x7740, 0x77C1, 0x6C81, 0x7480, 0x6FC0, 0x6F41, 0x7401,
+    0x7180, 0x6AC0, 0x6A41, 0x7101, 0x6900, 0x7240, 0x72C1, 0x6981,
+    0x79C1, 0x6281, 0x6200, 0x7940, 0x6141, 0x7A01, 0x7A80, 0x61C0,
+    0x6441, 0x7F01, 0x7F80, 0x64C0, 0x7CC1, 0x6781, 0x6700, 0x7C40,
+    0x6F80, 0x74C0, 0x7441, 0x6F01, 0x7700, 0x6C40, 0x6CC1, 0x7781,
+    0x7200, 0x6940, 0x69C1, 0x7281, 0x6A80, 0x71C0, 0x7141, 0x6A01,
+    0x51C1, 0x4A81, 0x4A00, 0x5140, 0x4941, 0x5201, 0x5280, 0x49C0,
+    0x4C41, 0x5701, 0x5780, 0x4CC0, 0x54C1, 0x4F81, 0x4F00, 0x5440,
+    0x4780, 0x5CC0, 0x5C41, 0x4701, 0x5F00, 0x4440, 0x44C1, 0x5F81,
+    0x5A00, 0x4140, 0x41C1, 0x5A81, 0x4280, 0x59C0, 0x5941, 0x4201,
+    0x5241, 0x4901, 0x4980, 0x52C0, 0x4AC1, 0x5181, 0x5100, 0x4A40,
+    0x4FC1, 0x5481, 0x5400, 0x4F40, 0x5741, 0x4C01, 0x4C80, 0x57C0,
+    0x4400, 0x5F40, 0x5FC1, 0x4481, 0x5C80, 0x47C0, 0x4741, 0x5C01,
+    0x5980, 0x42C0, 0x4241, 0x5901, 0x4100, 0x5A40, 0x5AC1, 0x4181
+  },
+  {
+    0x0000, 0x4B40, 0xCA40, 0x8100, 0x8A00, 0xC140, 0x4040, 0x0B00,
+    0x89C0, 0xC280, 0x4380, 0x08C0, 0x03C0, 0x4880, 0xC980, 0x82C0,
+    0x8F81, 0xC4C1, 0x45C1, 0x0E81, 0x0581, 0x4EC1, 0xCFC1, 0x8481,
+    0x0641, 0x4D01, 0xCC01, 0x8741, 0x8C41, 0xC701, 0x4601, 0x0D41,
+    0x8140, 0xCA00, 0x4B00, 0x0040, 0x0B40, 0x4000, 0xC100, 0x8A40,
+    0x0880, 0x43C0, 0xC2C0, 0x8980, 0x8280, 0xC9C0, 0x48C0, 0x0380,
+    0x0EC1, 0x4581, 0xC481, 0x8FC1, 0x84C1, 0xCF81, 0x4E81, 0x05C1,
+    0x8701, 0xCC41, 0x4D41, 0x0601, 0x0D01, 0x4641, 0xC741, 0x8C01,
+    0x9F40, 0xD400, 0x5500, 0x1E40, 0x1540, 0x5E00, 0xDF00, 0x9440,
+    0x1680, 0x5DC0, 0xDCC0, 0x9780, 0x9C80, 0xD7C0, 0x56C0, 0x1D80,
+    0x10C1, 0x5B81, 0xDA81, 0x91C1, 0x9AC1, 0xD181, 0x5081, 0x1BC1,
+    0x9901, 0xD241, 0x5341, 0x1801, 0x1301, 0x5841, 0xD941, 0x9201,
+    0x1E00, 0x5540, 0xD440, 0x9F00, 0x9400, 0xDF40, 0x5E40, 0x1500,
+    0x97C0, 0xDC80, 0x5D80, 0x16C0, 0x1DC0, 0x5680, 0xD780, 0x9CC0,
+    0x9181, 0xDAC1, 0x5BC1, 0x1081, 0x1B81, 0x50C1, 0xD1C1, 0x9A81,
+    0x1841, 0x5301, 0xD201, 0x9941, 0x9241, 0xD901, 0x5801, 0x1341,
+    0xA281, 0xE9C1, 0x68C1, 0x2381, 0x2881, 0x63C1, 0xE2C1, 0xA981,
+    0x2B41, 0x6001, 0xE101, 0xAA41, 0xA141, 0xEA01, 0x6B01, 0x2041,
+    0x2D00, 0x6640, 0xE740, 0xAC00, 0xA700, 0xEC40, 0x6D40, 0x2600,
+    0xA4C0, 0xEF80, 0x6E80, 0x25C0, 0x2EC0, 0x6580, 0xE480, 0xAFC0,
+    0x23C1, 0x6881, 0xE981, 0xA2C1, 0xA9C1, 0xE281, 0x6381, 0x28C1,
+    0xAA01, 0xE141, 0x6041, 0x2B01, 0x2001, 0x6B41, 0xEA41, 0xA101,
+    0xAC40, 0xE700, 0x6600, 0x2D40, 0x2640, 0x6D00, 0xEC00, 0xA740,
+    0x2580, 0x6EC0, 0xEFC0, 0xA480, 0xAF80, 0xE4C0, 0x65C0, 0x2E80,
+    0x3DC1, 0x7681, 0xF781, 0xBCC1, 0xB7C1, 0xFC81, 0x7D81, 0x36C1,
+    0xB401, 0xFF41, 0x7E41, 0x3501, 0x3E01, 0x7541, 0xF441, 0xBF01,
+    0xB240, 0xF900, 0x7800, 0x3340, 0x3840, 0x7300, 0xF200, 0xB940,
+    0x3B80, 0x70C0, 0xF1C0, 0xBA80, 0xB180, 0xFAC0, 0x7BC0, 0x3080,
+    0xBC81, 0xF7C1, 0x76C1, 0x3D81, 0x3681, 0x7DC1, 0xFCC1, 0xB781,
+    0x3541, 0x7E01, 0xFF01, 0xB441, 0xBF41, 0xF401, 0x7501, 0x3E41,
+    0x3300, 0x7840, 0xF940, 0xB200, 0xB900, 0xF240, 0x7340, 0x3800,
+    0xBAC0, 0xF180, 0x7080, 0x3BC0, 0x30C0, 0x7B80, 0xFA80, 0xB1C0
+  },
+  {
+    0x0000, 0x7740, 0x1780, 0x60C0, 0xA781, 0xD0C1, 0xB001, 0xC741,
+    0x66C1, 0x1181, 0x7141, 0x0601, 0xC140, 0xB600, 0xD6C0, 0xA180,
+    0x2541, 0x5201, 0x32C1, 0x4581, 0x82C0, 0xF580, 0x9540, 0xE200,
+    0x4380, 0x34C0, 0x5400, 0x2340, 0xE401, 0x9341, 0xF381, 0x84C1,
+    0x20C0, 0x5780, 0x3740, 0x4000, 0x8741, 0xF001, 0x90C1, 0xE781,
+    0x4601, 0x3141, 0x5181, 0x26C1, 0xE180, 0x96C0, 0xF600, 0x8140,
+    0x0581, 0x72C1, 0x1201, 0x6541, 0xA200, 0xD540, 0xB580, 0xC2C0,
+    0x6340, 0x1400, 0x74C0, 0x0380, 0xC4C1, 0xB381, 0xD341, 0xA401,
+    0x2840, 0x5F00, 0x3FC0, 0x4880, 0x8FC1, 0xF881, 0x9841, 0xEF01,
+    0x4E81, 0x39C1, 0x5901, 0x2E41, 0xE900, 0x9E40, 0xFE80, 0x89C0,
+    0x0D01, 0x7A41, 0x1A81, 0x6DC1, 0xAA80, 0xDDC0, 0xBD00, 0xCA40,
+    0x6BC0, 0x1C80, 0x7C40, 0x0B00, 0xCC41, 0xBB01, 0xDBC1, 0xAC81,
+    0x0880, 0x7FC0, 0x1F00, 0x6840, 0xAF01, 0xD841, 0xB881, 0xCFC1,
+    0x6E41, 0x1901, 0x79C1, 0x0E81, 0xC9C0, 0xBE80, 0xDE40, 0xA900,
+    0x2DC1, 0x5A81, 0x3A41, 0x4D01, 0x8A40, 0xFD00, 0x9DC0, 0xEA80,
+    0x4B00, 0x3C40, 0x5C80, 0x2BC0, 0xEC81, 0x9BC1, 0xFB01, 0x8C41,
+    0x3881, 0x4FC1, 0x2F01, 0x5841, 0x9F00, 0xE840, 0x8880, 0xFFC0,
+    0x5E40, 0x2900, 0x49C0, 0x3E80, 0xF9C1, 0x8E81, 0xEE41, 0x9901,
+    0x1DC0, 0x6A80, 0x0A40, 0x7D00, 0xBA41, 0xCD01, 0xADC1, 0xDA81,
+    0x7B01, 0x0C41, 0x6C81, 0x1BC1, 0xDC80, 0xABC0, 0xCB00, 0xBC40,
+    0x1841, 0x6F01, 0x0FC1, 0x7881, 0xBFC0, 0xC880, 0xA840, 0xDF00,
+    0x7E80, 0x09C0, 0x6900, 0x1E40, 0xD901, 0xAE41, 0xCE81, 0xB9C1,
+    0x3D00, 0x4A40, 0x2A80, 0x5DC0, 0x9A81, 0xEDC1, 0x8D01, 0xFA41,
+    0x5BC1, 0x2C81, 0x4C41, 0x3B01, 0xFC40, 0x8B00, 0xEBC0, 0x9C80,
+    0x10C1, 0x6781, 0x0741, 0x7001, 0xB740, 0xC000, 0xA0C0, 0xD780,
+    0x7600, 0x0140, 0x6180, 0x16C0, 0xD181, 0xA6C1, 0xC601, 0xB141,
+    0x3580, 0x42C0, 0x2200, 0x5540, 0x9201, 0xE541, 0x8581, 0xF2C1,
+    0x5341, 0x2401, 0x44C1, 0x3381, 0xF4C0, 0x8380, 0xE340, 0x9400,
+    0x3001, 0x4741, 0x2781, 0x50C1, 0x9780, 0xE0C0, 0x8000, 0xF740,
+    0x56C0, 0x2180, 0x4140, 0x3600, 0xF141, 0x8601, 0xE6C1, 0x9181,
+    0x1540, 0x6200, 0x02C0, 0x7580, 0xB2C1, 0xC581, 0xA541, 0xD201,
+    0x7381, 0x04C1, 0x6401, 0x1341, 0xD400, 0xA340, 0xC380, 0xB4C0
+  },
+  {
+    0x0000, 0x6640, 0x8E40, 0xE800, 0x3B41, 0x5D01, 0xB501, 0xD341,
+    0xEB80, 0x8DC0, 0x65C0, 0x0380, 0xD0C1, 0xB681, 0x5E81, 0x38C1,
+    0x9AC1, 0xFC81, 0x1481, 0x72C1, 0xA180, 0xC7C0, 0x2FC0, 0x4980,
+    0x7141, 0x1701, 0xFF01, 0x9941, 0x4A00, 0x2C40, 0xC440, 0xA200,
+    0x1801, 0x7E41, 0x9641, 0xF001, 0x2340, 0x4500, 0xAD00, 0xCB40,
+    0xF381, 0x95C1, 0x7DC1, 0x1B81, 0xC8C0, 0xAE80, 0x4680, 0x20C0,
+    0x82C0, 0xE480, 0x0C80, 0x6AC0, 0xB981, 0xDFC1, 0x37C1, 0x5181,
+    0x6940, 0x0F00, 0xE700, 0x8140, 0x5201, 0x3441, 0xDC41, 0xBA01,
+    0x5E00, 0x3840, 0xD040, 0xB600, 0x6541, 0x0301, 0xEB01, 0x8D41,
+    0xB580, 0xD3C0, 0x3BC0, 0x5D80, 0x8EC1, 0xE881, 0x0081, 0x66C1,
+    0xC4C1, 0xA281, 0x4A81, 0x2CC1, 0xFF80, 0x99C0, 0x71C0, 0x1780,
+    0x2F41, 0x4901, 0xA101, 0xC741, 0x1400, 0x7240, 0x9A40, 0xFC00,
+    0x4601, 0x2041, 0xC841, 0xAE01, 0x7D40, 0x1B00, 0xF300, 0x9540,
+    0xAD81, 0xCBC1, 0x23C1, 0x4581, 0x96C0, 0xF080, 0x1880, 0x7EC0,
+    0xDCC0, 0xBA80, 0x5280, 0x34C0, 0xE781, 0x81C1, 0x69C1, 0x0F81,
+    0x3740, 0x5100, 0xB900, 0xDF40, 0x0C01, 0x6A41, 0x8241, 0xE401,
+    0x5301, 0x3541, 0xDD41, 0xBB01, 0x6840, 0x0E00, 0xE600, 0x8040,
+    0xB881, 0xDEC1, 0x36C1, 0x5081, 0x83C0, 0xE580, 0x0D80, 0x6BC0,
+    0xC9C0, 0xAF80, 0x4780, 0x21C0, 0xF281, 0x94C1, 0x7CC1, 0x1A81,
+    0x2240, 0x4400, 0xAC00, 0xCA40, 0x1901, 0x7F41, 0x9741, 0xF101,
+    0x4B00, 0x2D40, 0xC540, 0xA300, 0x7041, 0x1601, 0xFE01, 0x9841,
+    0xA080, 0xC6C0, 0x2EC0, 0x4880, 0x9BC1, 0xFD81, 0x1581, 0x73C1,
+    0xD1C1, 0xB781, 0x5F81, 0x39C1, 0xEA80, 0x8CC0, 0x64C0, 0x0280,
+    0x3A41, 0x5C01, 0xB401, 0xD241, 0x0100, 0x6740, 0x8F40, 0xE900,
+    0x0D01, 0x6B41, 0x8341, 0xE501, 0x3640, 0x5000, 0xB800, 0xDE40,
+    0xE681, 0x80C1, 0x68C1, 0x0E81, 0xDDC0, 0xBB80, 0x5380, 0x35C0,
+    0x97C0, 0xF180, 0x1980, 0x7FC0, 0xAC81, 0xCAC1, 0x22C1, 0x4481,
+    0x7C40, 0x1A00, 0xF200, 0x9440, 0x4701, 0x2141, 0xC941, 0xAF01,
+    0x1500, 0x7340, 0x9B40, 0xFD00, 0x2E41, 0x4801, 0xA001, 0xC641,
+    0xFE80, 0x98C0, 0x70C0, 0x1680, 0xC5C1, 0xA381, 0x4B81, 0x2DC1,
+    0x8FC1, 0xE981, 0x0181, 0x67C1, 0xB480, 0xD2C0, 0x3AC0, 0x5C80,
+    0x6441, 0x0201, 0xEA01, 0x8C41, 0x5F00, 0x3940, 0xD140, 0xB700
+  },
+  {
+    0x0000, 0x6A80, 0x2480, 0x4E00, 0x9241, 0xF8C1, 0xB6C1, 0xDC41,
+    0xCF40, 0xA5C0, 0xEBC0, 0x8140, 0x5D01, 0x3781, 0x7981, 0x1301,
+    0xAA80, 0xC000, 0x8E00, 0xE480, 0x38C1, 0x5241, 0x1C41, 0x76C1,
+    0x65C0, 0x0F40, 0x4140, 0x2BC0, 0xF781, 0x9D01, 0xD301, 0xB981,
+    0x0B00, 0x6180, 0x2F80, 0x4500, 0x9941, 0xF3C1, 0xBDC1, 0xD741,
+    0xC440, 0xAEC0, 0xE0C0, 0x8A40, 0x5601, 0x3C81, 0x7281, 0x1801,
+    0xA180, 0xCB00, 0x8500, 0xEF80, 0x33C1, 0x5941, 0x1741, 0x7DC1,
+    0x6EC0, 0x0440, 0x4A40, 0x20C0, 0xFC81, 0x9601, 0xD801, 0xB281,
+    0xF881, 0x9201, 0xDC01, 0xB681, 0x6AC0, 0x0040, 0x4E40, 0x24C0,
+    0x37C1, 0x5D41, 0x1341, 0x79C1, 0xA580, 0xCF00, 0x8100, 0xEB80,
+    0x5201, 0x3881, 0x7681, 0x1C01, 0xC040, 0xAAC0, 0xE4C0, 0x8E40,
+    0x9D41, 0xF7C1, 0xB9C1, 0xD341, 0x0F00, 0x6580, 0x2B80, 0x4100,
+    0xF381, 0x9901, 0xD701, 0xBD81, 0x61C0, 0x0B40, 0x4540, 0x2FC0,
+    0x3CC1, 0x5641, 0x1841, 0x72C1, 0xAE80, 0xC400, 0x8A00, 0xE080,
+    0x5901, 0x3381, 0x7D81, 0x1701, 0xCB40, 0xA1C0, 0xEFC0, 0x8540,
+    0x9641, 0xFCC1, 0xB2C1, 0xD841, 0x0400, 0x6E80, 0x2080, 0x4A00,
+    0x3C40, 0x56C0, 0x18C0, 0x7240, 0xAE01, 0xC481, 0x8A81, 0xE001,
+    0xF300, 0x9980, 0xD780, 0xBD00, 0x6141, 0x0BC1, 0x45C1, 0x2F41,
+    0x96C0, 0xFC40, 0xB240, 0xD8C0, 0x0481, 0x6E01, 0x2001, 0x4A81,
+    0x5980, 0x3300, 0x7D00, 0x1780, 0xCBC1, 0xA141, 0xEF41, 0x85C1,
+    0x3740, 0x5DC0, 0x13C0, 0x7940, 0xA501, 0xCF81, 0x8181, 0xEB01,
+    0xF800, 0x9280, 0xDC80, 0xB600, 0x6A41, 0x00C1, 0x4EC1, 0x2441,
+    0x9DC0, 0xF740, 0xB940, 0xD3C0, 0x0F81, 0x6501, 0x2B01, 0x4181,
+    0x5280, 0x3800, 0x7600, 0x1C80, 0xC0C1, 0xAA41, 0xE441, 0x8EC1,
+    0xC4C1, 0xAE41, 0xE041, 0x8AC1, 0x5680, 0x3C00, 0x7200, 0x1880,
+    0x0B81, 0x6101, 0x2F01, 0x4581, 0x99C0, 0xF340, 0xBD40, 0xD7C0,
+    0x6E41, 0x04C1, 0x4AC1, 0x2041, 0xFC00, 0x9680, 0xD880, 0xB200,
+    0xA101, 0xCB81, 0x8581, 0xEF01, 0x3340, 0x59C0, 0x17C0, 0x7D40,
+    0xCFC1, 0xA541, 0xEB41, 0x81C1, 0x5D80, 0x3700, 0x7900, 0x1380,
+    0x0081, 0x6A01, 0x2401, 0x4E81, 0x92C0, 0xF840, 0xB640, 0xDCC0,
+    0x6541, 0x0FC1, 0x41C1, 0x2B41, 0xF700, 0x9D80, 0xD380, 0xB900,
+    0xAA01, 0xC081, 0x8E81, 0xE401, 0x3840, 0x52C0, 0x1CC0, 0x7640
+  },
+  {
+    0x0000, 0xAF80, 0x9B00, 0x3480, 0xEC81, 0x4301, 0x7781, 0xD801,
+    0x1440, 0xBBC0, 0x8F40, 0x20C0, 0xF8C1, 0x5741, 0x63C1, 0xCC41,
+    0xFF80, 0x5000, 0x6480, 0xCB00, 0x1301, 0xBC81, 0x8801, 0x2781,
+    0xEBC0, 0x4440, 0x70C0, 0xDF40, 0x0741, 0xA8C1, 0x9C41, 0x33C1,
+    0xC741, 0x68C1, 0x5C41, 0xF3C1, 0x2BC0, 0x8440, 0xB0C0, 0x1F40,
+    0xD301, 0x7C81, 0x4801, 0xE781, 0x3F80, 0x9000, 0xA480, 0x0B00,
+    0x38C1, 0x9741, 0xA3C1, 0x0C41, 0xD440, 0x7BC0, 0x4F40, 0xE0C0,
+    0x2C81, 0x8301, 0xB781, 0x1801, 0xC000, 0x6F80, 0x5B00, 0xF480,
+    0x0301, 0xAC81, 0x9801, 0x3781, 0xEF80, 0x4000, 0x7480, 0xDB00,
+    0x1741, 0xB8C1, 0x8C41, 0x23C1, 0xFBC0, 0x5440, 0x60C0, 0xCF40,
+    0xFC81, 0x5301, 0x6781, 0xC801, 0x1000, 0xBF80, 0x8B00, 0x2480,
+    0xE8C1, 0x4741, 0x73C1, 0xDC41, 0x0440, 0xABC0, 0x9F40, 0x30C0,
+    0xC440, 0x6BC0, 0x5F40, 0xF0C0, 0x28C1, 0x8741, 0xB3C1, 0x1C41,
+    0xD000, 0x7F80, 0x4B00, 0xE480, 0x3C81, 0x9301, 0xA781, 0x0801,
+    0x3BC0, 0x9440, 0xA0C0, 0x0F40, 0xD741, 0x78C1, 0x4C41, 0xE3C1,
+    0x2F80, 0x8000, 0xB480, 0x1B00, 0xC301, 0x6C81, 0x5801, 0xF781,
+    0x5100, 0xFE80, 0xCA00, 0x6580, 0xBD81, 0x1201, 0x2681, 0x8901,
+    0x4540, 0xEAC0, 0xDE40, 0x71C0, 0xA9C1, 0x0641, 0x32C1, 0x9D41,
+    0xAE80, 0x0100, 0x3580, 0x9A00, 0x4201, 0xED81, 0xD901, 0x7681,
+    0xBAC0, 0x1540, 0x21C0, 0x8E40, 0x5641, 0xF9C1, 0xCD41, 0x62C1,
+    0x9641, 0x39C1, 0x0D41, 0xA2C1, 0x7AC0, 0xD540, 0xE1C0, 0x4E40,
+    0x8201, 0x2D81, 0x1901, 0xB681, 0x6E80, 0xC100, 0xF580, 0x5A00,
+    0x69C1, 0xC641, 0xF2C1, 0x5D41, 0x8540, 0x2AC0, 0x1E40, 0xB1C0,
+    0x7D81, 0xD201, 0xE681, 0x4901, 0x9100, 0x3E80, 0x0A00, 0xA580,
+    0x5201, 0xFD81, 0xC901, 0x6681, 0xBE80, 0x1100, 0x2580, 0x8A00,
+    0x4641, 0xE9C1, 0xDD41, 0x72C1, 0xAAC0, 0x0540, 0x31C0, 0x9E40,
+    0xAD81, 0x0201, 0x3681, 0x9901, 0x4100, 0xEE80, 0xDA00, 0x7580,
+    0xB9C1, 0x1641, 0x22C1, 0x8D41, 0x5540, 0xFAC0, 0xCE40, 0x61C0,
+    0x9540, 0x3AC0, 0x0E40, 0xA1C0, 0x79C1, 0xD641, 0xE2C1, 0x4D41,
+    0x8100, 0x2E80, 0x1A00, 0xB580, 0x6D81, 0xC201, 0xF681, 0x5901,
+    0x6AC0, 0xC540, 0xF1C0, 0x5E40, 0x8641, 0x29C1, 0x1D41, 0xB2C1,
+    0x7E80, 0xD100, 0xE580, 0x4A00, 0x9201, 0x3D81, 0x0901, 0xA681
+  },
+  {
+    0x0000, 0xFC40, 0xAB41, 0x5701, 0x0C01, 0xF041, 0xA740, 0x5B00,
+    0x4F00, 0xB340, 0xE441, 0x1801, 0x4301, 0xBF41, 0xE840, 0x1400,
+    0xC040, 0x3C00, 0x6B01, 0x9741, 0xCC41, 0x3001, 0x6700, 0x9B40,
+    0x8F40, 0x7300, 0x2401, 0xD841, 0x8341, 0x7F01, 0x2800, 0xD440,
+    0xD341, 0x2F01, 0x7800, 0x8440, 0xDF40, 0x2300, 0x7401, 0x8841,
+    0x9C41, 0x6001, 0x3700, 0xCB40, 0x9040, 0x6C00, 0x3B01, 0xC741,
+    0x1301, 0xEF41, 0xB840, 0x4400, 0x1F00, 0xE340, 0xB441, 0x4801,
+    0x5C01, 0xA041, 0xF740, 0x0B00, 0x5000, 0xAC40, 0xFB41, 0x0701,
+    0x0040, 0xFC00, 0xAB01, 0x5741, 0x0C41, 0xF001, 0xA700, 0x5B40,
+    0x4F40, 0xB300, 0xE401, 0x1841, 0x4341, 0xBF01, 0xE800, 0x1440,
+    0xC000, 0x3C40, 0x6B41, 0x9701, 0xCC01, 0x3041, 0x6740, 0x9B00,
+    0x8F00, 0x7340, 0x2441, 0xD801, 0x8301, 0x7F41, 0x2840, 0xD400,
+    0xD301, 0x2F41, 0x7840, 0x8400, 0xDF00, 0x2340, 0x7441, 0x8801,
+    0x9C01, 0x6041, 0x3740, 0xCB00, 0x9000, 0x6C40, 0x3B41, 0xC701,
+    0x1341, 0xEF01, 0xB800, 0x4440, 0x1F40, 0xE300, 0xB401, 0x4841,
+    0x5C41, 0xA001, 0xF700, 0x0B40, 0x5040, 0xAC00, 0xFB01, 0x0741,
+    0xFCC1, 0x0081, 0x5780, 0xABC0, 0xF0C0, 0x0C80, 0x5B81, 0xA7C1,
+    0xB3C1, 0x4F81, 0x1880, 0xE4C0, 0xBFC0, 0x4380, 0x1481, 0xE8C1,
+    0x3C81, 0xC0C1, 0x97C0, 0x6B80, 0x3080, 0xCCC0, 0x9BC1, 0x6781,
+    0x7381, 0x8FC1, 0xD8C0, 0x2480, 0x7F80, 0x83C0, 0xD4C1, 0x2881,
+    0x2F80, 0xD3C0, 0x84C1, 0x7881, 0x2381, 0xDFC1, 0x88C0, 0x7480,
+    0x6080, 0x9CC0, 0xCBC1, 0x3781, 0x6C81, 0x90C1, 0xC7C0, 0x3B80,
+    0xEFC0, 0x1380, 0x4481, 0xB8C1, 0xE3C1, 0x1F81, 0x4880, 0xB4C0,
+    0xA0C0, 0x5C80, 0x0B81, 0xF7C1, 0xACC1, 0x5081, 0x0780, 0xFBC0,
+    0xFC81, 0x00C1, 0x57C0, 0xAB80, 0xF080, 0x0CC0, 0x5BC1, 0xA781,
+    0xB381, 0x4FC1, 0x18C0, 0xE480, 0xBF80, 0x43C0, 0x14C1, 0xE881,
+    0x3CC1, 0xC081, 0x9780, 0x6BC0, 0x30C0, 0xCC80, 0x9B81, 0x67C1,
+    0x73C1, 0x8F81, 0xD880, 0x24C0, 0x7FC0, 0x8380, 0xD481, 0x28C1,
+    0x2FC0, 0xD380, 0x8481, 0x78C1, 0x23C1, 0xDF81, 0x8880, 0x74C0,
+    0x60C0, 0x9C80, 0xCB81, 0x37C1, 0x6CC1, 0x9081, 0xC780, 0x3BC0,
+    0xEF80, 0x13C0, 0x44C1, 0xB881, 0xE381, 0x1FC1, 0x48C0, 0xB480,
+    0xA080, 0x5CC0, 0x0BC1, 0xF781, 0xAC81, 0x50C1, 0x07C0, 0xFB80
+  },
+  {
+    0x0000, 0x0100, 0xFE41, 0xFF41, 0x0400, 0x0500, 0xFA41, 0xFB41,
+    0xF441, 0xF541, 0x0A00, 0x0B00, 0xF041, 0xF141, 0x0E00, 0x0F00,
+    0x1000, 0x1100, 0xEE41, 0xEF41, 0x1400, 0x1500, 0xEA41, 0xEB41,
+    0xE441, 0xE541, 0x1A00, 0x1B00, 0xE041, 0xE141, 0x1E00, 0x1F00,
+    0xDC41, 0xDD41, 0x2200, 0x2300, 0xD841, 0xD941, 0x2600, 0x2700,
+    0x2800, 0x2900, 0xD641, 0xD741, 0x2C00, 0x2D00, 0xD241, 0xD341,
+    0xCC41, 0xCD41, 0x3200, 0x3300, 0xC841, 0xC941, 0x3600, 0x3700,
+    0x3800, 0x3900, 0xC641, 0xC741, 0x3C00, 0x3D00, 0xC241, 0xC341,
+    0x4000, 0x4100, 0xBE41, 0xBF41, 0x4400, 0x4500, 0xBA41, 0xBB41,
+    0xB441, 0xB541, 0x4A00, 0x4B00, 0xB041, 0xB141, 0x4E00, 0x4F00,
+    0x5000, 0x5100, 0xAE41, 0xAF41, 0x5400, 0x5500, 0xAA41, 0xAB41,
+    0xA441, 0xA541, 0x5A00, 0x5B00, 0xA041, 0xA141, 0x5E00, 0x5F00,
+    0x9C41, 0x9D41, 0x6200, 0x6300, 0x9841, 0x9941, 0x6600, 0x6700,
+    0x6800, 0x6900, 0x9641, 0x9741, 0x6C00, 0x6D00, 0x9241, 0x9341,
+    0x8C41, 0x8D41, 0x7200, 0x7300, 0x8841, 0x8941, 0x7600, 0x7700,
+    0x7800, 0x7900, 0x8641, 0x8741, 0x7C00, 0x7D00, 0x8241, 0x8341,
+    0x8000, 0x8100, 0x7E41, 0x7F41, 0x8400, 0x8500, 0x7A41, 0x7B41,
+    0x7441, 0x7541, 0x8A00, 0x8B00, 0x7041, 0x7141, 0x8E00, 0x8F00,
+    0x9000, 0x9100, 0x6E41, 0x6F41, 0x9400, 0x9500, 0x6A41, 0x6B41,
+    0x6441, 0x6541, 0x9A00, 0x9B00, 0x6041, 0x6141, 0x9E00, 0x9F00,
+    0x5C41, 0x5D41, 0xA200, 0xA300, 0x5841, 0x5941, 0xA600, 0xA700,
+    0xA800, 0xA900, 0x5641, 0x5741, 0xAC00, 0xAD00, 0x5241, 0x5341,
+    0x4C41, 0x4D41, 0xB200, 0xB300, 0x4841, 0x4941, 0xB600, 0xB700,
+    0xB800, 0xB900, 0x4641, 0x4741, 0xBC00, 0xBD00, 0x4241, 0x4341,
+    0xC000, 0xC100, 0x3E41, 0x3F41, 0xC400, 0xC500, 0x3A41, 0x3B41,
+    0x3441, 0x3541, 0xCA00, 0xCB00, 0x3041, 0x3141, 0xCE00, 0xCF00,
+    0xD000, 0xD100, 0x2E41, 0x2F41, 0xD400, 0xD500, 0x2A41, 0x2B41,
+    0x2441, 0x2541, 0xDA00, 0xDB00, 0x2041, 0x2141, 0xDE00, 0xDF00,
+    0x1C41, 0x1D41, 0xE200, 0xE300, 0x1841, 0x1941, 0xE600, 0xE700,
+    0xE800, 0xE900, 0x1641, 0x1741, 0xEC00, 0xED00, 0x1241, 0x1341,
+    0x0C41, 0x0D41, 0xF200, 0xF300, 0x0841, 0x0941, 0xF600, 0xF700,
+    0xF800, 0xF900, 0x0641, 0x0741, 0xFC00, 0xFD00, 0x0241, 0x0341
+  }
+#endif  /* CRC16_SLICE_BY > 8 */
+};
+#endif  /* CRC16_SLICE_BY > 1 */
+
+#endif  /* LIB_CRC_16_SLICE_TBL_H_ */
@@ -0,0 +1,155 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "inc/fragment.h"
+
+#include <string.h>
+
+#include "inc/frame_layer.h"
+
+typedef enum {
+  REASSEMBLY_START   = 0,  /* No frame seen yet, any sequence will do */
+  REASSEMBLY_IDLE    = 1,  /* Between messages */
+  REASSEMBLY_MESSAGE = 2,  /* Collecting fragments */
+  REASSEMBLY_DISCARD = 3   /* Skipping the rest of a dropped message */
+}ahdlc_reassembly_state;
+
+ahdlc_op_return AhdlcFragmenterInit(ahdlc_fragmenter_t *frag,
+    const uint8_t *message, uint32_t len, uint32_t mtu) {
+  if (!mtu) {
+    return AHDLC_ERROR;
+  }
+
+  frag->message = message;
+  frag->len = len;
+  frag->offset = 0;
+  frag->mtu = mtu;
+
+  return AHDLC_OK;
+}
+
+ahdlc_op_return AhdlcFragmentNext(ahdlc_fragmenter_t *frag,
+    ahdlc_frame_encoder_t *handle) {
+  frame_bits_t *bits = &handle->frame_info.control_bits.bit;
+  uint32_t len = frag->len - frag->offset;
+  ahdlc_op_return code;
+
+  if (len > frag->mtu) {
+    len = frag->mtu;
+  }
+  bits->frame_is_continued = (frag->offset + len < frag->len);
+
+  code = EncodeNewFrame(handle);
+  if (code == AHDLC_OK) {
+    code = EncodeBuffer(handle, &frag->message[frag->offset], len);
+  }
+  if (code != AHDLC_OK) {
+    bits->frame_is_continued = AHDLC_FALSE;
+    return code;
+  }
+
+  frag->offset += len;
+  if (bits->frame_is_continued) {
+    return AHDLC_OK;
+  }
+  return AHDLC_COMPLETE;
+}
+
+ahdlc_op_return AhdlcEncodeMessage(ahdlc_frame_encoder_t *handle,
+    const uint8_t *message, uint32_t len, uint32_t mtu) {
+  ahdlc_fragmenter_t frag;
+  ahdlc_op_return code = AhdlcFragmenterInit(&frag, message, len, mtu);
+
+  if (code != AHDLC_OK) {
+    return code;
+  }
+  /* Each fragment would overwrite the last one in frame_buffer */
+  if (handle->encode_mode == ENCODE_SEND_BYTE_TO_BUFFER && len > mtu) {
+    return AHDLC_ERROR;
+  }
+
+  do {
+    code = AhdlcFragmentNext(&frag, handle);
+  } while (code == AHDLC_OK);
+
+  return (code == AHDLC_COMPLETE) ? AHDLC_OK : code;
+}
+
+ahdlc_op_return AhdlcReassemblerInit(ahdlc_reassembler_t *reasm,
+    uint8_t *buffer, uint32_t buffer_len) {
+  if (!buffer && buffer_len) {
+    return AHDLC_ERROR;
+  }
+
+  memset(reasm, 0, sizeof(*reasm));
+  reasm->buffer = buffer;
+  reasm->buffer_len = buffer_len;
+  reasm->state = REASSEMBLY_START;
+
+  return AHDLC_OK;
+}
+
+ahdlc_op_return AhdlcReassemble(ahdlc_reassembler_t *reasm,
+    const ahdlc_decoded_frame_t *frame, uint32_t *message_len) {
+  uint8_t continued = frame->control_bits.bit.frame_is_continued;
+  ahdlc_op_return code = AHDLC_OK;
+
+  if (frame->control_bits.bit.frame_is_ack) {
+    return AHDLC_OK;
+  }
+
+  /*
+   * A gap may have taken the start of this message or the end of the last,
+   * so even a frame that is not continued cannot be trusted as a message.
+   */
+  if (reasm->state != REASSEMBLY_START &&
+      frame->sequence != reasm->next_sequence &&
+      reasm->state != REASSEMBLY_DISCARD) {
+    ++reasm->stats.sequence_gap_cnt;
+    reasm->state = REASSEMBLY_DISCARD;
+    code = AHDLC_ERROR;
+  }
+  reasm->next_sequence = (uint8_t)(frame->sequence + 1);
+
+  if (reasm->state == REASSEMBLY_DISCARD) {
+    if (!continued) {
+      reasm->state = REASSEMBLY_IDLE;
+    }
+    return code;
+  }
+
+  if (reasm->state != REASSEMBLY_MESSAGE) {
+    reasm->length = 0;
+  }
+  if (frame->payload_len > reasm->buffer_len - reasm->length) {
+    ++reasm->stats.overflow_cnt;
+    reasm->state = continued ? REASSEMBLY_DISCARD : REASSEMBLY_IDLE;
+    return AHDLC_BUFFER_TOO_SMALL;
+  }
+
+  memcpy(&reasm->buffer[reasm->length], frame->payload, frame->payload_len);
+  reasm->length += frame->payload_len;
+  ++reasm->stats.fragment_cnt;
+  if (continued) {
+    reasm->state = REASSEMBLY_MESSAGE;
+    return AHDLC_OK;
+  }
+
+  *message_len = reasm->length;
+  reasm->state = REASSEMBLY_IDLE;
+  ++reasm->stats.message_cnt;
+
+  return AHDLC_COMPLETE;
+}
@@ -18,6 +18,29 @@
 #include "stdint.h"
 #include <string.h>
 
+#include "inc/crc_16.h"
+#include "inc/crc_16_gen.h"
+#include "inc/frame_pool.h"
+#include "inc/frame_scan.h"
+#include "inc/lz_compress.h"
+
+/* Lets a byte core be instantiated per CRC kernel, much like a template */
+#if defined(__GNUC__)
+#define AHDLC_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define AHDLC_ALWAYS_INLINE inline
+#endif
+
+/* Bytes of an encrypted payload handed to encryption_cb at a time */
+#ifndef AHDLC_ENC_BLOCK_SIZE
+#define AHDLC_ENC_BLOCK_SIZE (256)
+#endif
+
+/* Marker, then flags, sequence, ack_num and counter, all escaped at worst */
+#define ENCODER_MAX_HEADER (1 + 2 * 7)
+/* Payloads shorter than this are never worth compressing */
+#define ENCODER_MIN_COMPRESS (2 * AHDLC_LZ_MIN_MATCH)
+
 /* Special bytes */
 const uint8_t frame_marker   = 0x7E;
 const uint8_t escape_marker  = 0x7D;
@@ -30,14 +53,27 @@ const uint8_t crc_size = sizeof(uint16_t);
 const uint8_t ack_frame_size_unencrypted = 6;
 const uint16_t initial_crc_value = 0;
 
+/* CRC16() and CRC16CCITT() inlined, over the tables crc_16.c exports */
+AHDLC_CRC16_DEFINE_UPDATE(crc16Kernel, crc16_tbl, HIGH)
+AHDLC_CRC16_DEFINE_UPDATE(crc16CcittKernel, crc16_ccitt_tbl, LOW)
+
 
 ahdlc_op_return ahdlcEncoderInit(ahdlc_frame_encoder_t *handle,
     crc_callback crc_function) {
   /* Set CRC calc function */
   handle->crc_cb = crc_function;
+  handle->encode_mode = ENCODE_SEND_BYTE_TO_BUFFER;
+  handle->sink_cb = NULL;
+  handle->sink_ctx = NULL;
+  handle->encryption_cb = NULL;
+  handle->lz_work = NULL;
+  handle->lz_work_len = 0;
+  handle->header_end = 0;
   memset(&handle->stats, 0, sizeof(ahdlc_encoder_stats));
   memset(&handle->frame_info, 0, sizeof(ahdlc_frame_t));
   memset(handle->frame_buffer, 0, sizeof(uint8_t) * handle->buffer_len);
+  AHDLC_INSTR(AhdlcInstrumentInit(&handle->instr));
+  AHDLC_INSTR(AhdlcEncoderPublishStats(handle));
   if (handle->buffer_len < min_payload_size) {
     return AHDLC_BUFFER_TOO_SMALL;
   }
@@ -45,51 +81,100 @@ ahdlc_op_return ahdlcEncoderInit(ahdlc_frame_encoder_t *handle,
   return AHDLC_OK;
 }
 
-/* Creates a new packet after resetting any current operation. */
-ahdlc_op_return EncodeNewFrame(ahdlc_frame_encoder_t *handle) {
-  ahdlc_op_return code = AHDLC_OK;
+ahdlc_op_return AhdlcEncoderSetSink(ahdlc_frame_encoder_t *handle,
+    encode_modes mode, encoder_sink_callback sink_cb, void *sink_ctx) {
+  if (mode == ENCODE_SEND_BYTE_TO_BUFFER) {
+    sink_cb = NULL;
+  } else if (mode == ENCODE_SEND_BYTE_TO_CALLBACK) {
+    /* Room for an escape pair */
+    if (handle->buffer_len < 2) {
+      return AHDLC_BUFFER_TOO_SMALL;
+    }
+  } else if (mode != ENCODE_SEND_FRAME_TO_CALLBACK) {
+    return AHDLC_ERROR;
+  }
+  if (mode != ENCODE_SEND_BYTE_TO_BUFFER && !sink_cb) {
+    return AHDLC_ERROR;
+  }
 
-  if (handle->frame_info.control_bits.bit.frame_is_ack) {
-    code = AHDLC_ERROR;  // No support yet
-  } else if (handle->frame_info.control_bits.bit.frame_is_encrypted) {
-    code = AHDLC_ERROR;  // No support yet
-  } else {
-    handle->frame_info.control_bits.bit.frame_valid = AHDLC_TRUE;
-    handle->frame_info.calculated_crc_16.crc_value = initial_crc_value;
-    handle->frame_info.buffer_index = 0;
-    handle->stats.encoder_state = ENCODE_READY;
-    code = encoderWriteByte(handle, frame_marker);
-    code = EncodeAddByteToFrameBuffer(handle,
-                                      handle->frame_info.control_bits.value);
-    code = EncodeAddByteToFrameBuffer(handle, handle->frame_info.sequence++);
+  handle->encode_mode = mode;
+  handle->sink_cb = sink_cb;
+  handle->sink_ctx = sink_ctx;
+  handle->frame_info.buffer_index = 0;
+
+  return AHDLC_OK;
+}
+
+ahdlc_op_return AhdlcEncoderSetCipher(ahdlc_frame_encoder_t *handle,
+    enc_callback enc_function, uint32_t first_ctr) {
+  handle->encryption_cb = enc_function;
+  /* EncodeNewFrame() moves to the next counter before using it */
+  handle->frame_info.enc_ctr = first_ctr - 1;
+
+  return AHDLC_OK;
+}
+
+ahdlc_op_return AhdlcEncoderSetCompression(ahdlc_frame_encoder_t *handle,
+    uint8_t *work, uint32_t work_len) {
+  if (work && ((uintptr_t)work % sizeof(uint16_t))) {
+    return AHDLC_ERROR;
   }
+  if (work && work_len <= AHDLC_LZ_TABLE_SIZE) {
+    return AHDLC_BUFFER_TOO_SMALL;
+  }
+  handle->lz_work = work;
+  handle->lz_work_len = work ? work_len : 0;
 
-  return code;
+  return AHDLC_OK;
 }
 
-/* Takes a raw data buffer and encodes it into a frame */
-ahdlc_op_return EncodeBuffer(ahdlc_frame_encoder_t *handle,
-                             const uint8_t *buffer, uint32_t buffer_len) {
-  uint32_t i;
-  ahdlc_op_return status = AHDLC_OK;
+#ifdef AHDLC_INSTRUMENTATION
+ahdlc_op_return AhdlcEncoderSetClock(ahdlc_frame_encoder_t *handle,
+    ahdlc_timestamp_callback time_cb, ahdlc_timestamp_callback cycle_cb,
+    void *ctx) {
+  handle->instr.time_cb = time_cb;
+  handle->instr.cycle_cb = cycle_cb;
+  handle->instr.ctx = ctx;
 
-  for (i = 0; i < buffer_len; ++i) {
-    status = EncodeAddByteToFrameBuffer(handle, buffer[i]);
-    if (status < 0) {
-      break;
-    }
+  return AHDLC_OK;
+}
+
+void AhdlcEncoderPublishStats(ahdlc_frame_encoder_t *handle) {
+  ahdlc_encoder_snapshot_t snapshot;
+
+  snapshot.stats = handle->stats;
+  snapshot.latency = handle->instr.latency;
+  snapshot.cycles = handle->instr.cycles;
+  AhdlcInstrumentPublish(&handle->instr, handle->published, &snapshot,
+                         sizeof(snapshot));
+}
+
+void AhdlcEncoderSnapshot(ahdlc_frame_encoder_t *handle,
+    ahdlc_encoder_snapshot_t *snapshot) {
+  AhdlcInstrumentRead(&handle->instr, handle->published, snapshot,
+                      sizeof(*snapshot));
+}
+#endif
+
+ahdlc_op_return EncodeFlush(ahdlc_frame_encoder_t *handle) {
+  if (handle->encode_mode != ENCODE_SEND_BYTE_TO_CALLBACK ||
+      !handle->frame_info.buffer_index) {
+    return AHDLC_OK;
   }
 
-  if (status == AHDLC_OK) {
-    status = EncodeFinalize(handle);
+  if (handle->sink_cb(handle->sink_ctx, handle->frame_buffer,
+                      handle->frame_info.buffer_index) < 0) {
+    handle->stats.encoder_state = ENCODE_SINK_ERROR;
+    return AHDLC_ERROR;
   }
+  handle->frame_info.buffer_index = 0;
 
-  return status;
+  return AHDLC_OK;
 }
 
-/* Adds a byte to a frame buffer */
-ahdlc_op_return EncodeAddByteToFrameBuffer(ahdlc_frame_encoder_t *handle,
-                                           uint8_t byte) {
+/* Adds a byte to a frame buffer, running crc_fn over it */
+static AHDLC_ALWAYS_INLINE ahdlc_op_return encoderAddByte(
+    ahdlc_frame_encoder_t *handle, uint8_t byte, crc_callback crc_fn) {
   ahdlc_op_return code = AHDLC_OK;
 
   if (handle->stats.encoder_state < 0) {
@@ -97,8 +182,9 @@ ahdlc_op_return EncodeAddByteToFrameBuffer(ahdlc_frame_encoder_t *handle,
     code = AHDLC_ERROR;
   } else {
       /* Add CRC before escape block */
-      handle->frame_info.calculated_crc_16.crc_value = handle->crc_cb(
+      handle->frame_info.calculated_crc_16.crc_value = crc_fn(
           handle->frame_info.calculated_crc_16.crc_value, &byte, sizeof(byte));
+      AHDLC_INSTR(++handle->stats.crc_calc_callback_count);
 
       if (byte == frame_marker) {
         code = encoderWriteByte(handle, escape_marker);
@@ -114,6 +200,358 @@ ahdlc_op_return EncodeAddByteToFrameBuffer(ahdlc_frame_encoder_t *handle,
   return code;
 }
 
+/* Starts the frame over, writing the header for sequence */
+static ahdlc_op_return encoderWriteHeader(ahdlc_frame_encoder_t *handle,
+                                          uint8_t sequence) {
+  ahdlc_op_return code;
+  frame_bits_t bits = handle->frame_info.control_bits.bit;
+  crc_callback crc_fn = handle->crc_cb;
+  uint32_t i;
+
+  handle->frame_info.calculated_crc_16.crc_value = initial_crc_value;
+  handle->frame_info.buffer_index = 0;
+  code = encoderWriteByte(handle, frame_marker);
+  code = encoderAddByte(handle, handle->frame_info.control_bits.value,
+                        crc_fn);
+  code = encoderAddByte(handle, sequence, crc_fn);
+  if (bits.frame_is_ack) {
+    code = encoderAddByte(handle, handle->frame_info.ack_num, crc_fn);
+  }
+  if (bits.frame_is_encrypted) {
+    /* Big endian */
+    for (i = 0; i < sizeof(handle->frame_info.enc_ctr); ++i) {
+      code = encoderAddByte(handle,
+          (uint8_t)(handle->frame_info.enc_ctr >> (24 - 8 * i)), crc_fn);
+    }
+  }
+  handle->header_end = handle->frame_info.buffer_index;
+
+  return code;
+}
+
+/* Creates a new packet after resetting any current operation. */
+ahdlc_op_return EncodeNewFrame(ahdlc_frame_encoder_t *handle) {
+  ahdlc_op_return code = AHDLC_OK;
+  frame_bits_t bits = handle->frame_info.control_bits.bit;
+
+  if (bits.frame_is_encrypted &&
+      (bits.frame_is_ack || !handle->encryption_cb)) {
+    code = AHDLC_ERROR;
+  } else {
+    handle->frame_info.control_bits.bit.frame_valid = AHDLC_TRUE;
+    handle->frame_info.enc_offset = 0;
+    handle->stats.encoder_state = ENCODE_READY;
+    AHDLC_INSTR(AhdlcInstrumentFrameStart(&handle->instr));
+    if (bits.frame_is_encrypted) {
+      /* A fresh counter for every frame */
+      ++handle->frame_info.enc_ctr;
+    }
+    /* Ack frames carry the sequence without using it up */
+    code = encoderWriteHeader(handle, bits.frame_is_ack ?
+        handle->frame_info.sequence : handle->frame_info.sequence++);
+  }
+
+  return code;
+}
+
+/*
+ * Escapes len bytes of in into out, which must have room for 2 * len bytes.
+ * Returns the number of bytes written.
+ */
+static uint32_t encoderEscape(uint8_t *out, const uint8_t *in, uint32_t len) {
+  uint32_t written = 0;
+  uint32_t i = 0;
+
+  while (i < len) {
+    uint32_t run = AhdlcScanSpecial(&in[i], len - i);
+
+    memcpy(&out[written], &in[i], run);
+    written += run;
+    i += run;
+
+    if (i < len) {
+      out[written++] = escape_marker;
+      out[written++] = (in[i++] == frame_marker) ? escaped_start
+                                                 : escaped_escape;
+    }
+  }
+
+  return written;
+}
+
+/* Adds bytes, as they go on the wire, to the current frame */
+static ahdlc_op_return encoderAddWire(ahdlc_frame_encoder_t *handle,
+                                      const uint8_t *buffer,
+                                      uint32_t buffer_len) {
+  uint32_t i;
+  ahdlc_op_return status = AHDLC_OK;
+  uint32_t room = handle->buffer_len - handle->frame_info.buffer_index;
+
+  if (handle->stats.encoder_state < 0) {
+    return AHDLC_ERROR;
+  }
+
+  if (handle->encode_mode == ENCODE_SEND_BYTE_TO_CALLBACK) {
+    /* Escape as much as the staging buffer surely holds, then flush it */
+    while (buffer_len && status == AHDLC_OK) {
+      uint32_t chunk = room / 2 < buffer_len ? room / 2 : buffer_len;
+
+      handle->frame_info.calculated_crc_16.crc_value = handle->crc_cb(
+          handle->frame_info.calculated_crc_16.crc_value, buffer, chunk);
+      AHDLC_INSTR(++handle->stats.crc_calc_callback_count);
+      handle->frame_info.buffer_index += encoderEscape(
+          &handle->frame_buffer[handle->frame_info.buffer_index], buffer,
+          chunk);
+      buffer += chunk;
+      buffer_len -= chunk;
+
+      room = handle->buffer_len - handle->frame_info.buffer_index;
+      if (room < 2) {
+        status = EncodeFlush(handle);
+        room = handle->buffer_len;
+      }
+    }
+  } else if (buffer_len <= room / 2) {
+    /* Fits even if every byte needs escaping: one CRC call, bulk copies */
+    handle->frame_info.calculated_crc_16.crc_value = handle->crc_cb(
+        handle->frame_info.calculated_crc_16.crc_value, buffer, buffer_len);
+    AHDLC_INSTR(++handle->stats.crc_calc_callback_count);
+    handle->frame_info.buffer_index += encoderEscape(
+        &handle->frame_buffer[handle->frame_info.buffer_index], buffer,
+        buffer_len);
+  } else {
+    /* May overflow, let the byte path stop at the exact byte */
+    for (i = 0; i < buffer_len; ++i) {
+      status = encoderAddByte(handle, buffer[i], handle->crc_cb);
+      if (status < 0) {
+        break;
+      }
+    }
+  }
+
+  return status;
+}
+
+/*
+ * Adds raw data to the current frame, without finalizing it. Payloads of
+ * encrypted frames go through encryption_cb a block at a time, in a copy,
+ * so the caller's data is left alone.
+ */
+static ahdlc_op_return encoderAddBuffer(ahdlc_frame_encoder_t *handle,
+                                        const uint8_t *buffer,
+                                        uint32_t buffer_len) {
+  uint8_t block[AHDLC_ENC_BLOCK_SIZE];
+  ahdlc_op_return status = AHDLC_OK;
+
+  if (!handle->frame_info.control_bits.bit.frame_is_encrypted) {
+    return encoderAddWire(handle, buffer, buffer_len);
+  }
+  if (handle->stats.encoder_state < 0) {
+    return AHDLC_ERROR;
+  }
+
+  while (buffer_len && status == AHDLC_OK) {
+    uint32_t chunk = buffer_len < sizeof(block) ? buffer_len : sizeof(block);
+
+    memcpy(block, buffer, chunk);
+    ++handle->stats.encryption_engine_callback_count;
+    status = handle->encryption_cb(handle->frame_info.enc_ctr,
+        handle->frame_info.enc_offset, block, chunk);
+    if (status != AHDLC_OK) {
+      return AHDLC_ERROR;
+    }
+    handle->frame_info.enc_offset += chunk;
+    status = encoderAddWire(handle, block, chunk);
+    buffer += chunk;
+    buffer_len -= chunk;
+  }
+
+  return status;
+}
+
+/*
+ * Compresses a whole payload into lz_work and, if that is shorter, writes
+ * the header again with frame_is_compressed set. Only done while the
+ * header is still in frame_buffer and nothing follows it. Returns the
+ * compressed length, 0 to send the payload as it is.
+ */
+static uint32_t encoderCompress(ahdlc_frame_encoder_t *handle,
+                                const uint8_t *buffer, uint32_t buffer_len) {
+  frame_control_field_t *control = &handle->frame_info.control_bits;
+  uint32_t room = handle->lz_work_len - AHDLC_LZ_TABLE_SIZE;
+  uint32_t packed;
+  uint8_t sequence;
+
+  if (!handle->lz_work || buffer_len < ENCODER_MIN_COMPRESS ||
+      handle->stats.encoder_state != ENCODE_READY ||
+      handle->frame_info.buffer_index != handle->header_end ||
+      (handle->encode_mode == ENCODE_SEND_BYTE_TO_CALLBACK &&
+       handle->buffer_len < ENCODER_MAX_HEADER)) {
+    return 0;
+  }
+
+  packed = AhdlcLzCompress(buffer, buffer_len,
+      handle->lz_work + AHDLC_LZ_TABLE_SIZE,
+      (room < buffer_len - 1) ? room : buffer_len - 1,
+      (uint16_t*)handle->lz_work);
+  if (!packed) {
+    return 0;
+  }
+
+  /* Same sequence and counter, EncodeNewFrame() already moved them on */
+  sequence = control->bit.frame_is_ack ? handle->frame_info.sequence :
+      (uint8_t)(handle->frame_info.sequence - 1);
+  control->bit.frame_is_compressed = AHDLC_TRUE;
+  encoderWriteHeader(handle, sequence);
+  control->bit.frame_is_compressed = AHDLC_FALSE;
+  ++handle->stats.compressed_frame_cnt;
+
+  return packed;
+}
+
+/* Takes a raw data buffer and encodes it into a frame */
+ahdlc_op_return EncodeBuffer(ahdlc_frame_encoder_t *handle,
+                             const uint8_t *buffer, uint32_t buffer_len) {
+  ahdlc_op_return status;
+  uint32_t packed = encoderCompress(handle, buffer, buffer_len);
+
+  if (packed) {
+    status = encoderAddBuffer(handle, handle->lz_work + AHDLC_LZ_TABLE_SIZE,
+                              packed);
+  } else {
+    status = encoderAddBuffer(handle, buffer, buffer_len);
+  }
+
+  if (status == AHDLC_OK) {
+    status = EncodeFinalize(handle);
+  }
+
+  return status;
+}
+
+/* Encodes the concatenation of all segments into one frame */
+ahdlc_op_return EncodeSegments(ahdlc_frame_encoder_t *handle,
+                               const ahdlc_segment_t *segments,
+                               uint32_t num_segments) {
+  ahdlc_op_return status = AHDLC_OK;
+  uint32_t i;
+
+  for (i = 0; i < num_segments && status == AHDLC_OK; ++i) {
+    status = encoderAddBuffer(handle, segments[i].base, segments[i].len);
+  }
+
+  if (status == AHDLC_OK) {
+    status = EncodeFinalize(handle);
+  }
+
+  return status;
+}
+
+/* Appends to iov, extending the last entry when the bytes follow on */
+static ahdlc_op_return encoderIovAppend(ahdlc_segment_t *iov,
+    uint32_t max_iov, uint32_t *num_iov, const uint8_t *base, uint32_t len) {
+  ahdlc_segment_t *last = *num_iov ? &iov[*num_iov - 1] : NULL;
+
+  if (!len) {
+    return AHDLC_OK;
+  }
+  if (last && last->base + last->len == base) {
+    last->len += len;
+  } else if (*num_iov < max_iov) {
+    iov[*num_iov].base = base;
+    iov[*num_iov].len = len;
+    ++*num_iov;
+  } else {
+    return AHDLC_BUFFER_TOO_SMALL;
+  }
+
+  return AHDLC_OK;
+}
+
+ahdlc_op_return EncodeSegmentsIovec(ahdlc_frame_encoder_t *handle,
+    const ahdlc_segment_t *segments, uint32_t num_segments,
+    ahdlc_segment_t *iov, uint32_t max_iov, uint32_t *num_iov) {
+  ahdlc_op_return status = AHDLC_OK;
+  uint32_t mark;
+  uint32_t i;
+
+  *num_iov = 0;
+  if (handle->stats.encoder_state != ENCODE_READY ||
+      handle->encode_mode != ENCODE_SEND_BYTE_TO_BUFFER ||
+      handle->frame_info.control_bits.bit.frame_is_encrypted) {
+    return AHDLC_ERROR;
+  }
+
+  /* Marker, flags and sequence written by EncodeNewFrame() */
+  status = encoderIovAppend(iov, max_iov, num_iov, handle->frame_buffer,
+                            handle->frame_info.buffer_index);
+
+  for (i = 0; i < num_segments && status == AHDLC_OK; ++i) {
+    const uint8_t *in = segments[i].base;
+    uint32_t len = segments[i].len;
+    uint32_t pos = 0;
+
+    handle->frame_info.calculated_crc_16.crc_value = handle->crc_cb(
+        handle->frame_info.calculated_crc_16.crc_value, in, len);
+    AHDLC_INSTR(++handle->stats.crc_calc_callback_count);
+
+    while (pos < len && status == AHDLC_OK) {
+      uint32_t run = AhdlcScanSpecial(&in[pos], len - pos);
+
+      /* Plain bytes are sent from where they are */
+      status = encoderIovAppend(iov, max_iov, num_iov, &in[pos], run);
+      pos += run;
+
+      if (pos < len && status == AHDLC_OK) {
+        mark = handle->frame_info.buffer_index;
+        encoderWriteByte(handle, escape_marker);
+        status = encoderWriteByte(handle, (in[pos++] == frame_marker)
+                                          ? escaped_start : escaped_escape);
+        if (status == AHDLC_OK) {
+          status = encoderIovAppend(iov, max_iov, num_iov,
+              &handle->frame_buffer[mark], 2);
+        }
+      }
+    }
+  }
+
+  if (status == AHDLC_OK) {
+    mark = handle->frame_info.buffer_index;
+    status = EncodeFinalize(handle);
+    if (status == AHDLC_OK) {
+      status = encoderIovAppend(iov, max_iov, num_iov,
+          &handle->frame_buffer[mark], handle->frame_info.buffer_index - mark);
+    }
+  }
+
+  return status;
+}
+
+/* Adds a byte to a frame buffer */
+ahdlc_op_return EncodeAddByteToFrameBuffer(ahdlc_frame_encoder_t *handle,
+                                           uint8_t byte) {
+  if (handle->frame_info.control_bits.bit.frame_is_encrypted) {
+    return AHDLC_ERROR;  /* Encrypted payloads go through in blocks */
+  }
+  return encoderAddByte(handle, byte, handle->crc_cb);
+}
+
+ahdlc_op_return EncodeAddByteToFrameBufferCRC16(
+    ahdlc_frame_encoder_t *handle, uint8_t byte) {
+  if (handle->frame_info.control_bits.bit.frame_is_encrypted) {
+    return AHDLC_ERROR;  /* Encrypted payloads go through in blocks */
+  }
+  return encoderAddByte(handle, byte, crc16Kernel);
+}
+
+ahdlc_op_return EncodeAddByteToFrameBufferCRC16CCITT(
+    ahdlc_frame_encoder_t *handle, uint8_t byte) {
+  if (handle->frame_info.control_bits.bit.frame_is_encrypted) {
+    return AHDLC_ERROR;  /* Encrypted payloads go through in blocks */
+  }
+  return encoderAddByte(handle, byte, crc16CcittKernel);
+}
+
 /* Write length and calculate CRC */
 ahdlc_op_return EncodeFinalize(ahdlc_frame_encoder_t *hdl) {
   ahdlc_op_return code = AHDLC_OK;
@@ -126,11 +564,28 @@ ahdlc_op_return EncodeFinalize(ahdlc_frame_encoder_t *hdl) {
   /* Calc CRC */
   crc.crc_value = hdl->frame_info.calculated_crc_16.crc_value;
   /* Endian handled in header, always send in BE */
-  code = EncodeAddByteToFrameBuffer(hdl, crc.bytes.high);
-  code = EncodeAddByteToFrameBuffer(hdl, crc.bytes.low);
+  code = encoderAddByte(hdl, crc.bytes.high, hdl->crc_cb);
+  code = encoderAddByte(hdl, crc.bytes.low, hdl->crc_cb);
   code = encoderWriteByte(hdl, frame_marker);
 
+  /* Hand the rest over, a failing sink leaves ENCODE_SINK_ERROR set */
+  if (code == AHDLC_OK) {
+    if (hdl->encode_mode == ENCODE_SEND_BYTE_TO_CALLBACK) {
+      code = EncodeFlush(hdl);
+    } else if (hdl->encode_mode == ENCODE_SEND_FRAME_TO_CALLBACK &&
+               hdl->sink_cb(hdl->sink_ctx, hdl->frame_buffer,
+                            hdl->frame_info.buffer_index) < 0) {
+      hdl->stats.encoder_state = ENCODE_SINK_ERROR;
+      code = AHDLC_ERROR;
+    }
+    if (code != AHDLC_OK) {
+      return code;
+    }
+  }
+
   hdl->stats.encoder_state = ENCODE_FINALIZED;
+  AHDLC_INSTR(AhdlcInstrumentFrameEnd(&hdl->instr));
+  AHDLC_INSTR(AhdlcEncoderPublishStats(hdl));
 
   return code;
 }
@@ -150,28 +605,235 @@ ahdlc_op_return AhdlcDecoderInit(ahdlc_frame_decoder_t *handle,
   }
   /* Set CRC calc function */
   handle->crc_cb = crc_function;
-  handle->reset_on_next_byte = 1;
-  handle->expecting_escape = 0;
+  handle->enc_cb = NULL;
+  handle->lz_scratch = NULL;
+  handle->lz_scratch_len = 0;
+  handle->crc_mode = DECODE_CRC_PER_BYTE;
+  handle->dfa_state = DECODE_DFA_RESET_PENDING;
+  handle->pool = NULL;
   memset(&handle->stats, 0, sizeof(handle->stats));
+  AHDLC_INSTR(AhdlcInstrumentInit(&handle->instr));
+  AHDLC_INSTR(AhdlcDecoderPublishStats(handle));
 
   return AHDLC_OK;
 }
 
-ahdlc_op_return DecoderBuffer(ahdlc_frame_decoder_t *handle, uint8_t *raw_data,
-                              uint32_t buffer_length) {
-  ahdlc_op_return code = AHDLC_OK;
+ahdlc_op_return AhdlcDecoderInitPool(ahdlc_frame_decoder_t *handle,
+    crc_callback crc_function, struct ahdlc_frame_pool *pool) {
+  ahdlc_op_return code;
+  uint8_t *slot = AhdlcFramePoolAlloc(pool);
+
+  if (!slot) {
+    return AHDLC_BUFFER_TOO_SMALL;
+  }
+
+  handle->pdu_buffer = slot;
+  handle->buffer_len = pool->slot_size;
+  code = AhdlcDecoderInit(handle, crc_function, NULL);
+  if (code != AHDLC_OK) {
+    AhdlcFramePoolFree(pool, slot);
+    return code;
+  }
+  handle->pool = pool;
+
+  return AHDLC_OK;
+}
+
+uint8_t *AhdlcDecoderTakeFrame(ahdlc_frame_decoder_t *handle,
+    uint32_t *payload_len) {
+  uint8_t *frame;
+  uint8_t *fresh;
 
+  if (!handle->pool || handle->decoder_state != DECODE_COMPLETE_GOOD) {
+    return NULL;
+  }
+  fresh = AhdlcFramePoolAlloc(handle->pool);
+  if (!fresh) {
+    return NULL;
+  }
+
+  frame = handle->pdu_buffer;
+  *payload_len = handle->frame_info.buffer_index;
+  handle->pdu_buffer = fresh;
+  /* The frame is gone from the decoder, it cannot be taken twice */
+  handle->decoder_state = DECODE_RESERVED;
+
+  return frame;
+}
+
+ahdlc_op_return AhdlcDecoderSetCipher(ahdlc_frame_decoder_t *handle,
+    enc_callback enc_function) {
+  handle->enc_cb = enc_function;
+
+  return AHDLC_OK;
+}
+
+ahdlc_op_return AhdlcDecoderSetCompression(ahdlc_frame_decoder_t *handle,
+    uint8_t *scratch, uint32_t scratch_len) {
+  handle->lz_scratch = scratch;
+  handle->lz_scratch_len = scratch ? scratch_len : 0;
+
+  return AHDLC_OK;
+}
+
+ahdlc_op_return AhdlcDecoderSetCrcMode(ahdlc_frame_decoder_t *handle,
+    ahdlc_decoder_crc_mode mode) {
+  if (mode != DECODE_CRC_PER_BYTE && mode != DECODE_CRC_PER_FRAME) {
+    return AHDLC_ERROR;
+  }
+  /* Switching mid frame would leave crc_stack half filled */
+  handle->crc_mode = mode;
+  handle->dfa_state = DECODE_DFA_RESET_PENDING;
+
+  return AHDLC_OK;
+}
+
+#ifdef AHDLC_INSTRUMENTATION
+ahdlc_op_return AhdlcDecoderSetClock(ahdlc_frame_decoder_t *handle,
+    ahdlc_timestamp_callback time_cb, ahdlc_timestamp_callback cycle_cb,
+    void *ctx) {
+  handle->instr.time_cb = time_cb;
+  handle->instr.cycle_cb = cycle_cb;
+  handle->instr.ctx = ctx;
+
+  return AHDLC_OK;
+}
+
+void AhdlcDecoderPublishStats(ahdlc_frame_decoder_t *handle) {
+  ahdlc_decoder_snapshot_t snapshot;
+
+  snapshot.stats = handle->stats;
+  snapshot.latency = handle->instr.latency;
+  snapshot.cycles = handle->instr.cycles;
+  AhdlcInstrumentPublish(&handle->instr, handle->published, &snapshot,
+                         sizeof(snapshot));
+}
+
+void AhdlcDecoderSnapshot(ahdlc_frame_decoder_t *handle,
+    ahdlc_decoder_snapshot_t *snapshot) {
+  AhdlcInstrumentRead(&handle->instr, handle->published, snapshot,
+                      sizeof(*snapshot));
+}
+#endif
+
+/*
+ * Copies a run of plain PDU bytes straight into pdu_buffer, leaving the
+ * handle in exactly the state DecodeFrameByte() would for the same bytes.
+ * Returns the number of bytes consumed, zero if the byte path must handle
+ * the next byte (special byte, non-PDU state, custom writer or full buffer).
+ */
+static uint32_t decoderCopyRun(ahdlc_frame_decoder_t *handle,
+                               const uint8_t *raw_data, uint32_t length) {
+  crc_16_stack_t *stack = &handle->crc_stack;
+  uint8_t *dst;
+  uint32_t run;
+  uint32_t room;
   uint32_t i;
-  uint32_t frames_decoded = handle->stats.good_frame_cnt;
+  crc_16_t crc;
 
-  /* scan over buffer and find a packet then stop */
-  for (i = 0; i < buffer_length; ++i) {
-    code = DecodeFrameByte(handle, raw_data[i]);
+  if (handle->dfa_state != DECODE_DFA_PDU ||
+      handle->dec_w_cb != decoderWriteByte ||
+      handle->buffer_len <= handle->frame_info.buffer_index) {
+    return 0;
+  }
+
+  room = handle->buffer_len - handle->frame_info.buffer_index;
+  run = AhdlcScanSpecial(raw_data, length < room ? length : room);
+
+  if (handle->crc_mode == DECODE_CRC_PER_BYTE) {
+    crc = decoderGetCurrentCRC(handle);
+    i = 0;
+    if (run >= CRC_ARRAY_SIZE) {
+      /* Only the last CRC_ARRAY_SIZE values are observable in the ring.
+       * Rewind the index so the pushes below land where run single pushes
+       * would. */
+      i = run - (CRC_ARRAY_SIZE - 1);
+      stack->crc_index = (uint8_t)((stack->crc_index + run) % CRC_ARRAY_SIZE);
+      crc.crc_value = handle->crc_cb(crc.crc_value, raw_data, i);
+      decoderPushCRC(stack, crc.crc_value);
+      AHDLC_INSTR(++handle->stats.crc_calc_callback_cnt);
+    }
+
+    for (; i < run; ++i) {
+      crc.crc_value = handle->crc_cb(crc.crc_value, &raw_data[i], 1);
+      decoderPushCRC(stack, crc.crc_value);
+      AHDLC_INSTR(++handle->stats.crc_calc_callback_cnt);
+    }
+  }
+
+  /* When decoding in place the run may already be where it belongs */
+  dst = &handle->pdu_buffer[handle->frame_info.buffer_index];
+  if (dst != raw_data) {
+    memmove(dst, raw_data, run);
+  }
+  handle->frame_info.buffer_index += run;
+
+  return run;
+}
+
+/*
+ * Skips what is left of a frame the decoder lost sync in, up to the next
+ * frame_marker, which the byte path then takes. Returns the number of bytes
+ * skipped.
+ */
+static uint32_t decoderHunt(ahdlc_frame_decoder_t *handle,
+                            const uint8_t *raw_data, uint32_t length) {
+  const uint8_t *marker;
+  uint32_t skipped;
+
+  if (handle->dfa_state != DECODE_DFA_HUNT) {
+    return 0;
+  }
+
+  marker = (const uint8_t*)memchr(raw_data, frame_marker, length);
+  skipped = marker ? (uint32_t)(marker - raw_data) : length;
+  handle->stats.resync_discard_byte_cnt += skipped;
+
+  return skipped;
+}
+
+/*
+ * Feeds raw_data to the decoder until a frame completes or the data runs
+ * out. Returns the code of the last DecodeFrameByte() call and sets
+ * *consumed to the number of bytes used.
+ */
+static ahdlc_op_return decoderRun(ahdlc_frame_decoder_t *handle,
+                                  const uint8_t *raw_data, uint32_t length,
+                                  uint32_t *consumed) {
+  ahdlc_op_return code = AHDLC_OK;
+  uint32_t i = 0;
+
+  while (i < length) {
+    uint32_t run = decoderCopyRun(handle, &raw_data[i], length - i);
+    if (!run) {
+      run = decoderHunt(handle, &raw_data[i], length - i);
+    }
+    if (run) {
+      i += run;
+      continue;
+    }
+
+    code = DecodeFrameByte(handle, raw_data[i++]);
     /* stop when we have decoded a packet */
     if (code == AHDLC_COMPLETE) {
       break;
     }
   }
+
+  *consumed = i;
+  return code;
+}
+
+ahdlc_op_return DecoderBuffer(ahdlc_frame_decoder_t *handle, uint8_t *raw_data,
+                              uint32_t buffer_length) {
+  ahdlc_op_return code;
+
+  uint32_t consumed;
+  uint32_t frames_decoded = handle->stats.good_frame_cnt;
+
+  /* scan over buffer and find a packet then stop */
+  code = decoderRun(handle, raw_data, buffer_length, &consumed);
+
   /* if we did not decode a frame return error */
   if (frames_decoded == handle->stats.good_frame_cnt) {
     code = AHDLC_ERROR;
@@ -180,109 +842,453 @@ ahdlc_op_return DecoderBuffer(ahdlc_frame_decoder_t *handle, uint8_t *raw_data,
   return code;
 }
 
-ahdlc_op_return DecodeFrameByte(ahdlc_frame_decoder_t *handle,
-                                uint8_t raw_byte) {
+ahdlc_op_return DecoderBufferNext(ahdlc_frame_decoder_t *handle,
+    const uint8_t *buffer, uint32_t buffer_length, uint32_t *offset,
+    ahdlc_decoded_frame_t *frame) {
+  uint32_t consumed;
+
+  if (*offset > buffer_length) {
+    return AHDLC_ERROR;
+  }
+
+  if (decoderRun(handle, &buffer[*offset], buffer_length - *offset,
+                 &consumed) != AHDLC_COMPLETE) {
+    *offset = buffer_length;
+    return AHDLC_OK;
+  }
+
+  *offset += consumed;
+  frame->payload = handle->pdu_buffer;
+  frame->payload_len = handle->frame_info.buffer_index;
+  frame->end_offset = *offset;
+  frame->control_bits = handle->control_bits;
+  frame->sequence = handle->frame_info.sequence;
+  frame->ack_num = handle->frame_info.ack_num;
+
+  return AHDLC_COMPLETE;
+}
+
+/*
+ * Decodes the bytes between two frame markers, plus the closing marker, with
+ * every payload unescaped over its own raw bytes. Unescaping only shrinks
+ * data, so the write position never passes the read position.
+ */
+static ahdlc_op_return decoderInPlaceSegment(ahdlc_frame_decoder_t *handle,
+                                             uint8_t *segment, uint32_t length) {
   ahdlc_op_return code = AHDLC_OK;
-  crc_16_t crc;
-  uint8_t decoded_byte;
-
-   if (raw_byte == frame_marker) {
-     crc_16_t calculated_crc;
-
-    if (handle->reset_on_next_byte) {
-      // TODO (skeys) inc idle frame marker counter
-    } else if (handle->frame_info.buffer_index > min_payload_size) {
-      crc_16_t frame_crc;
-      frame_crc.bytes.low =
-          handle->pdu_buffer[--(handle->frame_info.buffer_index)];
-      frame_crc.bytes.high =
-          handle->pdu_buffer[--(handle->frame_info.buffer_index)];
-
-      calculated_crc = decoderGetFrameCRC(&handle->crc_stack);
-      if (frame_crc.crc_value == calculated_crc.crc_value) {
-        //        printf("Decode complete. Good frame !!!\n");
-        handle->decoder_state = DECODE_COMPLETE_GOOD;
-        ++handle->stats.good_frame_cnt;
-        code = AHDLC_COMPLETE;
-      } else {
-        handle->decoder_state = DECODE_COMPLETE_BAD_CRC;
-        ++handle->stats.num_decoded_bad_crc;
-        code = AHDLC_ERROR;
-      }
-    } else {
-      ++handle->stats.frame_too_small_cnt;
+  uint32_t i = 0;
+
+  while (i < length) {
+    uint32_t run = decoderCopyRun(handle, &segment[i], length - i);
+    if (!run) {
+      run = decoderHunt(handle, &segment[i], length - i);
+    }
+    if (run) {
+      i += run;
+      continue;
     }
 
-    handle->reset_on_next_byte = 1;
-    return code;
+    ahdlc_decoder_machine_state state = handle->decoder_state;
+    code = DecodeFrameByte(handle, segment[i++]);
+
+    /* Payload starts here, right after the sequence number */
+    if (state != DECODE_EXPECTING_PDU &&
+        handle->decoder_state == DECODE_EXPECTING_PDU) {
+      handle->pdu_buffer = &segment[i];
+      handle->buffer_len = length - i;
+    }
   }
 
-  if (handle->reset_on_next_byte) {
-    memset(&(handle->crc_stack), 0, sizeof(crc_16_stack_t));
-    memset(&(handle->frame_info), 0, sizeof(ahdlc_frame_t));
-    handle->decoder_state = DECODE_EXPECTING_FLAGS;
-    handle->reset_on_next_byte = 0;
-    handle->expecting_escape = 0;
+  return code;
+}
+
+ahdlc_op_return DecodeInPlace(ahdlc_frame_decoder_t *handle, uint8_t *buffer,
+    uint32_t buffer_length, ahdlc_decoded_frame_t *frames, uint32_t max_frames,
+    uint32_t *num_frames, uint32_t *consumed) {
+  uint8_t *saved_pdu_buffer = handle->pdu_buffer;
+  uint32_t saved_buffer_len = handle->buffer_len;
+  decoder_write_callback saved_dec_w_cb = handle->dec_w_cb;
+  uint8_t *saved_lz_scratch = handle->lz_scratch;
+  uint8_t *start;
+  uint32_t pos;
+
+  *num_frames = 0;
+  *consumed = 0;
+  /* A frame opened by the other decode calls cannot be finished in place */
+  if (handle->dfa_state != DECODE_DFA_RESET_PENDING &&
+      handle->dfa_state != DECODE_DFA_HUNT) {
+    return AHDLC_ERROR;
   }
 
-  /* Check to see if we need to process an escaped byte */
-  if (raw_byte == escape_marker) {
-    handle->expecting_escape = 1;
-    return code;
+  start = (uint8_t*)memchr(buffer, frame_marker, buffer_length);
+  pos = start ? (uint32_t)(start - buffer) : buffer_length;
+  /* Skipped as the byte path would, once it has lost sync */
+  if (handle->dfa_state == DECODE_DFA_HUNT) {
+    handle->stats.resync_discard_byte_cnt += pos;
+  } else {
+    handle->stats.out_of_frame_byte_cnt += pos;
+  }
+  if (!start) {
+    *consumed = buffer_length;
+    return AHDLC_OK;
+  }
+
+  handle->dec_w_cb = decoderWriteByte;
+  handle->lz_scratch = NULL;  /* Payloads cannot grow in place */
+  handle->dfa_state = DECODE_DFA_RESET_PENDING;
+
+  while (*num_frames < max_frames) {
+    uint8_t *end = (uint8_t*)memchr(&buffer[pos + 1], frame_marker,
+                                    buffer_length - (pos + 1));
+    uint32_t next;
+
+    if (!end) {
+      break;
+    }
+
+    /* Nothing may be written before the sequence number moves it */
+    handle->pdu_buffer = &buffer[pos + 1];
+    handle->buffer_len = 0;
+    next = (uint32_t)(end - buffer);
+
+    if (decoderInPlaceSegment(handle, &buffer[pos + 1], next - pos)
+        == AHDLC_COMPLETE) {
+      ahdlc_decoded_frame_t *frame = &frames[(*num_frames)++];
+      frame->payload = handle->pdu_buffer;
+      frame->payload_len = handle->frame_info.buffer_index;
+      frame->end_offset = next + 1;
+      frame->control_bits = handle->control_bits;
+      frame->sequence = handle->frame_info.sequence;
+      frame->ack_num = handle->frame_info.ack_num;
+    }
+    pos = next;
+  }
+
+  /* Keep the marker, it opens whatever follows */
+  *consumed = pos;
+  handle->pdu_buffer = saved_pdu_buffer;
+  handle->buffer_len = saved_buffer_len;
+  handle->dec_w_cb = saved_dec_w_cb;
+  handle->lz_scratch = saved_lz_scratch;
+  handle->dfa_state = DECODE_DFA_RESET_PENDING;
+  /* The last frame is in buffer, not pdu_buffer, so there is none to take */
+  handle->decoder_state = DECODE_RESERVED;
+
+  return *num_frames ? AHDLC_COMPLETE : AHDLC_OK;
+}
+
+/* Expands a compressed payload back into pdu_buffer, by way of lz_scratch */
+static ahdlc_op_return decoderExpand(ahdlc_frame_decoder_t *handle) {
+  uint32_t len = handle->frame_info.buffer_index;
+  uint32_t expanded;
+
+  if (len > handle->lz_scratch_len) {
+    return AHDLC_ERROR;
+  }
+  memcpy(handle->lz_scratch, handle->pdu_buffer, len);
+  if (AhdlcLzDecompress(handle->lz_scratch, len, handle->pdu_buffer,
+                        handle->buffer_len, &expanded) != AHDLC_OK ||
+      expanded > UINT16_MAX) {
+    return AHDLC_ERROR;
+  }
+  handle->frame_info.buffer_index = (uint16_t)expanded;
+
+  return AHDLC_OK;
+}
+
+/* Checks the CRC of the frame closed by a frame_marker */
+static ahdlc_op_return decoderFinishFrame(ahdlc_frame_decoder_t *handle) {
+  ahdlc_op_return code = AHDLC_ERROR;
+  crc_16_t frame_crc;
+  crc_16_t calculated_crc;
+  uint8_t good;
+
+  frame_crc.bytes.low =
+      handle->pdu_buffer[--(handle->frame_info.buffer_index)];
+  frame_crc.bytes.high =
+      handle->pdu_buffer[--(handle->frame_info.buffer_index)];
+
+  if (handle->crc_mode == DECODE_CRC_PER_BYTE) {
+    calculated_crc = decoderGetFrameCRC(&handle->crc_stack);
+    good = (frame_crc.crc_value == calculated_crc.crc_value);
+  } else if (handle->decoder_state == DECODE_BUFFER_TOO_SMALL) {
+    /* The tail of the frame, CRC included, never made it to pdu_buffer */
+    good = AHDLC_FALSE;
+  } else {
+    uint8_t header[7];
+    uint32_t header_len = 0;
+    header[header_len++] = handle->control_bits.value;
+    header[header_len++] = handle->frame_info.sequence;
+    if (handle->control_bits.bit.frame_is_ack) {
+      header[header_len++] = handle->frame_info.ack_num;
+    }
+    if (handle->control_bits.bit.frame_is_encrypted) {
+      header[header_len++] = (uint8_t)(handle->frame_info.enc_ctr >> 24);
+      header[header_len++] = (uint8_t)(handle->frame_info.enc_ctr >> 16);
+      header[header_len++] = (uint8_t)(handle->frame_info.enc_ctr >> 8);
+      header[header_len++] = (uint8_t)handle->frame_info.enc_ctr;
+    }
+    calculated_crc.crc_value = handle->crc_cb(initial_crc_value, header,
+                                              header_len);
+    calculated_crc.crc_value = handle->crc_cb(calculated_crc.crc_value,
+        handle->pdu_buffer, handle->frame_info.buffer_index);
+    AHDLC_INSTR(handle->stats.crc_calc_callback_cnt += 2);
+    good = (frame_crc.crc_value == calculated_crc.crc_value);
+  }
+
+  /* The CRC covers the cipher text, so only good frames are decrypted */
+  if (good && handle->control_bits.bit.frame_is_encrypted) {
+    ++handle->stats.encryption_engine_callback_cnt;
+    if (handle->enc_cb(handle->frame_info.enc_ctr, 0, handle->pdu_buffer,
+                       handle->frame_info.buffer_index) != AHDLC_OK) {
+      handle->decoder_state = DECODE_UNIMPLIMENTED;
+      return AHDLC_ERROR;
+    }
+  }
+
+  /* Compression came first when sending, so expanding comes last */
+  if (good && handle->control_bits.bit.frame_is_compressed &&
+      decoderExpand(handle) != AHDLC_OK) {
+    ++handle->stats.decompress_error_cnt;
+    handle->decoder_state = DECODE_BUFFER_TOO_SMALL;
+    return AHDLC_ERROR;
+  }
+
+  if (good) {
+    //        printf("Decode complete. Good frame !!!\n");
+    handle->decoder_state = DECODE_COMPLETE_GOOD;
+    ++handle->stats.good_frame_cnt;
+    code = AHDLC_COMPLETE;
+    /* Ack frames repeat the sequence of the last data frame */
+    if (!handle->control_bits.bit.frame_is_ack) {
+      if (handle->frame_info.sequence !=
+          handle->stats.expected_sequence_number) {
+        ++handle->stats.out_of_sequence_cnt;
+      }
+      handle->stats.expected_sequence_number =
+          (uint8_t)(handle->frame_info.sequence + 1);
+    }
+  } else {
+    handle->decoder_state = DECODE_COMPLETE_BAD_CRC;
+    ++handle->stats.num_decoded_bad_crc;
+  }
+
+  return code;
+}
+
+/* Closes the frame at a frame_marker */
+static ahdlc_op_return decoderEndFrame(ahdlc_frame_decoder_t *handle) {
+  ahdlc_op_return code = AHDLC_OK;
+
+  if (handle->frame_info.buffer_index >= min_payload_size + crc_size) {
+    code = decoderFinishFrame(handle);
+  } else {
+    ++handle->stats.frame_too_small_cnt;
+  }
+
+  if (code == AHDLC_COMPLETE) {
+    AHDLC_INSTR(AhdlcInstrumentFrameEnd(&handle->instr));
   }
+  AHDLC_INSTR(AhdlcDecoderPublishStats(handle));
+
+  handle->dfa_state = DECODE_DFA_RESET_PENDING;
+  return code;
+}
+
+/* Transition table entries: an action in the high nibble, a state below */
+#define DFA_STATE_MASK   (0x0F)
+#define DFA_ACTION_SHIFT (4)
+#define DFA(action, state) \
+  (uint8_t)(((action) << DFA_ACTION_SHIFT) | DECODE_DFA_##state)
+
+/* Ordered so that one compare separates the data bytes from the rest */
+typedef enum {
+  DFA_DATA,        /* Decoded byte for the state given */
+  DFA_UNESCAPE,    /* As DFA_DATA, with the escape undone */
+  DFA_MOVE,        /* Only change state */
+  DFA_RESET_DATA,  /* Start a new frame, then DFA_DATA */
+  DFA_RESET_MOVE,  /* Start a new frame, then DFA_MOVE */
+  DFA_END,         /* frame_marker closing a frame */
+  DFA_BAD_ESCAPE,  /* escape_marker followed by an invalid byte */
+  DFA_SKIP         /* Byte dropped while hunting for a frame_marker */
+}decoder_dfa_action;
+
+typedef enum {
+  DFA_BYTE_DATA,
+  DFA_BYTE_MARKER,
+  DFA_BYTE_ESCAPE,
+  DFA_BYTE_ESCAPED,  /* escaped_start or escaped_escape */
+  DFA_BYTE_CLASSES
+}decoder_dfa_byte_class;
 
-  decoded_byte = raw_byte;
+/* Escaped bytes differ from what they stand for in this bit only */
+#define DFA_UNESCAPE_MASK (0x20)
 
-  /* Potentially extract an escaped value */
-  if (handle->expecting_escape) {
-    handle->expecting_escape = 0;
+/* frame_marker, escape_marker, escaped_start and escaped_escape */
+static const uint8_t decoder_dfa_class[256] = {
+  [0x7E] = DFA_BYTE_MARKER,
+  [0x7D] = DFA_BYTE_ESCAPE,
+  [0x5E] = DFA_BYTE_ESCAPED,
+  [0x5D] = DFA_BYTE_ESCAPED,
+};
 
-    if (raw_byte == escaped_start) {
-      decoded_byte = frame_marker;
-    } else if (raw_byte == escaped_escape) {
-      decoded_byte = escape_marker;
-    } else {
+#define DFA_ROW(state) { \
+  DFA(DFA_DATA, state), DFA(DFA_END, RESET_PENDING), \
+  DFA(DFA_MOVE, state##_ESCAPE), DFA(DFA_DATA, state) }
+#define DFA_ESCAPE_ROW(state) { \
+  DFA(DFA_BAD_ESCAPE, HUNT), DFA(DFA_END, RESET_PENDING), \
+  DFA(DFA_MOVE, state##_ESCAPE), DFA(DFA_UNESCAPE, state) }
+
+static const uint8_t decoder_dfa[DECODE_DFA_STATES][DFA_BYTE_CLASSES] = {
+  [DECODE_DFA_RESET_PENDING] = {
+    DFA(DFA_RESET_DATA, FLAGS), DFA(DFA_MOVE, RESET_PENDING),
+    DFA(DFA_RESET_MOVE, FLAGS_ESCAPE), DFA(DFA_RESET_DATA, FLAGS) },
+  [DECODE_DFA_FLAGS]             = DFA_ROW(FLAGS),
+  [DECODE_DFA_FLAGS_ESCAPE]      = DFA_ESCAPE_ROW(FLAGS),
+  [DECODE_DFA_SEQUENCE]          = DFA_ROW(SEQUENCE),
+  [DECODE_DFA_SEQUENCE_ESCAPE]   = DFA_ESCAPE_ROW(SEQUENCE),
+  [DECODE_DFA_PDU]               = DFA_ROW(PDU),
+  [DECODE_DFA_PDU_ESCAPE]        = DFA_ESCAPE_ROW(PDU),
+  [DECODE_DFA_DISCARD]           = DFA_ROW(DISCARD),
+  [DECODE_DFA_DISCARD_ESCAPE]    = DFA_ESCAPE_ROW(DISCARD),
+  [DECODE_DFA_ACK_NUM]           = DFA_ROW(ACK_NUM),
+  [DECODE_DFA_ACK_NUM_ESCAPE]    = DFA_ESCAPE_ROW(ACK_NUM),
+  [DECODE_DFA_ENC_CTR]           = DFA_ROW(ENC_CTR),
+  [DECODE_DFA_ENC_CTR_ESCAPE]    = DFA_ESCAPE_ROW(ENC_CTR),
+  [DECODE_DFA_HUNT] = {
+    DFA(DFA_SKIP, HUNT), DFA(DFA_MOVE, RESET_PENDING),
+    DFA(DFA_SKIP, HUNT), DFA(DFA_SKIP, HUNT) },
+};
+
+/* Decodes one byte, running crc_fn over it */
+static AHDLC_ALWAYS_INLINE ahdlc_op_return decoderByte(
+    ahdlc_frame_decoder_t *handle, uint8_t raw_byte, crc_callback crc_fn) {
+  ahdlc_op_return code = AHDLC_OK;
+  uint8_t entry =
+      decoder_dfa[handle->dfa_state][decoder_dfa_class[raw_byte]];
+  uint8_t state = entry & DFA_STATE_MASK;
+  uint8_t decoded_byte = raw_byte;
+  uint8_t action = entry >> DFA_ACTION_SHIFT;
+  crc_16_t crc;
+
+  if (action > DFA_UNESCAPE) {
+    if (action == DFA_MOVE) {
+      handle->dfa_state = state;
+      return code;
+    }
+    if (action == DFA_SKIP) {
+      ++handle->stats.resync_discard_byte_cnt;
+      return code;
+    }
+    if (action == DFA_END) {
+      return decoderEndFrame(handle);
+    }
+    if (action == DFA_BAD_ESCAPE) {
       ++handle->stats.invalid_escape_cnt;
       handle->decoder_state = DECODE_INVALID_ESCAPE_SEQ;
-      handle->reset_on_next_byte = 1;
-      code = AHDLC_ERROR;
+      handle->dfa_state = state;
+      AHDLC_INSTR(AhdlcDecoderPublishStats(handle));
+      return AHDLC_ERROR;
+    }
+
+    /* DFA_RESET_DATA or DFA_RESET_MOVE */
+    AHDLC_INSTR(AhdlcInstrumentFrameStart(&handle->instr));
+    memset(&(handle->crc_stack), 0, sizeof(crc_16_stack_t));
+    memset(&(handle->frame_info), 0, sizeof(ahdlc_frame_t));
+    handle->decoder_state = DECODE_EXPECTING_FLAGS;
+    handle->dfa_state = state;
+    if (action == DFA_RESET_MOVE) {
       return code;
     }
+  } else if (action == DFA_UNESCAPE) {
+    decoded_byte ^= DFA_UNESCAPE_MASK;
+    handle->dfa_state = state;
+  }
+
+  /* Add CRC, unless it is deferred to the end of the frame */
+  if (handle->crc_mode == DECODE_CRC_PER_BYTE) {
+    crc = decoderGetCurrentCRC(handle);
+    crc.crc_value = crc_fn(crc.crc_value, &decoded_byte,
+                           sizeof(decoded_byte));
+    decoderPushCRC(&(handle->crc_stack), crc.crc_value);
+    AHDLC_INSTR(++handle->stats.crc_calc_callback_cnt);
   }
 
-  /* Add CRC */
-  /* TODO (skeys) instead of calling and caching the CRC we can just cache
-   * a couple bytes and process the cache when we see a frame marker. */
-  crc = decoderGetCurrentCRC(handle);
-  crc.crc_value = handle->crc_cb(crc.crc_value, &decoded_byte, sizeof(decoded_byte));
-  decoderPushCRC(&(handle->crc_stack), crc.crc_value);
+  /* Run the decoded byte though the frame fields */
+  if (state == DECODE_DFA_PDU) {
+    code = handle->dec_w_cb(handle, decoded_byte);
+    if (handle->decoder_state != DECODE_EXPECTING_PDU) {
+      handle->dfa_state = DECODE_DFA_DISCARD;
+    }
+    return code;
+  }
 
-  /* Run escaped byte though the state machine */
-  switch (handle->decoder_state) {
-    case DECODE_EXPECTING_SEQUENCE:
+  switch (state) {
+    case DECODE_DFA_SEQUENCE:
       handle->frame_info.sequence = decoded_byte;
+      if (handle->control_bits.bit.frame_is_ack) {
+        handle->decoder_state = DECODE_EXPECTING_ACK_NUM;
+        handle->dfa_state = DECODE_DFA_ACK_NUM;
+        break;
+      }
+      if (handle->control_bits.bit.frame_is_encrypted) {
+        handle->decoder_state = DECODE_EXPECTING_ENC_CTR;
+        handle->dfa_state = DECODE_DFA_ENC_CTR;
+        break;
+      }
+      handle->decoder_state = DECODE_EXPECTING_PDU;
+      handle->dfa_state = DECODE_DFA_PDU;
+      break;
+    case DECODE_DFA_ENC_CTR:
+      handle->frame_info.enc_ctr = (handle->frame_info.enc_ctr << 8) |
+                                   decoded_byte;
+      if (++handle->frame_info.enc_ctr_bytes ==
+          sizeof(handle->frame_info.enc_ctr)) {
+        handle->decoder_state = DECODE_EXPECTING_PDU;
+        handle->dfa_state = DECODE_DFA_PDU;
+      }
+      break;
+    case DECODE_DFA_ACK_NUM:
+      handle->frame_info.ack_num = decoded_byte;
       handle->decoder_state = DECODE_EXPECTING_PDU;
+      handle->dfa_state = DECODE_DFA_PDU;
       break;
-    case DECODE_EXPECTING_FLAGS:
+    case DECODE_DFA_FLAGS:
       handle->control_bits.value = decoded_byte;
-      handle->reset_on_next_byte = AHDLC_TRUE;  /*  Default to error */
+      handle->dfa_state = DECODE_DFA_HUNT;  /*  Default to error */
       if (!handle->control_bits.bit.frame_valid) {
         code = AHDLC_INVALID_FRAME;
-      } else if (handle->control_bits.bit.frame_is_ack
-          || handle->control_bits.bit.frame_is_encrypted) {
-        code = AHDLC_CRC_ENGINE_FAILURE;  /* Unimplemented */
+      } else if (handle->control_bits.bit.frame_is_encrypted &&
+                 (handle->control_bits.bit.frame_is_ack || !handle->enc_cb)) {
+        code = AHDLC_CRC_ENGINE_FAILURE;  /* No cipher for it */
+      } else if (handle->control_bits.bit.frame_is_compressed &&
+                 !handle->lz_scratch) {
+        code = AHDLC_CRC_ENGINE_FAILURE;  /* Nowhere to expand it */
       } else {
         handle->decoder_state = DECODE_EXPECTING_SEQUENCE;
-        handle->reset_on_next_byte = AHDLC_FALSE;
+        handle->dfa_state = DECODE_DFA_SEQUENCE;
       }
       break;
-    case DECODE_EXPECTING_PDU:
-      code = handle->dec_w_cb(handle, decoded_byte);
-      break;
     default:
+      handle->dfa_state = DECODE_DFA_DISCARD;
       code = AHDLC_CRC_ENGINE_FAILURE;  /* Unimplemented */
       break;
   }
 
   return code;
 }
+
+ahdlc_op_return DecodeFrameByte(ahdlc_frame_decoder_t *handle,
+                                uint8_t raw_byte) {
+  return decoderByte(handle, raw_byte, handle->crc_cb);
+}
+
+ahdlc_op_return DecodeFrameByteCRC16(ahdlc_frame_decoder_t *handle,
+                                     uint8_t raw_byte) {
+  return decoderByte(handle, raw_byte, crc16Kernel);
+}
+
+ahdlc_op_return DecodeFrameByteCRC16CCITT(ahdlc_frame_decoder_t *handle,
+                                          uint8_t raw_byte) {
+  return decoderByte(handle, raw_byte, crc16CcittKernel);
+}
@@ -0,0 +1,95 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "inc/frame_pool.h"
+
+#include <stddef.h>
+
+ahdlc_op_return AhdlcFramePoolInit(ahdlc_frame_pool_t *pool,
+    uint8_t *storage, uint32_t storage_len, uint32_t slot_size) {
+  uint32_t num_slots = slot_size ? storage_len / slot_size : 0;
+
+  /* Slots become pdu_buffer, which buffer_index addresses in 16 bits */
+  if (slot_size > UINT16_MAX) {
+    return AHDLC_ERROR;
+  }
+  if (!storage || !num_slots) {
+    return AHDLC_BUFFER_TOO_SMALL;
+  }
+  if (num_slots > AHDLC_FRAME_POOL_MAX_SLOTS) {
+    num_slots = AHDLC_FRAME_POOL_MAX_SLOTS;
+  }
+
+  pool->storage = storage;
+  pool->slot_size = slot_size;
+  pool->num_slots = num_slots;
+  pool->stats.alloc_cnt = 0;
+  pool->stats.exhausted_cnt = 0;
+  pool->stats.min_free = num_slots;
+  ahdlcStoreRelease(&pool->free_map, (num_slots == 32) ?
+                    0xFFFFFFFFu : (1u << num_slots) - 1);
+
+  return AHDLC_OK;
+}
+
+uint8_t *AhdlcFramePoolAlloc(ahdlc_frame_pool_t *pool) {
+  uint32_t map = ahdlcLoadAcquire(&pool->free_map);
+  uint32_t slot;
+  uint32_t left;
+
+  /* Lowest free slot, retried if a free lands in between */
+  do {
+    if (!map) {
+      ++pool->stats.exhausted_cnt;
+      return NULL;
+    }
+    slot = (uint32_t)__builtin_ctz(map);
+  } while (!ahdlcCompareExchange(&pool->free_map, &map,
+                                 map & ~(1u << slot)));
+
+  ++pool->stats.alloc_cnt;
+  left = (uint32_t)__builtin_popcount(map) - 1;
+  if (left < pool->stats.min_free) {
+    pool->stats.min_free = left;
+  }
+
+  return &pool->storage[slot * pool->slot_size];
+}
+
+ahdlc_op_return AhdlcFramePoolFree(ahdlc_frame_pool_t *pool, uint8_t *slot) {
+  uint32_t offset;
+  uint32_t bit;
+
+  if (slot < pool->storage) {
+    return AHDLC_ERROR;
+  }
+  offset = (uint32_t)(slot - pool->storage);
+  if (offset % pool->slot_size ||
+      offset / pool->slot_size >= pool->num_slots) {
+    return AHDLC_ERROR;
+  }
+
+  bit = 1u << (offset / pool->slot_size);
+  if (ahdlcFetchOr(&pool->free_map, bit) & bit) {
+    /* Already free */
+    return AHDLC_ERROR;
+  }
+
+  return AHDLC_OK;
+}
+
+uint32_t AhdlcFramePoolAvailable(ahdlc_frame_pool_t *pool) {
+  return (uint32_t)__builtin_popcount(ahdlcLoadAcquire(&pool->free_map));
+}
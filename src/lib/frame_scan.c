@@ -0,0 +1,94 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "inc/frame_scan.h"
+
+#include <string.h>
+
+#include "inc/frame_layer.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if !defined(__SSE2__)
+/* Word-at-a-time helpers, used where no vector unit is available */
+#define SCAN_ONES  (0x01010101u)
+#define SCAN_HIGHS (0x80808080u)
+
+static inline uint32_t scanHasZeroByte(uint32_t word) {
+  return (word - SCAN_ONES) & ~word & SCAN_HIGHS;
+}
+#endif
+
+uint32_t AhdlcScanSpecial(const uint8_t *buffer, uint32_t length) {
+  uint32_t i = 0;
+
+#if defined(__AVX2__)
+  {
+    const __m256i flag = _mm256_set1_epi8((char)frame_marker);
+    const __m256i esc = _mm256_set1_epi8((char)escape_marker);
+
+    for (; i + 32 <= length; i += 32) {
+      __m256i block = _mm256_loadu_si256((const __m256i*)(buffer + i));
+      uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(
+          _mm256_cmpeq_epi8(block, flag), _mm256_cmpeq_epi8(block, esc)));
+      if (mask) {
+        return i + (uint32_t)__builtin_ctz(mask);
+      }
+    }
+  }
+#endif
+
+#if defined(__SSE2__)
+  {
+    const __m128i flag = _mm_set1_epi8((char)frame_marker);
+    const __m128i esc = _mm_set1_epi8((char)escape_marker);
+
+    for (; i + 16 <= length; i += 16) {
+      __m128i block = _mm_loadu_si128((const __m128i*)(buffer + i));
+      uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(
+          _mm_cmpeq_epi8(block, flag), _mm_cmpeq_epi8(block, esc)));
+      if (mask) {
+        return i + (uint32_t)__builtin_ctz(mask);
+      }
+    }
+  }
+#else
+  {
+    const uint32_t flag = SCAN_ONES * frame_marker;
+    const uint32_t esc = SCAN_ONES * escape_marker;
+
+    for (; i + sizeof(uint32_t) <= length; i += sizeof(uint32_t)) {
+      uint32_t word;
+      memcpy(&word, buffer + i, sizeof(word));
+      if (scanHasZeroByte(word ^ flag) || scanHasZeroByte(word ^ esc)) {
+        break;
+      }
+    }
+  }
+#endif
+
+  /* Tail, or the word holding the first special byte */
+  for (; i < length; ++i) {
+    if (buffer[i] == frame_marker || buffer[i] == escape_marker) {
+      break;
+    }
+  }
+
+  return i;
+}
@@ -0,0 +1,132 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef LIB_INC_AHDLC_ATOMIC_H_
+#define LIB_INC_AHDLC_ATOMIC_H_
+
+#include <stdint.h>
+
+/*
+ * Shared between a producer and a consumer, e.g. an ISR and the main loop.
+ * C11 builds of the library use <stdatomic.h>; MCU builds without it, or
+ * with AHDLC_ATOMIC_BARRIER defined, use plain loads and stores around
+ * AHDLC_ATOMIC_FENCE() and the __sync builtins. C++ and pre-C11 users only
+ * pass these around and see a volatile word of the same size.
+ */
+#if !defined(__cplusplus) && !defined(AHDLC_ATOMIC_BARRIER) && \
+    defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && \
+    !defined(__STDC_NO_ATOMICS__)
+#define AHDLC_C11_ATOMICS (1)
+typedef _Atomic uint32_t ahdlc_atomic_u32_t;
+#else
+typedef volatile uint32_t ahdlc_atomic_u32_t;
+#endif
+
+#ifndef __cplusplus
+#if defined(AHDLC_C11_ATOMICS)
+#include <stdatomic.h>
+
+static inline uint32_t ahdlcLoadRelaxed(ahdlc_atomic_u32_t *word) {
+  return atomic_load_explicit(word, memory_order_relaxed);
+}
+
+static inline uint32_t ahdlcLoadAcquire(ahdlc_atomic_u32_t *word) {
+  return atomic_load_explicit(word, memory_order_acquire);
+}
+
+static inline void ahdlcStoreRelease(ahdlc_atomic_u32_t *word,
+                                     uint32_t value) {
+  atomic_store_explicit(word, value, memory_order_release);
+}
+
+static inline void ahdlcStoreRelaxed(ahdlc_atomic_u32_t *word,
+                                     uint32_t value) {
+  atomic_store_explicit(word, value, memory_order_relaxed);
+}
+
+/* Orders the plain or relaxed accesses around it, as a seqlock needs */
+static inline void ahdlcFenceAcquire(void) {
+  atomic_thread_fence(memory_order_acquire);
+}
+
+static inline void ahdlcFenceRelease(void) {
+  atomic_thread_fence(memory_order_release);
+}
+
+/* Returns the previous value */
+static inline uint32_t ahdlcFetchOr(ahdlc_atomic_u32_t *word,
+                                    uint32_t bits) {
+  return atomic_fetch_or_explicit(word, bits, memory_order_acq_rel);
+}
+
+/* On failure *expected is updated to the current value */
+static inline int ahdlcCompareExchange(ahdlc_atomic_u32_t *word,
+                                       uint32_t *expected, uint32_t desired) {
+  return atomic_compare_exchange_weak_explicit(word, expected, desired,
+      memory_order_acq_rel, memory_order_acquire);
+}
+#else
+/* Ports may swap in e.g. __DMB(); a compiler barrier is enough on a
+ * single core where the other side is an ISR. */
+#ifndef AHDLC_ATOMIC_FENCE
+#define AHDLC_ATOMIC_FENCE() __sync_synchronize()
+#endif
+
+static inline uint32_t ahdlcLoadRelaxed(ahdlc_atomic_u32_t *word) {
+  return *word;
+}
+
+static inline uint32_t ahdlcLoadAcquire(ahdlc_atomic_u32_t *word) {
+  uint32_t value = *word;
+  AHDLC_ATOMIC_FENCE();
+  return value;
+}
+
+static inline void ahdlcStoreRelease(ahdlc_atomic_u32_t *word,
+                                     uint32_t value) {
+  AHDLC_ATOMIC_FENCE();
+  *word = value;
+}
+
+static inline void ahdlcStoreRelaxed(ahdlc_atomic_u32_t *word,
+                                     uint32_t value) {
+  *word = value;
+}
+
+static inline void ahdlcFenceAcquire(void) {
+  AHDLC_ATOMIC_FENCE();
+}
+
+static inline void ahdlcFenceRelease(void) {
+  AHDLC_ATOMIC_FENCE();
+}
+
+static inline uint32_t ahdlcFetchOr(ahdlc_atomic_u32_t *word,
+                                    uint32_t bits) {
+  return __sync_fetch_and_or(word, bits);
+}
+
+static inline int ahdlcCompareExchange(ahdlc_atomic_u32_t *word,
+                                       uint32_t *expected, uint32_t desired) {
+  uint32_t previous = __sync_val_compare_and_swap(word, *expected, desired);
+  int swapped = (previous == *expected);
+
+  *expected = previous;
+  return swapped;
+}
+#endif
+#endif /* __cplusplus */
+
+#endif /* LIB_INC_AHDLC_ATOMIC_H_ */
@@ -0,0 +1,138 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef LIB_INC_ARQ_H_
+#define LIB_INC_ARQ_H_
+
+#include <stdint.h>
+
+#include "frame_layer_types.h"
+
+/*
+ * Sliding window reliable delivery over aHDLC frames.
+ *
+ * Data frames have ack_requested set and are numbered by their sequence.
+ * The receiver answers each one with an ack frame (frame_is_ack): ack_num is
+ * the next sequence it expects, so everything before it is acknowledged,
+ * and an optional 4 byte little-endian payload marks frames after ack_num
+ * it already holds (bit i for ack_num + 1 + i). Senders keep a copy of each
+ * frame until it is acknowledged and resend it when its timer, run off the
+ * caller's clock, expires. Receivers hold frames that arrive early and
+ * deliver in order.
+ */
+
+/* Window sizes are powers of two up to this, one bitmap bit per frame */
+#define AHDLC_ARQ_MAX_WINDOW (32)
+
+/* Bytes of the selective ack bitmap */
+#define AHDLC_ARQ_SACK_SIZE (4)
+
+/* Worst case encoded frame: markers plus every byte escaped */
+#define AHDLC_ARQ_ENCODED_SIZE(max_payload) \
+  (2 + 2 * (3 + ((max_payload) > AHDLC_ARQ_SACK_SIZE ? \
+                 (max_payload) : AHDLC_ARQ_SACK_SIZE) + 2))
+
+/* Largest max_payload whose worst case frame fits the 16 bit buffer_index */
+#define AHDLC_ARQ_MAX_PAYLOAD ((UINT16_MAX - 2) / 2 - 5)
+
+/* Storage AhdlcArqInit() needs: send and receive copies and the encoder */
+#define AHDLC_ARQ_STORAGE_SIZE(window, max_payload) \
+  (2 * (window) * (max_payload) + AHDLC_ARQ_ENCODED_SIZE(max_payload))
+
+/* Milliseconds from any free running clock, wrapping is fine */
+typedef uint32_t (*arq_clock_callback)(void *ctx);
+
+/* Payloads in sequence order, valid for the duration of the call */
+typedef void (*arq_deliver_callback)(void *ctx, const uint8_t *payload,
+    uint32_t len);
+
+typedef struct {
+  uint32_t window;         /* Frames in flight, power of two */
+  uint32_t max_payload;    /* At most AHDLC_ARQ_MAX_PAYLOAD */
+  uint32_t retransmit_ms;  /* Time without an ack before a frame is resent */
+  uint32_t max_retries;    /* Resends per frame, 0 for no limit */
+  crc_callback crc_cb;
+  encoder_sink_callback send_cb;  /* Takes one encoded frame per call */
+  arq_deliver_callback deliver_cb;
+  arq_clock_callback clock_cb;
+  void *ctx;               /* Passed to all of the callbacks */
+}ahdlc_arq_config_t;
+
+typedef struct {
+  uint32_t frames_sent;
+  uint32_t retransmit_cnt;
+  uint32_t retry_exhausted_cnt;  /* Timeouts after the last allowed resend */
+  uint32_t acks_sent;
+  uint32_t acks_received;
+  uint32_t stale_ack_cnt;       /* ack_num outside the frames in flight */
+  uint32_t frames_delivered;
+  uint32_t duplicate_cnt;       /* Data frames received more than once */
+  uint32_t out_of_window_cnt;   /* Data frames too far ahead to hold */
+}ahdlc_arq_stats;
+
+typedef struct {
+  ahdlc_arq_config_t config;
+  ahdlc_frame_encoder_t encoder;
+  uint8_t *tx_payloads;    /* window slots of max_payload, by sequence */
+  uint8_t *rx_payloads;
+  uint32_t tx_sent_ms[AHDLC_ARQ_MAX_WINDOW];
+  uint16_t tx_len[AHDLC_ARQ_MAX_WINDOW];
+  uint16_t rx_len[AHDLC_ARQ_MAX_WINDOW];
+  uint8_t tx_retries[AHDLC_ARQ_MAX_WINDOW];
+  uint32_t tx_acked;       /* Slots selectively acked, bit per slot */
+  uint32_t rx_held;        /* Slots holding an early frame */
+  uint8_t tx_base;         /* Oldest unacknowledged sequence */
+  uint8_t tx_next;         /* Sequence of the next new frame */
+  uint8_t rx_next;         /* Next sequence to deliver */
+  ahdlc_arq_stats stats;
+}ahdlc_arq_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* storage_len must be at least AHDLC_ARQ_STORAGE_SIZE() */
+ahdlc_op_return AhdlcArqInit(ahdlc_arq_t *handle,
+    const ahdlc_arq_config_t *config, uint8_t *storage, uint32_t storage_len);
+
+/*
+ * Sends payload as a new frame. Returns AHDLC_BUFFER_TOO_SMALL, without
+ * sending, while the window is full, AHDLC_ERROR if len is over
+ * max_payload.
+ */
+ahdlc_op_return AhdlcArqSend(ahdlc_arq_t *handle, const uint8_t *payload,
+    uint32_t len);
+
+/*
+ * Takes every frame decoded from the link. Acks free the window, data frames
+ * are delivered or held and answered with an ack.
+ */
+ahdlc_op_return AhdlcArqReceive(ahdlc_arq_t *handle,
+    const ahdlc_decoded_frame_t *frame);
+
+/*
+ * Resends frames whose timer expired; call periodically. Returns AHDLC_ERROR
+ * once a frame has been resent max_retries times without an ack.
+ */
+ahdlc_op_return AhdlcArqPoll(ahdlc_arq_t *handle);
+
+/* Frames sent but not yet acknowledged */
+uint32_t AhdlcArqInFlight(const ahdlc_arq_t *handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIB_INC_ARQ_H_ */
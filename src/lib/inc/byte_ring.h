@@ -0,0 +1,74 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef LIB_INC_BYTE_RING_H_
+#define LIB_INC_BYTE_RING_H_
+
+#include <stdint.h>
+
+#include "ahdlc_atomic.h"
+#include "frame_layer_types.h"
+
+/* Indices are only written by one side each */
+typedef ahdlc_atomic_u32_t ahdlc_ring_index_t;
+
+/*
+ * Single producer, single consumer byte ring, e.g. a UART ISR or reader
+ * thread feeding the decoder. Indices run freely and are masked with
+ * size - 1. The producer never blocks: bytes that do not fit are dropped
+ * and counted.
+ */
+typedef struct {
+  uint8_t *buffer;
+  uint32_t size;                 /* Power of two */
+  ahdlc_ring_index_t head;       /* Written by the producer only */
+  ahdlc_ring_index_t tail;       /* Written by the consumer only */
+  uint32_t high_water;           /* Most bytes ever held, producer side */
+  uint32_t overflow_cnt;         /* Bytes dropped because the ring was full */
+}ahdlc_byte_ring_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* size must be a power of two */
+ahdlc_op_return AhdlcRingInit(ahdlc_byte_ring_t *ring, uint8_t *buffer,
+    uint32_t size);
+
+/* Producer side. Returns the number of bytes stored, the rest is dropped */
+uint32_t AhdlcRingWrite(ahdlc_byte_ring_t *ring, const uint8_t *data,
+    uint32_t len);
+ahdlc_op_return AhdlcRingPutByte(ahdlc_byte_ring_t *ring, uint8_t byte);
+
+/* Consumer side. Bytes held right now */
+uint32_t AhdlcRingFill(ahdlc_byte_ring_t *ring);
+/* Points *data at the oldest bytes, returning how many are contiguous */
+uint32_t AhdlcRingPeek(ahdlc_byte_ring_t *ring, const uint8_t **data);
+/* Frees len bytes returned by AhdlcRingPeek() */
+void AhdlcRingConsume(ahdlc_byte_ring_t *ring, uint32_t len);
+
+/*
+ * Decodes straight out of the ring with DecoderBufferNext(), consuming
+ * bytes as they are decoded. Returns AHDLC_COMPLETE with frame filled in,
+ * or AHDLC_OK once the ring is empty; a partial frame stays in the decoder.
+ */
+ahdlc_op_return AhdlcRingDecodeNext(ahdlc_byte_ring_t *ring,
+    ahdlc_frame_decoder_t *decoder, ahdlc_decoded_frame_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIB_INC_BYTE_RING_H_ */
@@ -22,8 +22,26 @@
 extern "C" {
 #endif
 
+/* Tables behind CRC16() and CRC16CCITT(), for kernels inlined elsewhere
+ * with AHDLC_CRC16_DEFINE_UPDATE(), see crc_16_gen.h. */
+extern const uint16_t crc16_tbl[256];
+extern const uint16_t crc16_ccitt_tbl[256];
+
 uint16_t CRC16(uint16_t crc, const uint8_t *buf, uint32_t len);
 
+/* Same result as CRC16(), handling CRC16_SLICE_BY bytes per loop iteration.
+ * The slice count is fixed at build time, see crc_16.c. */
+uint16_t CRC16Sliced(uint16_t crc, const uint8_t *buf, uint32_t len);
+
+/* Same result as CRC16(). Large buffers are XOR folded into 17 bytes first,
+ * see crc_16.c, so they run at memory bandwidth on any CPU. */
+uint16_t CRC16Folded(uint16_t crc, const uint8_t *buf, uint32_t len);
+
+/* CRC-16/CCITT as used by RFC 1662, for peers that expect it. The RFC seeds
+ * the FCS with 0xFFFF and sends its complement; the frame layer seeds with
+ * initial_crc_value and sends it as is, like CRC16(). */
+uint16_t CRC16CCITT(uint16_t crc, const uint8_t *buf, uint32_t len);
+
 #ifdef __cplusplus
 }
 #endif
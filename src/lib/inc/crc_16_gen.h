@@ -0,0 +1,122 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef LIB_INC_CRC_16_GEN_H_
+#define LIB_INC_CRC_16_GEN_H_
+
+#include <stdint.h>
+
+/*
+ * Compile time CRC16 kernels for any polynomial.
+ *
+ *   AHDLC_CRC16_DEFINE_KERNEL(name, poly, table, update)
+ *
+ * defines a static table name##_tbl[256], built by the preprocessor, and
+ *
+ *   static inline uint16_t name(uint16_t crc, const uint8_t *buf,
+ *                               uint32_t len);
+ *
+ * which matches crc_callback, so passing it where a compile time constant
+ * callback is expected lets the compiler inline the whole kernel. Each use
+ * adds a 512 byte table; AHDLC_CRC16_DEFINE_UPDATE() inlines a kernel over
+ * a table that already exists instead.
+ *
+ * table is REFLECTED (poly given bit reversed, e.g. 0xA001 for 0x8005 or
+ * 0x8408 for the CCITT 0x1021) or NORMAL (poly as is). update is HIGH when
+ * the top byte of the register indexes the table, as CRC16() does, or LOW
+ * when the bottom byte does, as the RFC 1662 FCS-16 does.
+ *
+ * A table entry is linear in its index, so only the eight single bit
+ * entries are stepped through the polynomial, as enum constants, and every
+ * entry is an XOR of those. Stepping all 256 would expand the index 2^8
+ * times per entry.
+ */
+
+/* One bit of the table generation */
+#define AHDLC_CRC16_STEP_REFLECTED(c, p) \
+  (((c) >> 1) ^ (((c) & 1) ? (p) : 0))
+#define AHDLC_CRC16_STEP_NORMAL(c, p) \
+  ((((c) << 1) & 0xFFFF) ^ (((c) & 0x8000) ? (p) : 0))
+
+#define AHDLC_CRC16_STEP8(step, c, p) \
+  step(step(step(step(step(step(step(step(c, p), p), p), p), p), p), p), p)
+
+/* Table entry for an index with a single bit set */
+#define AHDLC_CRC16_BASIS_REFLECTED(bit, p) \
+  AHDLC_CRC16_STEP8(AHDLC_CRC16_STEP_REFLECTED, (bit), p)
+#define AHDLC_CRC16_BASIS_NORMAL(bit, p) \
+  AHDLC_CRC16_STEP8(AHDLC_CRC16_STEP_NORMAL, ((bit) << 8), p)
+
+/* Register update for one byte */
+#define AHDLC_CRC16_UPDATE_HIGH(tbl, crc, byte) \
+  ((uint16_t)(tbl[(((crc) >> 8) ^ (byte)) & 0xFF] ^ ((crc) << 8)))
+#define AHDLC_CRC16_UPDATE_LOW(tbl, crc, byte) \
+  ((uint16_t)(tbl[((crc) ^ (byte)) & 0xFF] ^ ((crc) >> 8)))
+
+#define AHDLC_CRC16_ENTRY(n, i) \
+  (uint16_t)((((i) & 0x01) ? n##_b0 : 0) ^ (((i) & 0x02) ? n##_b1 : 0) ^ \
+             (((i) & 0x04) ? n##_b2 : 0) ^ (((i) & 0x08) ? n##_b3 : 0) ^ \
+             (((i) & 0x10) ? n##_b4 : 0) ^ (((i) & 0x20) ? n##_b5 : 0) ^ \
+             (((i) & 0x40) ? n##_b6 : 0) ^ (((i) & 0x80) ? n##_b7 : 0))
+
+#define AHDLC_CRC16_ROW(n, i) \
+  AHDLC_CRC16_ENTRY(n, (i) + 0x0), AHDLC_CRC16_ENTRY(n, (i) + 0x1), \
+  AHDLC_CRC16_ENTRY(n, (i) + 0x2), AHDLC_CRC16_ENTRY(n, (i) + 0x3), \
+  AHDLC_CRC16_ENTRY(n, (i) + 0x4), AHDLC_CRC16_ENTRY(n, (i) + 0x5), \
+  AHDLC_CRC16_ENTRY(n, (i) + 0x6), AHDLC_CRC16_ENTRY(n, (i) + 0x7), \
+  AHDLC_CRC16_ENTRY(n, (i) + 0x8), AHDLC_CRC16_ENTRY(n, (i) + 0x9), \
+  AHDLC_CRC16_ENTRY(n, (i) + 0xA), AHDLC_CRC16_ENTRY(n, (i) + 0xB), \
+  AHDLC_CRC16_ENTRY(n, (i) + 0xC), AHDLC_CRC16_ENTRY(n, (i) + 0xD), \
+  AHDLC_CRC16_ENTRY(n, (i) + 0xE), AHDLC_CRC16_ENTRY(n, (i) + 0xF)
+
+#define AHDLC_CRC16_TABLE(n) { \
+  AHDLC_CRC16_ROW(n, 0x00), AHDLC_CRC16_ROW(n, 0x10), \
+  AHDLC_CRC16_ROW(n, 0x20), AHDLC_CRC16_ROW(n, 0x30), \
+  AHDLC_CRC16_ROW(n, 0x40), AHDLC_CRC16_ROW(n, 0x50), \
+  AHDLC_CRC16_ROW(n, 0x60), AHDLC_CRC16_ROW(n, 0x70), \
+  AHDLC_CRC16_ROW(n, 0x80), AHDLC_CRC16_ROW(n, 0x90), \
+  AHDLC_CRC16_ROW(n, 0xA0), AHDLC_CRC16_ROW(n, 0xB0), \
+  AHDLC_CRC16_ROW(n, 0xC0), AHDLC_CRC16_ROW(n, 0xD0), \
+  AHDLC_CRC16_ROW(n, 0xE0), AHDLC_CRC16_ROW(n, 0xF0) }
+
+/* Single bit entries of the table AHDLC_CRC16_TABLE(name) builds */
+#define AHDLC_CRC16_DEFINE_BASIS(name, poly, table) \
+  enum { \
+    name##_b0 = AHDLC_CRC16_BASIS_##table(0x01, poly), \
+    name##_b1 = AHDLC_CRC16_BASIS_##table(0x02, poly), \
+    name##_b2 = AHDLC_CRC16_BASIS_##table(0x04, poly), \
+    name##_b3 = AHDLC_CRC16_BASIS_##table(0x08, poly), \
+    name##_b4 = AHDLC_CRC16_BASIS_##table(0x10, poly), \
+    name##_b5 = AHDLC_CRC16_BASIS_##table(0x20, poly), \
+    name##_b6 = AHDLC_CRC16_BASIS_##table(0x40, poly), \
+    name##_b7 = AHDLC_CRC16_BASIS_##table(0x80, poly) \
+  };
+
+/* Inline kernel over a table defined elsewhere, e.g. exported by crc_16.c */
+#define AHDLC_CRC16_DEFINE_UPDATE(name, tbl, update) \
+  static inline uint16_t name(uint16_t crc, const uint8_t *buf, \
+                              uint32_t len) { \
+    while (len--) { \
+      crc = AHDLC_CRC16_UPDATE_##update(tbl, crc, *buf++); \
+    } \
+    return crc; \
+  }
+
+#define AHDLC_CRC16_DEFINE_KERNEL(name, poly, table, update) \
+  AHDLC_CRC16_DEFINE_BASIS(name, poly, table) \
+  static const uint16_t name##_tbl[256] = AHDLC_CRC16_TABLE(name); \
+  AHDLC_CRC16_DEFINE_UPDATE(name, name##_tbl, update)
+
+#endif /* LIB_INC_CRC_16_GEN_H_ */
@@ -0,0 +1,93 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef LIB_INC_FRAGMENT_H_
+#define LIB_INC_FRAGMENT_H_
+
+#include <stdint.h>
+
+#include "frame_layer_types.h"
+
+/*
+ * Messages larger than one frame are sent as consecutive frames of at most
+ * mtu payload bytes. Every frame but the last has frame_is_continued set,
+ * and the sequence numbers of one message are consecutive, which is how the
+ * reassembler spots a lost fragment.
+ */
+
+/* Walks one message, see AhdlcFragmentNext() */
+typedef struct {
+  const uint8_t *message;
+  uint32_t len;
+  uint32_t offset;
+  uint32_t mtu;
+}ahdlc_fragmenter_t;
+
+typedef struct {
+  uint32_t message_cnt;
+  uint32_t fragment_cnt;
+  uint32_t sequence_gap_cnt;  /* Messages dropped for a missing fragment */
+  uint32_t overflow_cnt;      /* Messages larger than the buffer */
+}ahdlc_reassembly_stats;
+
+typedef struct {
+  uint8_t *buffer;
+  uint32_t buffer_len;
+  uint32_t length;         /* Bytes of the message so far */
+  uint8_t next_sequence;
+  uint8_t state;           /* ahdlc_reassembly_state in fragment.c */
+  ahdlc_reassembly_stats stats;
+}ahdlc_reassembler_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+ahdlc_op_return AhdlcFragmenterInit(ahdlc_fragmenter_t *frag,
+    const uint8_t *message, uint32_t len, uint32_t mtu);
+
+/*
+ * Encodes the next fragment as a complete frame, so in
+ * ENCODE_SEND_BYTE_TO_BUFFER mode frame_buffer only ever holds one fragment.
+ * Returns AHDLC_OK while more follow and AHDLC_COMPLETE after the last.
+ */
+ahdlc_op_return AhdlcFragmentNext(ahdlc_fragmenter_t *frag,
+    ahdlc_frame_encoder_t *handle);
+
+/*
+ * Sends a whole message through the encoder's sink. Not for
+ * ENCODE_SEND_BYTE_TO_BUFFER mode, unless the message fits in one frame.
+ */
+ahdlc_op_return AhdlcEncodeMessage(ahdlc_frame_encoder_t *handle,
+    const uint8_t *message, uint32_t len, uint32_t mtu);
+
+ahdlc_op_return AhdlcReassemblerInit(ahdlc_reassembler_t *reasm,
+    uint8_t *buffer, uint32_t buffer_len);
+
+/*
+ * Adds a decoded frame to the message being built. Returns AHDLC_COMPLETE
+ * with the message in buffer, *message_len bytes long and valid until the
+ * next call, once its last fragment is in. AHDLC_ERROR and
+ * AHDLC_BUFFER_TOO_SMALL report a message dropped for a lost fragment or for
+ * size; the rest of its fragments are skipped. Ack frames are ignored.
+ */
+ahdlc_op_return AhdlcReassemble(ahdlc_reassembler_t *reasm,
+    const ahdlc_decoded_frame_t *frame, uint32_t *message_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIB_INC_FRAGMENT_H_ */
@@ -46,22 +46,159 @@ extern "C" {
   ahdlc_op_return ahdlcEncoderInit(ahdlc_frame_encoder_t *handle,
       crc_callback crc_function);
 
-  /* Creates a new packet after resetting any current operation. */
+  /*
+   * As AhdlcDecoderInit() with the default writer, decoding into a slot of
+   * pool instead of a fixed pdu_buffer. Fails if no slot is free.
+   */
+  ahdlc_op_return AhdlcDecoderInitPool(ahdlc_frame_decoder_t *handle,
+      crc_callback crc_function, struct ahdlc_frame_pool *pool);
+
+  /*
+   * Right after a pool decoder returned AHDLC_COMPLETE, hands the slot
+   * holding the frame to the caller, who must give it back with
+   * AhdlcFramePoolFree(), and moves the decoder on to a fresh slot. Returns
+   * NULL, leaving the frame in pdu_buffer, when there is no complete frame
+   * or the pool is exhausted. Frames from DecodeInPlace() stay in the
+   * caller's buffer, so NULL follows it too.
+   */
+  uint8_t *AhdlcDecoderTakeFrame(ahdlc_frame_decoder_t *handle,
+      uint32_t *payload_len);
+
+  /*
+   * Sets the cipher for frames with frame_is_encrypted, which are rejected
+   * while there is none. The 4 byte frame counter follows the sequence and
+   * the CRC covers the cipher text; the decoder decrypts pdu_buffer in one
+   * call once the CRC checks out, so a custom decoder_write_callback must
+   * still fill pdu_buffer. The encoder starts counting at first_ctr and
+   * uses each counter for one frame.
+   */
+  ahdlc_op_return AhdlcDecoderSetCipher(ahdlc_frame_decoder_t *handle,
+      enc_callback enc_function);
+  ahdlc_op_return AhdlcEncoderSetCipher(ahdlc_frame_encoder_t *handle,
+      enc_callback enc_function, uint32_t first_ctr);
+
+  /*
+   * Lets EncodeBuffer() send a payload compressed, flagged with
+   * frame_is_compressed, whenever that makes it shorter. work, 2 byte
+   * aligned, holds the AHDLC_LZ_TABLE_SIZE byte match table and then the
+   * compressed copy; payloads that need more room go out as they are.
+   * Compression comes before encryption. NULL turns it off.
+   */
+  ahdlc_op_return AhdlcEncoderSetCompression(ahdlc_frame_encoder_t *handle,
+      uint8_t *work, uint32_t work_len);
+
+  /*
+   * Sets scratch for frames with frame_is_compressed, which are rejected
+   * while there is none. Once the CRC checks out the payload is copied to
+   * scratch, which must hold the largest compressed payload, and expanded
+   * back into pdu_buffer, so callers only ever see the original payload.
+   * A custom decoder_write_callback must still fill pdu_buffer.
+   * DecodeInPlace() has no room to expand into and drops these frames.
+   */
+  ahdlc_op_return AhdlcDecoderSetCompression(ahdlc_frame_decoder_t *handle,
+      uint8_t *scratch, uint32_t scratch_len);
+
+  /*
+   * Selects when the decoder checks the CRC, DECODE_CRC_PER_BYTE after init.
+   * In DECODE_CRC_PER_FRAME mode crc_cb runs once per frame over pdu_buffer,
+   * so a custom decoder_write_callback must still fill pdu_buffer.
+   */
+  ahdlc_op_return AhdlcDecoderSetCrcMode(ahdlc_frame_decoder_t *handle,
+      ahdlc_decoder_crc_mode mode);
+
+  /*
+   * Selects where encoded bytes go, ENCODE_SEND_BYTE_TO_BUFFER after init.
+   * ENCODE_SEND_BYTE_TO_CALLBACK uses frame_buffer as a staging buffer of at
+   * least 2 bytes and hands it to sink_cb each time it fills, so memory no
+   * longer grows with frame size and sending starts before the frame ends.
+   * ENCODE_SEND_FRAME_TO_CALLBACK hands the whole frame to sink_cb once it
+   * is finalized.
+   */
+  ahdlc_op_return AhdlcEncoderSetSink(ahdlc_frame_encoder_t *handle,
+      encode_modes mode, encoder_sink_callback sink_cb, void *sink_ctx);
+  /* Hands any staged bytes to the sink in ENCODE_SEND_BYTE_TO_CALLBACK mode */
+  ahdlc_op_return EncodeFlush(ahdlc_frame_encoder_t *handle);
+
+  /*
+   * Creates a new packet after resetting any current operation. With
+   * frame_is_ack set, frame_info.ack_num follows the sequence, which is sent
+   * as is rather than incremented.
+   */
   ahdlc_op_return EncodeNewFrame(
       ahdlc_frame_encoder_t *handle);
-  /* Adds a byte to a packet */
+  /* Adds a byte to a packet, not allowed in encrypted frames */
   ahdlc_op_return EncodeAddByteToFrameBuffer(
       ahdlc_frame_encoder_t *handle, uint8_t byte);
+  /*
+   * As EncodeAddByteToFrameBuffer(), with CRC16() or CRC16CCITT() compiled
+   * in instead of called through crc_cb. crc_cb must be the same function,
+   * the other encode calls still use it.
+   */
+  ahdlc_op_return EncodeAddByteToFrameBufferCRC16(
+      ahdlc_frame_encoder_t *handle, uint8_t byte);
+  ahdlc_op_return EncodeAddByteToFrameBufferCRC16CCITT(
+      ahdlc_frame_encoder_t *handle, uint8_t byte);
 
   ahdlc_op_return EncodeBuffer(ahdlc_frame_encoder_t *handle,
       const uint8_t *buffer, uint32_t len);
+  /*
+   * Encodes the segments, in order, as one frame with one CRC, so a header
+   * and a payload need not be copied together first. Call after
+   * EncodeNewFrame(); the frame is finalized.
+   */
+  ahdlc_op_return EncodeSegments(ahdlc_frame_encoder_t *handle,
+      const ahdlc_segment_t *segments, uint32_t num_segments);
+  /*
+   * As EncodeSegments(), but describes the frame in iov, ready for writev(),
+   * instead of copying it to frame_buffer. Plain runs point into the
+   * segments; only the header, escaped bytes and trailer are written to
+   * frame_buffer. The segments must not change until iov has been sent.
+   * Returns AHDLC_BUFFER_TOO_SMALL if max_iov entries are not enough.
+   * Only supported in ENCODE_SEND_BYTE_TO_BUFFER mode.
+   */
+  ahdlc_op_return EncodeSegmentsIovec(ahdlc_frame_encoder_t *handle,
+      const ahdlc_segment_t *segments, uint32_t num_segments,
+      ahdlc_segment_t *iov, uint32_t max_iov, uint32_t *num_iov);
   /* Write length and calculate CRC */
   ahdlc_op_return EncodeFinalize(ahdlc_frame_encoder_t *handle);
 
+#ifdef AHDLC_INSTRUMENTATION
+  /*
+   * Sets the clocks for the per-frame histograms; either may be NULL. The
+   * decoder measures from the first byte after a frame_marker to the good
+   * CRC, the encoder from EncodeNewFrame() to EncodeFinalize().
+   */
+  ahdlc_op_return AhdlcDecoderSetClock(ahdlc_frame_decoder_t *handle,
+      ahdlc_timestamp_callback time_cb, ahdlc_timestamp_callback cycle_cb,
+      void *ctx);
+  ahdlc_op_return AhdlcEncoderSetClock(ahdlc_frame_encoder_t *handle,
+      ahdlc_timestamp_callback time_cb, ahdlc_timestamp_callback cycle_cb,
+      void *ctx);
+
+  /*
+   * The stats and histograms are published at the end of every frame, good
+   * or not. Publish() does it on demand, e.g. after DecodeInPlace() counted
+   * out of frame bytes, and must be called by the thread that feeds the
+   * handle. Snapshot() may be called from any thread and never sees half
+   * an update.
+   */
+  void AhdlcDecoderPublishStats(ahdlc_frame_decoder_t *handle);
+  void AhdlcEncoderPublishStats(ahdlc_frame_encoder_t *handle);
+  void AhdlcDecoderSnapshot(ahdlc_frame_decoder_t *handle,
+      ahdlc_decoder_snapshot_t *snapshot);
+  void AhdlcEncoderSnapshot(ahdlc_frame_encoder_t *handle,
+      ahdlc_encoder_snapshot_t *snapshot);
+#endif
+
   /* Decode one byte at a time, returning the state of the decode machine */
   ahdlc_op_return decodeMMwaveFrame(uint8_t *raw_data, uint8_t num_bytes);
   ahdlc_op_return DecodeFrameByte(ahdlc_frame_decoder_t *handle,
       uint8_t byte);
+  /* As DecodeFrameByte(), with the CRC compiled in, see above */
+  ahdlc_op_return DecodeFrameByteCRC16(ahdlc_frame_decoder_t *handle,
+      uint8_t byte);
+  ahdlc_op_return DecodeFrameByteCRC16CCITT(ahdlc_frame_decoder_t *handle,
+      uint8_t byte);
 
   /*
    * When this function is called, it is expected that a frame is found in the
@@ -71,6 +208,37 @@ extern "C" {
   ahdlc_op_return DecoderBuffer(ahdlc_frame_decoder_t *handle,
       uint8_t *buffer, uint32_t buffer_length);
 
+  /*
+   * Decodes buffer from *offset on and stops after the next good frame,
+   * returning AHDLC_COMPLETE with frame filled in and *offset moved past its
+   * end marker. Returns AHDLC_OK once the rest of the buffer is used up; a
+   * frame still open then carries over into the next buffer. Call in a loop
+   * to take every frame out of one read() in a single pass.
+   */
+  ahdlc_op_return DecoderBufferNext(ahdlc_frame_decoder_t *handle,
+      const uint8_t *buffer, uint32_t buffer_length, uint32_t *offset,
+      ahdlc_decoded_frame_t *frame);
+
+  /*
+   * Decodes every complete frame in buffer in place: payloads are unescaped
+   * over their own raw bytes and described in frames, pointing into buffer,
+   * so pdu_buffer is not used. Stops after max_frames frames or at the last
+   * frame_marker. *consumed is the offset of that marker; keep the bytes
+   * from there on and append the next read to them. Bytes before the first
+   * frame_marker are counted in out_of_frame_byte_cnt and dropped, or in
+   * resync_discard_byte_cnt while the decoder is hunting. Returns
+   * AHDLC_COMPLETE if any frame was decoded.
+   *
+   * Frames never span calls, so a decoder should be fed with DecodeInPlace()
+   * only. If an earlier DecodeFrameByte(), DecoderBuffer() or
+   * DecoderBufferNext() call left a frame open, nothing is decoded and
+   * AHDLC_ERROR is returned; finish that frame on the byte path first.
+   */
+  ahdlc_op_return DecodeInPlace(ahdlc_frame_decoder_t *handle,
+      uint8_t *buffer, uint32_t buffer_length,
+      ahdlc_decoded_frame_t *frames, uint32_t max_frames,
+      uint32_t *num_frames, uint32_t *consumed);
+
   void PrintBuffer(uint8_t *buffer, uint32_t buffer_len);
 
   void decoderResetState(ahdlc_frame_decoder_t *handle);
@@ -113,6 +281,12 @@ extern "C" {
   static inline ahdlc_op_return encoderWriteByte(
       ahdlc_frame_encoder_t *hdl, uint8_t byte) {
 
+  if (hdl->buffer_len <= hdl->frame_info.buffer_index &&
+      hdl->encode_mode == ENCODE_SEND_BYTE_TO_CALLBACK &&
+      EncodeFlush(hdl) != AHDLC_OK) {
+    return AHDLC_ERROR;
+  }
+
   if (hdl->buffer_len > hdl->frame_info.buffer_index) {
     hdl->frame_buffer[hdl->frame_info.buffer_index++] = byte;
   } else {
@@ -18,14 +18,12 @@
 
 #include <stdint.h>
 
+#include "instrumentation.h"
+
 /* Callback for CRC calculation */
 typedef uint16_t (*crc_callback)(uint16_t crc, const uint8_t* buffer,
     uint32_t lenth);
 
-/* Callback for encryption */
-typedef uint32_t (*enc_callback)(uint32_t ctr, const uint8_t* buffer,
-    uint32_t lenth);
-
 #define CRC_ARRAY_SIZE (3)
 
 /* TODO  (skeys) we may want this part of init() */
@@ -48,6 +46,15 @@ typedef enum {
   AHDLC_COMPLETE           =  1
 }ahdlc_op_return;
 
+/*
+ * Callback for encryption: a counter mode cipher run in place over length
+ * payload bytes, starting offset bytes into the key stream of frame counter
+ * ctr. The same call decrypts. Called once per frame when decoding and once
+ * per block of up to AHDLC_ENC_BLOCK_SIZE bytes when encoding.
+ */
+typedef ahdlc_op_return (*enc_callback)(uint32_t ctr, uint32_t offset,
+    uint8_t* buffer, uint32_t length);
+
 
 typedef struct {
   /* Test for a little-endian machine */
@@ -78,6 +85,7 @@ typedef enum {
 
 /* Individual frame status */
 typedef enum {
+  ENCODE_SINK_ERROR       = -2,
   ENCODE_BUFFER_TOO_SMALL = -1,
   ENCODE_READY            = 0,
   ENCODE_FINALIZED        = 1,
@@ -104,16 +112,49 @@ typedef enum {
   DECODE_COMPLETE_GOOD       =  8,
 }ahdlc_decoder_machine_state;
 
+/*
+ * Where the decoder is within a frame, the state of the transition table in
+ * frame_layer.c. Each *_ESCAPE state is the one before it with an
+ * escape_marker pending. DISCARD is entered when the write callback moves
+ * decoder_state off DECODE_EXPECTING_PDU, e.g. on overflow. HUNT is entered
+ * on an invalid escape or control byte and skips to the next frame_marker.
+ */
+typedef enum {
+  DECODE_DFA_RESET_PENDING   = 0,  /* Next byte starts a new frame */
+  DECODE_DFA_FLAGS           = 1,
+  DECODE_DFA_FLAGS_ESCAPE    = 2,
+  DECODE_DFA_SEQUENCE        = 3,
+  DECODE_DFA_SEQUENCE_ESCAPE = 4,
+  DECODE_DFA_PDU             = 5,
+  DECODE_DFA_PDU_ESCAPE      = 6,
+  DECODE_DFA_DISCARD         = 7,
+  DECODE_DFA_DISCARD_ESCAPE  = 8,
+  DECODE_DFA_ACK_NUM         = 9,  /* After the sequence of an ack frame */
+  DECODE_DFA_ACK_NUM_ESCAPE  = 10,
+  DECODE_DFA_ENC_CTR         = 11,  /* Counter of an encrypted frame */
+  DECODE_DFA_ENC_CTR_ESCAPE  = 12,
+  DECODE_DFA_HUNT            = 13,  /* Lost sync, waiting for a marker */
+  DECODE_DFA_STATES          = 14
+}ahdlc_decoder_dfa_state;
+
+/* When the decoder runs crc_cb */
+typedef enum {
+  DECODE_CRC_PER_BYTE  = 0,  /* On every decoded byte, as it arrives */
+  DECODE_CRC_PER_FRAME = 1   /* Once over pdu_buffer, at the end marker */
+}ahdlc_decoder_crc_mode;
+
 /* Decoded frame stats */
 typedef struct {
   uint32_t num_decoded_bad_crc;
   uint32_t good_frame_cnt;
   uint32_t invalid_escape_cnt;
-  uint32_t out_of_sequence_cnt;
+  uint32_t out_of_sequence_cnt;  /* Good data frames off expected_sequence */
   uint32_t out_of_frame_byte_cnt;
   uint32_t encryption_engine_callback_cnt;
-  uint32_t crc_calc_callback_cnt;
+  uint32_t crc_calc_callback_cnt;  /* Counted by AHDLC_INSTRUMENTATION builds */
   uint32_t frame_too_small_cnt;
+  uint32_t resync_discard_byte_cnt;  /* Skipped resyncing after an error */
+  uint32_t decompress_error_cnt;  /* Good CRC, payload would not expand */
   uint8_t expected_sequence_number;
 }ahdlc_decoder_stats;
 
@@ -122,7 +163,8 @@ typedef struct {
   unsigned int frame_is_ack       : 1;
   unsigned int frame_is_encrypted : 1;
   unsigned int frame_is_continued : 1;
-  unsigned int reserved           : 2;
+  unsigned int frame_is_compressed : 1;  /* Payload is lz_compress.h data */
+  unsigned int reserved           : 1;
   unsigned int frame_valid        : 1;  /* Bit to make field non-zero */
   unsigned int extended_bits      : 1;
 }__attribute__((packed)) frame_bits_t ;
@@ -135,6 +177,8 @@ typedef union {
 
 typedef struct {
   uint32_t enc_ctr;
+  uint32_t enc_offset;     /* Payload bytes through encryption_cb so far */
+  uint8_t enc_ctr_bytes;   /* Bytes of enc_ctr decoded so far */
   uint32_t *pdu;
   crc_16_t calculated_crc_16;
   uint16_t buffer_index;
@@ -147,20 +191,72 @@ typedef struct {
 typedef struct {
   uint32_t encoded_frame_cnt;
   uint32_t encryption_engine_callback_count;
-  uint32_t crc_calc_callback_count;
+  uint32_t crc_calc_callback_count;  /* As crc_calc_callback_cnt */
+  uint32_t compressed_frame_cnt;
   uint32_t sequence_number;
   mmwave_encoder_machine_state encoder_state;
 }ahdlc_encoder_stats;
 
+#ifdef AHDLC_INSTRUMENTATION
+/* Consistent copy of the encoder stats, see AhdlcEncoderSnapshot() */
+typedef struct {
+  ahdlc_encoder_stats stats;
+  ahdlc_histogram_t latency;  /* EncodeNewFrame() to EncodeFinalize() */
+  ahdlc_histogram_t cycles;
+}ahdlc_encoder_snapshot_t;
+#endif
+
+/* Callback taking encoded bytes, see AhdlcEncoderSetSink() */
+typedef ahdlc_op_return (*encoder_sink_callback)(void *ctx,
+    const uint8_t *data, uint32_t len);
+
 typedef struct {
   crc_callback crc_cb;
   enc_callback encryption_cb;
   uint8_t* frame_buffer;
   uint32_t buffer_len;
+  encode_modes encode_mode;
+  encoder_sink_callback sink_cb;
+  void *sink_ctx;
+  uint8_t *lz_work;        /* See AhdlcEncoderSetCompression() */
+  uint32_t lz_work_len;
+  uint32_t header_end;     /* buffer_index just past the frame header */
   ahdlc_encoder_stats stats;
   ahdlc_frame_t frame_info;
+#ifdef AHDLC_INSTRUMENTATION
+  ahdlc_instrumentation_t instr;
+  ahdlc_atomic_u32_t published[AHDLC_SNAPSHOT_WORDS(ahdlc_encoder_snapshot_t)];
+#endif
 }ahdlc_frame_encoder_t;
 
+/* A run of bytes, input to and output from the scatter-gather encoder */
+typedef struct {
+  const uint8_t *base;
+  uint32_t len;
+}ahdlc_segment_t;
+
+/* A frame handed back by DecoderBufferNext() */
+typedef struct {
+  const uint8_t *payload;  /* Valid until the decoder is fed again */
+  uint32_t payload_len;
+  uint32_t end_offset;     /* Input offset just past the closing marker */
+  frame_control_field_t control_bits;
+  uint8_t sequence;
+  uint8_t ack_num;         /* Only set for frame_is_ack frames */
+}ahdlc_decoded_frame_t;
+
+/* See frame_pool.h */
+struct ahdlc_frame_pool;
+
+#ifdef AHDLC_INSTRUMENTATION
+/* Consistent copy of the decoder stats, see AhdlcDecoderSnapshot() */
+typedef struct {
+  ahdlc_decoder_stats stats;
+  ahdlc_histogram_t latency;  /* First byte after the marker to good CRC */
+  ahdlc_histogram_t cycles;
+}ahdlc_decoder_snapshot_t;
+#endif
+
 /* Callback for writing a decoded byte. */
 typedef ahdlc_op_return (*decoder_write_callback)(void *hdl, uint8_t byte);
 
@@ -170,13 +266,20 @@ typedef struct {
   decoder_write_callback dec_w_cb;
   uint8_t* pdu_buffer;
   uint32_t buffer_len;
+  struct ahdlc_frame_pool *pool;  /* pdu_buffer comes from here if set */
+  uint8_t *lz_scratch;     /* See AhdlcDecoderSetCompression() */
+  uint32_t lz_scratch_len;
   frame_control_field_t control_bits;
   ahdlc_frame_t frame_info;
   ahdlc_decoder_stats stats;
   ahdlc_decoder_machine_state decoder_state;
+  ahdlc_decoder_crc_mode crc_mode;
   crc_16_stack_t crc_stack;
-  uint8_t expecting_escape; /* This should be part of state_machine */
-  uint8_t reset_on_next_byte;
+  uint8_t dfa_state;  /* ahdlc_decoder_dfa_state */
+#ifdef AHDLC_INSTRUMENTATION
+  ahdlc_instrumentation_t instr;
+  ahdlc_atomic_u32_t published[AHDLC_SNAPSHOT_WORDS(ahdlc_decoder_snapshot_t)];
+#endif
 }ahdlc_frame_decoder_t;
 
 #endif /* LIB_INC_FRAME_LAYER_TYPES_H_ */
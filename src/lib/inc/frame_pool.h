@@ -0,0 +1,71 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef LIB_INC_FRAME_POOL_H_
+#define LIB_INC_FRAME_POOL_H_
+
+#include <stdint.h>
+
+#include "ahdlc_atomic.h"
+#include "frame_layer_types.h"
+
+/* One bit of free_map per slot */
+#define AHDLC_FRAME_POOL_MAX_SLOTS (32)
+
+/* Updated by the allocating side, exact while one thread allocates */
+typedef struct {
+  uint32_t alloc_cnt;
+  uint32_t exhausted_cnt;  /* Allocations that found no free slot */
+  uint32_t min_free;       /* Fewest free slots left after an allocation */
+}ahdlc_frame_pool_stats;
+
+/*
+ * Fixed size PDU buffers carved out of caller storage. A decoder set up with
+ * AhdlcDecoderInitPool() decodes into a slot and hands it over whole with
+ * AhdlcDecoderTakeFrame(); the new owner, on any thread, gives it back with
+ * AhdlcFramePoolFree(). Neither side takes a lock.
+ */
+typedef struct ahdlc_frame_pool {
+  uint8_t *storage;
+  uint32_t slot_size;
+  uint32_t num_slots;
+  ahdlc_atomic_u32_t free_map;  /* Bit n set while slot n is free */
+  ahdlc_frame_pool_stats stats;
+}ahdlc_frame_pool_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Uses as many slots of slot_size as fit, up to AHDLC_FRAME_POOL_MAX_SLOTS.
+ * AHDLC_ERROR for slots over UINT16_MAX, more than a decoder can fill.
+ */
+ahdlc_op_return AhdlcFramePoolInit(ahdlc_frame_pool_t *pool,
+    uint8_t *storage, uint32_t storage_len, uint32_t slot_size);
+
+/* Returns NULL, and counts it, when every slot is taken */
+uint8_t *AhdlcFramePoolAlloc(ahdlc_frame_pool_t *pool);
+
+/* AHDLC_ERROR for pointers that are not a slot in use */
+ahdlc_op_return AhdlcFramePoolFree(ahdlc_frame_pool_t *pool, uint8_t *slot);
+
+uint32_t AhdlcFramePoolAvailable(ahdlc_frame_pool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIB_INC_FRAME_POOL_H_ */
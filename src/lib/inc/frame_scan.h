@@ -0,0 +1,36 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef LIB_INC_FRAME_SCAN_H_
+#define LIB_INC_FRAME_SCAN_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Returns the offset of the first frame_marker or escape_marker byte in
+ * buffer, or length if the buffer holds neither. Uses AVX2 or SSE2 when the
+ * compiler targets them and a word-at-a-time scan otherwise.
+ */
+uint32_t AhdlcScanSpecial(const uint8_t *buffer, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIB_INC_FRAME_SCAN_H_ */
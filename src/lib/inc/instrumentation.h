@@ -0,0 +1,96 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef LIB_INC_INSTRUMENTATION_H_
+#define LIB_INC_INSTRUMENTATION_H_
+
+#include <stdint.h>
+
+#include "ahdlc_atomic.h"
+
+/*
+ * Per-frame latency and cycle histograms for the encoder and decoder, built
+ * in with AHDLC_INSTRUMENTATION defined. Without it the types below are not
+ * part of any handle and AHDLC_INSTR() drops its statement, so the byte
+ * paths are exactly as before.
+ */
+#ifdef AHDLC_INSTRUMENTATION
+#define AHDLC_INSTR(statement) do { statement; } while (0)
+#else
+#define AHDLC_INSTR(statement) do { } while (0)
+#endif
+
+/* Bucket 0 counts zeros, bucket n values in [2^(n-1), 2^n), the last more */
+#ifndef AHDLC_HISTOGRAM_BUCKETS
+#define AHDLC_HISTOGRAM_BUCKETS (32)
+#endif
+
+/* Size of a snapshot type in published words */
+#define AHDLC_SNAPSHOT_WORDS(type) \
+  ((sizeof(type) + sizeof(uint32_t) - 1) / sizeof(uint32_t))
+
+/*
+ * Returns a monotonic count, e.g. nanoseconds, timer ticks or a cycle
+ * counter such as DWT->CYCCNT. Only differences are used, so wrapping at
+ * 2^32 on a 32 bit counter is fine.
+ */
+typedef uint64_t (*ahdlc_timestamp_callback)(void *ctx);
+
+typedef struct {
+  uint64_t sum;
+  uint64_t max;
+  uint32_t count;
+  uint32_t bucket[AHDLC_HISTOGRAM_BUCKETS];
+}ahdlc_histogram_t;
+
+typedef struct {
+  ahdlc_timestamp_callback time_cb;   /* Latency clock, NULL for none */
+  ahdlc_timestamp_callback cycle_cb;  /* Cycle counter, NULL for none */
+  void *ctx;
+  uint64_t start_time;    /* At the first byte of the current frame */
+  uint64_t start_cycles;
+  ahdlc_histogram_t latency;
+  ahdlc_histogram_t cycles;
+  ahdlc_atomic_u32_t seq;  /* Odd while the published copy is updated */
+}ahdlc_instrumentation_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void AhdlcInstrumentInit(ahdlc_instrumentation_t *instr);
+
+uint32_t AhdlcHistogramBucket(uint64_t value);
+void AhdlcHistogramAdd(ahdlc_histogram_t *histogram, uint64_t value);
+
+/* Read the clocks at the first byte of a frame and record at its end */
+void AhdlcInstrumentFrameStart(ahdlc_instrumentation_t *instr);
+void AhdlcInstrumentFrameEnd(ahdlc_instrumentation_t *instr);
+
+/*
+ * Seqlock over words: a single writer copies len bytes of snapshot in with
+ * AhdlcInstrumentPublish(), any number of readers copy them out with
+ * AhdlcInstrumentRead(), which retries until it saw no update in between.
+ */
+void AhdlcInstrumentPublish(ahdlc_instrumentation_t *instr,
+    ahdlc_atomic_u32_t *words, const void *snapshot, uint32_t len);
+void AhdlcInstrumentRead(ahdlc_instrumentation_t *instr,
+    ahdlc_atomic_u32_t *words, void *snapshot, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIB_INC_INSTRUMENTATION_H_ */
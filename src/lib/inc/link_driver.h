@@ -0,0 +1,127 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef LIB_INC_LINK_DRIVER_H_
+#define LIB_INC_LINK_DRIVER_H_
+
+#include <stdint.h>
+
+#include "frame_layer_types.h"
+
+/* Frames decoded per DecodeInPlace() call */
+#define AHDLC_LINK_BATCH_FRAMES (32)
+
+/* Largest encoded frame for a payload: markers, escaped header and CRC */
+#define AHDLC_LINK_FRAME_BOUND(len) (2u * (len) + 20u)
+
+/* Called for every good frame, payload is valid until it returns */
+typedef void (*ahdlc_link_frame_callback)(void *ctx,
+    const ahdlc_decoded_frame_t *frame);
+
+typedef struct {
+  crc_callback crc_cb;
+  uint8_t *rx_buffer;      /* Holds the largest frame plus one read */
+  uint32_t rx_buffer_len;  /* At most UINT16_MAX bytes are used */
+  uint8_t *tx_buffer;      /* Encoded frames waiting for writev() */
+  uint32_t tx_buffer_len;
+  ahdlc_link_frame_callback frame_cb;
+  void *frame_ctx;
+}ahdlc_link_config_t;
+
+typedef struct {
+  uint64_t epoll_wait_calls;
+  uint64_t epoll_ctl_calls;
+  uint64_t read_calls;
+  uint64_t writev_calls;
+  uint64_t rx_bytes;
+  uint64_t tx_bytes;
+  uint64_t rx_frames;
+  uint64_t tx_frames;
+  uint64_t rx_dropped_bytes;  /* Frames too large for rx_buffer */
+  uint32_t max_tx_batch;      /* Most frames sent by one writev() */
+}ahdlc_link_stats_t;
+
+/*
+ * Drives one tty, pty or socket on Linux. Reads take as much as rx_buffer
+ * holds and are decoded in place, a batch of frames at a time. Frames
+ * queued by AhdlcLinkSend() are encoded back to back into tx_buffer, used
+ * as a ring, and go out together in one writev(), two iovecs when the
+ * queue wraps, so nothing is moved after a partial write.
+ */
+typedef struct {
+  int fd;
+  int epoll_fd;
+  ahdlc_link_frame_callback frame_cb;
+  void *frame_ctx;
+  ahdlc_frame_decoder_t decoder;
+  ahdlc_frame_encoder_t encoder;
+  uint8_t *rx_buffer;
+  uint32_t rx_size;
+  uint32_t rx_len;
+  uint8_t *tx_buffer;
+  uint32_t tx_size;
+  uint32_t tx_head;      /* Oldest byte not yet written */
+  uint32_t tx_tail;      /* Just past the newest frame */
+  uint32_t tx_wrap;      /* End of the older part while wrapped, else 0 */
+  uint32_t tx_frames;    /* Queued since the last writev() */
+  uint8_t want_write;    /* EPOLLOUT armed */
+  uint8_t hung_up;
+  ahdlc_link_stats_t stats;
+  ahdlc_decoded_frame_t frames[AHDLC_LINK_BATCH_FRAMES];
+}ahdlc_link_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Sets up link on fd, which is made nonblocking and stays the caller's.
+ * A tty should be in raw mode. The link's epoll_fd may itself be watched
+ * by an outer event loop.
+ */
+ahdlc_op_return AhdlcLinkInit(ahdlc_link_t *link, int fd,
+    const ahdlc_link_config_t *config);
+
+/* Closes the epoll_fd, not fd */
+void AhdlcLinkClose(ahdlc_link_t *link);
+
+/*
+ * Queues a frame for the next writev(), made by AhdlcLinkFlush() or
+ * AhdlcLinkPoll(). Flushes first when tx_buffer is full, and returns
+ * AHDLC_BUFFER_TOO_SMALL if that did not make room; poll and try again.
+ */
+ahdlc_op_return AhdlcLinkSend(ahdlc_link_t *link, const uint8_t *payload,
+    uint32_t len);
+
+/* Writes out the queue, AHDLC_OK even if the fd took only part of it */
+ahdlc_op_return AhdlcLinkFlush(ahdlc_link_t *link);
+
+/*
+ * Waits up to timeout_ms for the fd, decodes what it has, calling
+ * frame_cb for each good frame, then flushes, so replies queued from
+ * frame_cb leave in one writev(). Returns AHDLC_COMPLETE if any frame was
+ * delivered, AHDLC_OK if none, and AHDLC_ERROR on an error or hangup,
+ * with errno set.
+ */
+ahdlc_op_return AhdlcLinkPoll(ahdlc_link_t *link, int timeout_ms);
+
+/* System calls made per frame moved either way */
+double AhdlcLinkSyscallsPerFrame(const ahdlc_link_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIB_INC_LINK_DRIVER_H_ */
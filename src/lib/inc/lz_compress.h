@@ -0,0 +1,63 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef LIB_INC_LZ_COMPRESS_H_
+#define LIB_INC_LZ_COMPRESS_H_
+
+#include <stdint.h>
+
+#include "frame_layer_types.h"
+
+/*
+ * A small LZ77 for frame payloads. Each sequence is a token, high nibble
+ * literal count and low nibble match length - AHDLC_LZ_MIN_MATCH, either
+ * nibble at 15 continued in bytes of up to 255, then the literals, then a
+ * 16 bit little endian match offset back into the output. The last
+ * sequence stops after its literals. Nothing is shared between payloads,
+ * so every frame expands on its own.
+ */
+#define AHDLC_LZ_MIN_MATCH  (4)
+#define AHDLC_LZ_HASH_BITS  (10)
+/* Bytes of the match table, the only state the compressor keeps */
+#define AHDLC_LZ_TABLE_SIZE ((1u << AHDLC_LZ_HASH_BITS) * sizeof(uint16_t))
+/* Offsets are 16 bits, as are frame buffer indices */
+#define AHDLC_LZ_MAX_INPUT  (65535u)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Compresses len bytes of in into at most out_len bytes of out, using
+ * table, AHDLC_LZ_TABLE_SIZE bytes, as scratch. Returns the compressed
+ * size, or 0 if it would not fit in out_len or len is over
+ * AHDLC_LZ_MAX_INPUT.
+ */
+uint32_t AhdlcLzCompress(const uint8_t *in, uint32_t len, uint8_t *out,
+    uint32_t out_len, uint16_t *table);
+
+/*
+ * Expands len bytes of in into out, setting *out_used. Never reads or
+ * writes out of bounds, and returns AHDLC_ERROR for input that is cut
+ * short, points before the start of out or does not fit in out_len.
+ */
+ahdlc_op_return AhdlcLzDecompress(const uint8_t *in, uint32_t len,
+    uint8_t *out, uint32_t out_len, uint32_t *out_used);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIB_INC_LZ_COMPRESS_H_ */
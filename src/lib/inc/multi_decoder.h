@@ -0,0 +1,98 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef LIB_INC_MULTI_DECODER_H_
+#define LIB_INC_MULTI_DECODER_H_
+
+#include <stdint.h>
+
+#include "frame_layer_types.h"
+
+/* Called for every good frame, payload is valid until it returns */
+typedef void (*multi_frame_callback)(void *ctx, uint32_t channel,
+    const ahdlc_decoded_frame_t *frame);
+
+/*
+ * Decoder for many links at once. Per channel state is kept as struct of
+ * arrays: one state byte and one 16 bit fill index are all a byte touches
+ * besides the frame itself, so thousands of channels stay cache resident
+ * and the arrays can be scanned with vector loads. The CRC is checked once
+ * per frame, as in DECODE_CRC_PER_FRAME mode. Errors, skipped bytes and
+ * sequence gaps land in each channel's stats as the single decoder counts
+ * them, crc_calc_callback_cnt aside.
+ */
+typedef struct {
+  crc_callback crc_cb;
+  multi_frame_callback frame_cb;
+  void *frame_ctx;
+  uint32_t num_channels;
+  uint32_t slot_size;            /* AHDLC_MULTI_SLOT_SIZE(max_pdu) */
+  uint8_t *state;                /* Hot, one per channel */
+  uint16_t *index;               /* Hot, bytes held in the channel's slot */
+  uint8_t *slots;                /* num_channels * slot_size */
+  ahdlc_decoder_stats *stats;    /* Cold, one per channel */
+}ahdlc_multi_decoder_t;
+
+/* Bytes received on one channel */
+typedef struct {
+  uint32_t channel;
+  const uint8_t *data;
+  uint32_t len;
+}ahdlc_channel_input_t;
+
+#define AHDLC_MULTI_ALIGN4(n) (((n) + 3u) & ~3u)
+
+/* Flags, sequence, ack_num of ack frames, PDU and CRC */
+#define AHDLC_MULTI_SLOT_SIZE(max_pdu) ((max_pdu) + 5u)
+
+/* Storage AhdlcMultiDecoderInit() needs, 4 byte aligned */
+#define AHDLC_MULTI_DECODER_STORAGE_SIZE(channels, max_pdu) \
+  ((channels) * sizeof(ahdlc_decoder_stats) + \
+   AHDLC_MULTI_ALIGN4((channels) * sizeof(uint16_t)) + \
+   AHDLC_MULTI_ALIGN4(channels) + \
+   AHDLC_MULTI_ALIGN4((channels) * AHDLC_MULTI_SLOT_SIZE(max_pdu)))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Sets up handle for num_channels links carrying PDUs of up to max_pdu
+ * bytes, carving all state out of storage, which must hold
+ * AHDLC_MULTI_DECODER_STORAGE_SIZE() bytes and be 4 byte aligned.
+ */
+ahdlc_op_return AhdlcMultiDecoderInit(ahdlc_multi_decoder_t *handle,
+    uint32_t num_channels, uint32_t max_pdu, void *storage,
+    uint32_t storage_len, crc_callback crc_function,
+    multi_frame_callback frame_cb, void *frame_ctx);
+
+/* Drops any partial frame on channel, e.g. when its link restarts */
+ahdlc_op_return AhdlcMultiDecoderResetChannel(ahdlc_multi_decoder_t *handle,
+    uint32_t channel);
+
+/*
+ * Decodes a batch of inputs, in order, calling frame_cb for each good frame.
+ * end_offset of a frame is relative to its input's data. Returns
+ * AHDLC_COMPLETE if any frame was delivered and AHDLC_ERROR if an input
+ * named a channel out of range; the other inputs are still decoded.
+ */
+ahdlc_op_return AhdlcMultiDecode(ahdlc_multi_decoder_t *handle,
+    const ahdlc_channel_input_t *inputs, uint32_t num_inputs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIB_INC_MULTI_DECODER_H_ */
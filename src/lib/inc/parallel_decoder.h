@@ -0,0 +1,75 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef LIB_INC_PARALLEL_DECODER_H_
+#define LIB_INC_PARALLEL_DECODER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frame_layer_types.h"
+
+/* A frame of a decoded capture */
+typedef struct {
+  const uint8_t *payload;  /* Into the result's payload storage */
+  uint32_t payload_len;
+  uint64_t end_offset;     /* Capture offset just past the closing marker */
+  frame_control_field_t control_bits;
+  uint8_t sequence;
+  uint8_t ack_num;
+}ahdlc_capture_frame_t;
+
+typedef struct {
+  uint32_t num_threads;
+  size_t chunk_size;       /* Bytes per work item, 0 for the default */
+  uint32_t pdu_buffer_len; /* buffer_len of the equivalent serial decoder */
+  crc_callback crc_cb;
+}ahdlc_parallel_config_t;
+
+typedef struct {
+  ahdlc_capture_frame_t *frames;  /* Good frames, in capture order */
+  uint64_t num_frames;
+  ahdlc_decoder_stats stats;      /* Summed over all chunks */
+  uint8_t **payload_blocks;       /* Owned storage behind the payloads */
+  uint32_t num_blocks;
+}ahdlc_parallel_result_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Decodes a whole capture on config->num_threads threads. The capture is
+ * cut just after frame_markers, where a decoder is always back in
+ * DECODE_DFA_RESET_PENDING, so each chunk starts on a fresh decoder and a
+ * frame never spans two chunks. Frames and stats are exactly those of one
+ * decoder with buffer_len pdu_buffer_len fed the whole capture from init. Free
+ * result with AhdlcParallelResultFree().
+ *
+ * result holds a copy of every good payload, so up to the size of the
+ * capture again. While decoding, each thread also has a pdu_buffer and a
+ * chunk's payload storage, grown by doubling, so at most about twice the
+ * payloads of its chunk.
+ */
+ahdlc_op_return AhdlcParallelDecode(const uint8_t *buffer, size_t length,
+    const ahdlc_parallel_config_t *config, ahdlc_parallel_result_t *result);
+
+void AhdlcParallelResultFree(ahdlc_parallel_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIB_INC_PARALLEL_DECODER_H_ */
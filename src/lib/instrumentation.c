@@ -0,0 +1,119 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "inc/instrumentation.h"
+
+#include <stddef.h>
+#include <string.h>
+
+void AhdlcInstrumentInit(ahdlc_instrumentation_t *instr) {
+  instr->time_cb = NULL;
+  instr->cycle_cb = NULL;
+  instr->ctx = NULL;
+  instr->start_time = 0;
+  instr->start_cycles = 0;
+  memset(&instr->latency, 0, sizeof(instr->latency));
+  memset(&instr->cycles, 0, sizeof(instr->cycles));
+  ahdlcStoreRelaxed(&instr->seq, 0);
+}
+
+uint32_t AhdlcHistogramBucket(uint64_t value) {
+  uint32_t bucket = 0;
+
+#if defined(__GNUC__)
+  if (value) {
+    bucket = 64 - (uint32_t)__builtin_clzll(value);
+  }
+#else
+  while (value) {
+    ++bucket;
+    value >>= 1;
+  }
+#endif
+
+  return bucket < AHDLC_HISTOGRAM_BUCKETS ? bucket
+                                          : AHDLC_HISTOGRAM_BUCKETS - 1;
+}
+
+void AhdlcHistogramAdd(ahdlc_histogram_t *histogram, uint64_t value) {
+  ++histogram->bucket[AhdlcHistogramBucket(value)];
+  ++histogram->count;
+  histogram->sum += value;
+  if (value > histogram->max) {
+    histogram->max = value;
+  }
+}
+
+void AhdlcInstrumentFrameStart(ahdlc_instrumentation_t *instr) {
+  if (instr->time_cb) {
+    instr->start_time = instr->time_cb(instr->ctx);
+  }
+  if (instr->cycle_cb) {
+    instr->start_cycles = instr->cycle_cb(instr->ctx);
+  }
+}
+
+void AhdlcInstrumentFrameEnd(ahdlc_instrumentation_t *instr) {
+  /* Unsigned differences, so counters narrower than 64 bits may wrap */
+  if (instr->time_cb) {
+    AhdlcHistogramAdd(&instr->latency,
+                      instr->time_cb(instr->ctx) - instr->start_time);
+  }
+  if (instr->cycle_cb) {
+    AhdlcHistogramAdd(&instr->cycles,
+                      instr->cycle_cb(instr->ctx) - instr->start_cycles);
+  }
+}
+
+/* Bytes of word i that fall within len, the last word may be short */
+static uint32_t instrWordBytes(uint32_t len, uint32_t i) {
+  uint32_t left = len - i * (uint32_t)sizeof(uint32_t);
+
+  return left < sizeof(uint32_t) ? left : (uint32_t)sizeof(uint32_t);
+}
+
+void AhdlcInstrumentPublish(ahdlc_instrumentation_t *instr,
+    ahdlc_atomic_u32_t *words, const void *snapshot, uint32_t len) {
+  const uint8_t *src = (const uint8_t*)snapshot;
+  uint32_t seq = ahdlcLoadRelaxed(&instr->seq);
+  uint32_t word;
+  uint32_t i;
+
+  ahdlcStoreRelaxed(&instr->seq, seq + 1);
+  ahdlcFenceRelease();
+  for (i = 0; i * sizeof(word) < len; ++i) {
+    word = 0;
+    memcpy(&word, &src[i * sizeof(word)], instrWordBytes(len, i));
+    ahdlcStoreRelaxed(&words[i], word);
+  }
+  ahdlcStoreRelease(&instr->seq, seq + 2);
+}
+
+void AhdlcInstrumentRead(ahdlc_instrumentation_t *instr,
+    ahdlc_atomic_u32_t *words, void *snapshot, uint32_t len) {
+  uint8_t *dst = (uint8_t*)snapshot;
+  uint32_t before;
+  uint32_t word;
+  uint32_t i;
+
+  do {
+    before = ahdlcLoadAcquire(&instr->seq);
+    for (i = 0; i * sizeof(word) < len; ++i) {
+      word = ahdlcLoadRelaxed(&words[i]);
+      memcpy(&dst[i * sizeof(word)], &word, instrWordBytes(len, i));
+    }
+    ahdlcFenceAcquire();
+  } while ((before & 1) || before != ahdlcLoadRelaxed(&instr->seq));
+}
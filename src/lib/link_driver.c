@@ -0,0 +1,353 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "inc/link_driver.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "inc/frame_layer.h"
+
+/* Where the next frame of needed bytes may go, wrapping if it must */
+static ahdlc_true_false linkTxReserve(ahdlc_link_t *link, uint32_t needed,
+    uint32_t *pos) {
+  if (link->tx_wrap) {
+    *pos = link->tx_tail;
+    return (link->tx_head - link->tx_tail >= needed) ? AHDLC_TRUE :
+        AHDLC_FALSE;
+  }
+
+  if (link->tx_head == link->tx_tail) {
+    link->tx_head = link->tx_tail = 0;
+  }
+  if (link->tx_size - link->tx_tail >= needed) {
+    *pos = link->tx_tail;
+    return AHDLC_TRUE;
+  }
+  /* Older frames stay at the top, the new one starts the bottom */
+  *pos = 0;
+  return (link->tx_head >= needed) ? AHDLC_TRUE : AHDLC_FALSE;
+}
+
+static ahdlc_op_return linkWantWrite(ahdlc_link_t *link, uint8_t want) {
+  struct epoll_event event;
+
+  if (link->want_write == want) {
+    return AHDLC_OK;
+  }
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN | (want ? EPOLLOUT : 0);
+  ++link->stats.epoll_ctl_calls;
+  if (epoll_ctl(link->epoll_fd, EPOLL_CTL_MOD, link->fd, &event) != 0) {
+    return AHDLC_ERROR;
+  }
+  link->want_write = want;
+  return AHDLC_OK;
+}
+
+/* Drops n written bytes off the front of the queue */
+static void linkTxAdvance(ahdlc_link_t *link, uint32_t n) {
+  if (link->tx_wrap) {
+    uint32_t older = link->tx_wrap - link->tx_head;
+
+    if (n < older) {
+      link->tx_head += n;
+      return;
+    }
+    link->tx_wrap = 0;
+    link->tx_head = n - older;
+  } else {
+    link->tx_head += n;
+  }
+
+  if (link->tx_head == link->tx_tail) {
+    link->tx_head = link->tx_tail = 0;
+  }
+}
+
+static ahdlc_true_false linkTxPending(const ahdlc_link_t *link) {
+  return (link->tx_wrap || link->tx_head != link->tx_tail) ? AHDLC_TRUE :
+      AHDLC_FALSE;
+}
+
+/* Hands every whole frame in rx_buffer to frame_cb, keeps the rest */
+static uint32_t linkDecode(ahdlc_link_t *link) {
+  uint32_t delivered = 0;
+  uint32_t offset = 0;
+  uint32_t num_frames;
+  uint32_t consumed;
+  uint32_t i;
+
+  do {
+    DecodeInPlace(&link->decoder, link->rx_buffer + offset,
+                  link->rx_len - offset, link->frames,
+                  AHDLC_LINK_BATCH_FRAMES, &num_frames, &consumed);
+    for (i = 0; i < num_frames; ++i) {
+      link->frame_cb(link->frame_ctx, &link->frames[i]);
+    }
+    delivered += num_frames;
+    offset += consumed;
+  } while (num_frames == AHDLC_LINK_BATCH_FRAMES);
+
+  if (offset) {
+    memmove(link->rx_buffer, link->rx_buffer + offset, link->rx_len - offset);
+    link->rx_len -= offset;
+  } else if (link->rx_len == link->rx_size) {
+    /*
+     * Full and nothing decoded: no read can ever close this frame. Its
+     * tail is skipped as out of frame bytes once the buffer is empty.
+     */
+    link->stats.rx_dropped_bytes += link->rx_len;
+    link->rx_len = 0;
+  }
+  link->stats.rx_frames += delivered;
+
+  return delivered;
+}
+
+/*
+ * Reads and decodes. A read that leaves space in rx_buffer took all the fd
+ * had, so epoll is asked again rather than read() until EAGAIN.
+ */
+static ahdlc_op_return linkRead(ahdlc_link_t *link, uint32_t *delivered) {
+  for (;;) {
+    uint32_t space;
+    ssize_t n;
+
+    space = link->rx_size - link->rx_len;
+    n = read(link->fd, link->rx_buffer + link->rx_len, space);
+    ++link->stats.read_calls;
+    if (n > 0) {
+      link->rx_len += (uint32_t)n;
+      link->stats.rx_bytes += (uint64_t)n;
+      *delivered += linkDecode(link);
+      if ((uint32_t)n < space) {
+        return AHDLC_OK;
+      }
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return AHDLC_OK;
+    } else {
+      /*
+       * A closed peer, or EIO once a pty's other side is gone, stays
+       * readable under level triggering; later polls fail at once instead.
+       */
+      if (!n) {
+        errno = EPIPE;
+      }
+      link->hung_up = 1;
+      return AHDLC_ERROR;
+    }
+  }
+}
+
+ahdlc_op_return AhdlcLinkInit(ahdlc_link_t *link, int fd,
+    const ahdlc_link_config_t *config) {
+  struct epoll_event event;
+  int flags;
+
+  if (!link || !config || !config->crc_cb || !config->frame_cb ||
+      !config->rx_buffer || !config->rx_buffer_len ||
+      !config->tx_buffer || config->tx_buffer_len <= AHDLC_LINK_FRAME_BOUND(0)) {
+    return AHDLC_ERROR;
+  }
+
+  memset(link, 0, sizeof(*link));
+  link->epoll_fd = -1;  /* AhdlcLinkClose() is safe after a failed init */
+  link->fd = fd;
+  link->frame_cb = config->frame_cb;
+  link->frame_ctx = config->frame_ctx;
+  link->rx_buffer = config->rx_buffer;
+  /* DecodeInPlace() frames are indexed by 16 bits, so larger is no use */
+  link->rx_size = (config->rx_buffer_len < UINT16_MAX) ?
+      config->rx_buffer_len : UINT16_MAX;
+  link->tx_buffer = config->tx_buffer;
+  link->tx_size = config->tx_buffer_len;
+
+  /* DecodeInPlace() decodes in rx_buffer itself, not into pdu_buffer */
+  link->decoder.pdu_buffer = link->rx_buffer;
+  link->decoder.buffer_len = 0;
+  if (AhdlcDecoderInit(&link->decoder, config->crc_cb, NULL) != AHDLC_OK ||
+      AhdlcDecoderSetCrcMode(&link->decoder,
+                             DECODE_CRC_PER_FRAME) != AHDLC_OK) {
+    return AHDLC_ERROR;
+  }
+  link->encoder.frame_buffer = link->tx_buffer;
+  link->encoder.buffer_len = link->tx_size;
+  if (ahdlcEncoderInit(&link->encoder, config->crc_cb) != AHDLC_OK) {
+    return AHDLC_ERROR;
+  }
+
+  flags = fcntl(fd, F_GETFL);
+  if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+    return AHDLC_ERROR;
+  }
+
+  link->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (link->epoll_fd < 0) {
+    return AHDLC_ERROR;
+  }
+  /* Level triggered, so one short read per wakeup is enough */
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  if (epoll_ctl(link->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+    close(link->epoll_fd);
+    link->epoll_fd = -1;
+    return AHDLC_ERROR;
+  }
+
+  return AHDLC_OK;
+}
+
+void AhdlcLinkClose(ahdlc_link_t *link) {
+  if (link->epoll_fd >= 0) {
+    close(link->epoll_fd);
+    link->epoll_fd = -1;
+  }
+}
+
+ahdlc_op_return AhdlcLinkSend(ahdlc_link_t *link, const uint8_t *payload,
+    uint32_t len) {
+  uint32_t needed;
+  uint32_t pos;
+  ahdlc_op_return status;
+
+  if (len > (link->tx_size - AHDLC_LINK_FRAME_BOUND(0)) / 2) {
+    return AHDLC_ERROR;
+  }
+  needed = AHDLC_LINK_FRAME_BOUND(len);
+
+  if (!linkTxReserve(link, needed, &pos)) {
+    if (AhdlcLinkFlush(link) != AHDLC_OK) {
+      return AHDLC_ERROR;
+    }
+    if (!linkTxReserve(link, needed, &pos)) {
+      return AHDLC_BUFFER_TOO_SMALL;
+    }
+  }
+
+  link->encoder.frame_buffer = link->tx_buffer + pos;
+  /* frame_info.buffer_index is 16 bits, larger frames fail to encode */
+  link->encoder.buffer_len = (needed < UINT16_MAX) ? needed : UINT16_MAX;
+  status = EncodeNewFrame(&link->encoder);
+  if (status == AHDLC_OK) {
+    status = EncodeBuffer(&link->encoder, payload, len);
+  }
+  if (status != AHDLC_OK) {
+    return status;
+  }
+
+  if (pos < link->tx_tail) {
+    link->tx_wrap = link->tx_tail;
+  }
+  link->tx_tail = pos + link->encoder.frame_info.buffer_index;
+  ++link->tx_frames;
+  ++link->stats.tx_frames;
+
+  return AHDLC_OK;
+}
+
+ahdlc_op_return AhdlcLinkFlush(ahdlc_link_t *link) {
+  while (linkTxPending(link)) {
+    struct iovec iov[2];
+    int num_iov = 1;
+    ssize_t n;
+
+    iov[0].iov_base = link->tx_buffer + link->tx_head;
+    if (link->tx_wrap) {
+      iov[0].iov_len = link->tx_wrap - link->tx_head;
+      iov[1].iov_base = link->tx_buffer;
+      iov[1].iov_len = link->tx_tail;
+      num_iov = 2;
+    } else {
+      iov[0].iov_len = link->tx_tail - link->tx_head;
+    }
+
+    n = writev(link->fd, iov, num_iov);
+    ++link->stats.writev_calls;
+    if (n < 0 && errno == EINTR) {
+      continue;
+    } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      /* The rest goes when epoll says the fd takes more */
+      return linkWantWrite(link, 1);
+    } else if (n < 0) {
+      return AHDLC_ERROR;
+    }
+
+    if (link->tx_frames > link->stats.max_tx_batch) {
+      link->stats.max_tx_batch = link->tx_frames;
+    }
+    link->tx_frames = 0;
+    link->stats.tx_bytes += (uint64_t)n;
+    linkTxAdvance(link, (uint32_t)n);
+  }
+
+  return linkWantWrite(link, 0);
+}
+
+ahdlc_op_return AhdlcLinkPoll(ahdlc_link_t *link, int timeout_ms) {
+  struct epoll_event event;
+  uint32_t delivered = 0;
+  ahdlc_op_return status = AHDLC_OK;
+  uint8_t writable = 0;
+  int n;
+
+  if (link->hung_up) {
+    errno = EPIPE;
+    return AHDLC_ERROR;
+  }
+  /* Frames queued since the last poll go before waiting */
+  if (!link->want_write && linkTxPending(link) &&
+      AhdlcLinkFlush(link) != AHDLC_OK) {
+    return AHDLC_ERROR;
+  }
+
+  n = epoll_wait(link->epoll_fd, &event, 1, timeout_ms);
+  ++link->stats.epoll_wait_calls;
+  if (n < 0) {
+    return (errno == EINTR) ? AHDLC_OK : AHDLC_ERROR;
+  }
+
+  if (n && (event.events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+    status = linkRead(link, &delivered);
+  }
+  if (n && (event.events & EPOLLOUT)) {
+    writable = 1;
+  }
+
+  /* Replies queued from frame_cb, or what waited for EPOLLOUT */
+  if (status == AHDLC_OK && (writable || !link->want_write) &&
+      linkTxPending(link)) {
+    status = AhdlcLinkFlush(link);
+  }
+  if (status != AHDLC_OK) {
+    return status;
+  }
+
+  return delivered ? AHDLC_COMPLETE : AHDLC_OK;
+}
+
+double AhdlcLinkSyscallsPerFrame(const ahdlc_link_stats_t *stats) {
+  uint64_t frames = stats->rx_frames + stats->tx_frames;
+  uint64_t calls = stats->epoll_wait_calls + stats->epoll_ctl_calls +
+      stats->read_calls + stats->writev_calls;
+
+  return frames ? (double)calls / (double)frames : 0.0;
+}
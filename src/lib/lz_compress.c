@@ -0,0 +1,195 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "inc/lz_compress.h"
+
+#include <string.h>
+
+#define LZ_NIBBLE_MAX (15u)
+
+static uint32_t lzRead32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static uint32_t lzHash(uint32_t v) {
+  return (v * 2654435761u) >> (32 - AHDLC_LZ_HASH_BITS);
+}
+
+/* Writes the bytes continuing a nibble that hit 15, 0 if out is full */
+static uint32_t lzPutLength(uint8_t *out, uint32_t op, uint32_t out_len,
+                            uint32_t rest) {
+  for (; rest >= 255; rest -= 255) {
+    if (op == out_len) {
+      return 0;
+    }
+    out[op++] = 255;
+  }
+  if (op == out_len) {
+    return 0;
+  }
+  out[op++] = (uint8_t)rest;
+  return op;
+}
+
+/*
+ * Appends literals and, if match_len is not 0, the match after them.
+ * Returns the new output size, 0 if out is full.
+ */
+static uint32_t lzPutSequence(uint8_t *out, uint32_t op, uint32_t out_len,
+    const uint8_t *literals, uint32_t num_literals, uint32_t offset,
+    uint32_t match_len) {
+  uint32_t lit_nibble = num_literals < LZ_NIBBLE_MAX ? num_literals
+                                                     : LZ_NIBBLE_MAX;
+  uint32_t match_code = match_len ? match_len - AHDLC_LZ_MIN_MATCH : 0;
+  uint32_t match_nibble = match_code < LZ_NIBBLE_MAX ? match_code
+                                                     : LZ_NIBBLE_MAX;
+
+  if (op == out_len) {
+    return 0;
+  }
+  out[op++] = (uint8_t)((lit_nibble << 4) | match_nibble);
+  if (lit_nibble == LZ_NIBBLE_MAX) {
+    op = lzPutLength(out, op, out_len, num_literals - LZ_NIBBLE_MAX);
+    if (!op) {
+      return 0;
+    }
+  }
+  if (out_len - op < num_literals) {
+    return 0;
+  }
+  memcpy(&out[op], literals, num_literals);
+  op += num_literals;
+
+  if (!match_len) {
+    return op;
+  }
+  if (out_len - op < 2) {
+    return 0;
+  }
+  out[op++] = (uint8_t)offset;
+  out[op++] = (uint8_t)(offset >> 8);
+  if (match_nibble == LZ_NIBBLE_MAX) {
+    op = lzPutLength(out, op, out_len, match_code - LZ_NIBBLE_MAX);
+  }
+  return op;
+}
+
+uint32_t AhdlcLzCompress(const uint8_t *in, uint32_t len, uint8_t *out,
+                         uint32_t out_len, uint16_t *table) {
+  uint32_t anchor = 0;
+  uint32_t ip = 0;
+  uint32_t op = 0;
+
+  if (len > AHDLC_LZ_MAX_INPUT) {
+    return 0;
+  }
+  memset(table, 0, AHDLC_LZ_TABLE_SIZE);
+
+  /* Greedy: take the first match the table offers */
+  while (len - ip >= AHDLC_LZ_MIN_MATCH) {
+    uint32_t v = lzRead32(&in[ip]);
+    uint32_t h = lzHash(v);
+    uint32_t candidate = table[h];
+    uint32_t match_len;
+
+    table[h] = (uint16_t)ip;
+    if (candidate >= ip || lzRead32(&in[candidate]) != v) {
+      ++ip;
+      continue;
+    }
+
+    match_len = AHDLC_LZ_MIN_MATCH;
+    while (ip + match_len < len && in[candidate + match_len] ==
+           in[ip + match_len]) {
+      ++match_len;
+    }
+    op = lzPutSequence(out, op, out_len, &in[anchor], ip - anchor,
+                       ip - candidate, match_len);
+    if (!op) {
+      return 0;
+    }
+    ip += match_len;
+    anchor = ip;
+  }
+
+  return lzPutSequence(out, op, out_len, &in[anchor], len - anchor, 0, 0);
+}
+
+/* Reads the bytes continuing a nibble that hit 15, AHDLC_ERROR if cut */
+static ahdlc_op_return lzGetLength(const uint8_t *in, uint32_t len,
+                                   uint32_t *ip, uint32_t *value) {
+  uint8_t byte;
+
+  do {
+    if (*ip == len) {
+      return AHDLC_ERROR;
+    }
+    byte = in[(*ip)++];
+    *value += byte;
+  } while (byte == 255 && *value <= AHDLC_LZ_MAX_INPUT);
+
+  return AHDLC_OK;
+}
+
+ahdlc_op_return AhdlcLzDecompress(const uint8_t *in, uint32_t len,
+    uint8_t *out, uint32_t out_len, uint32_t *out_used) {
+  uint32_t ip = 0;
+  uint32_t op = 0;
+
+  *out_used = 0;
+  while (ip < len) {
+    uint8_t token = in[ip++];
+    uint32_t num_literals = token >> 4;
+    uint32_t match_len = token & LZ_NIBBLE_MAX;
+    uint32_t offset;
+
+    if (num_literals == LZ_NIBBLE_MAX &&
+        lzGetLength(in, len, &ip, &num_literals) != AHDLC_OK) {
+      return AHDLC_ERROR;
+    }
+    if (len - ip < num_literals || out_len - op < num_literals) {
+      return AHDLC_ERROR;
+    }
+    memcpy(&out[op], &in[ip], num_literals);
+    ip += num_literals;
+    op += num_literals;
+
+    if (ip == len) {
+      break;  /* The last sequence has no match */
+    }
+    if (len - ip < 2) {
+      return AHDLC_ERROR;
+    }
+    offset = in[ip] | ((uint32_t)in[ip + 1] << 8);
+    ip += 2;
+    if (match_len == LZ_NIBBLE_MAX &&
+        lzGetLength(in, len, &ip, &match_len) != AHDLC_OK) {
+      return AHDLC_ERROR;
+    }
+    match_len += AHDLC_LZ_MIN_MATCH;
+    if (!offset || offset > op || out_len - op < match_len) {
+      return AHDLC_ERROR;
+    }
+    /* Byte by byte, a match may overlap the bytes it produces */
+    for (; match_len; --match_len, ++op) {
+      out[op] = out[op - offset];
+    }
+  }
+
+  *out_used = op;
+  return AHDLC_OK;
+}
@@ -0,0 +1,288 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "inc/multi_decoder.h"
+
+#include <string.h>
+
+#include "inc/frame_layer.h"
+#include "inc/frame_scan.h"
+
+/* Flags and sequence lead each slot, so one CRC call covers the frame */
+#define MULTI_HEADER_SIZE (2)
+
+/* Per channel decode state */
+typedef enum {
+  MULTI_START           = 0,  /* Dropping bytes up to the first frame_marker */
+  MULTI_IDLE            = 1,  /* After a frame_marker */
+  MULTI_FRAME           = 2,
+  MULTI_FRAME_ESCAPE    = 3,
+  MULTI_HUNT            = 4,  /* After an error, up to the next frame_marker */
+  MULTI_DISCARD         = 5,  /* After an overflow, up to the closing marker */
+  MULTI_DISCARD_ESCAPE  = 6
+}multi_channel_state;
+
+ahdlc_op_return AhdlcMultiDecoderInit(ahdlc_multi_decoder_t *handle,
+    uint32_t num_channels, uint32_t max_pdu, void *storage,
+    uint32_t storage_len, crc_callback crc_function,
+    multi_frame_callback frame_cb, void *frame_ctx) {
+  uint8_t *next = (uint8_t*)storage;
+  uint32_t i;
+
+  if (!num_channels || !crc_function || !frame_cb ||
+      max_pdu > UINT16_MAX - AHDLC_MULTI_SLOT_SIZE(0)) {
+    return AHDLC_ERROR;
+  }
+  if (storage_len < AHDLC_MULTI_DECODER_STORAGE_SIZE(num_channels, max_pdu)) {
+    return AHDLC_BUFFER_TOO_SMALL;
+  }
+
+  handle->crc_cb = crc_function;
+  handle->frame_cb = frame_cb;
+  handle->frame_ctx = frame_ctx;
+  handle->num_channels = num_channels;
+  handle->slot_size = AHDLC_MULTI_SLOT_SIZE(max_pdu);
+
+  /* Widest members first, keeping each array aligned */
+  handle->stats = (ahdlc_decoder_stats*)next;
+  next += num_channels * sizeof(ahdlc_decoder_stats);
+  handle->index = (uint16_t*)next;
+  next += AHDLC_MULTI_ALIGN4(num_channels * sizeof(uint16_t));
+  handle->state = next;
+  next += AHDLC_MULTI_ALIGN4(num_channels);
+  handle->slots = next;
+
+  memset(handle->stats, 0, num_channels * sizeof(ahdlc_decoder_stats));
+  for (i = 0; i < num_channels; ++i) {
+    AhdlcMultiDecoderResetChannel(handle, i);
+  }
+
+  return AHDLC_OK;
+}
+
+ahdlc_op_return AhdlcMultiDecoderResetChannel(ahdlc_multi_decoder_t *handle,
+    uint32_t channel) {
+  if (channel >= handle->num_channels) {
+    return AHDLC_ERROR;
+  }
+
+  handle->state[channel] = MULTI_START;
+  handle->index[channel] = 0;
+
+  return AHDLC_OK;
+}
+
+/* Checks the frame held in slot, returning 1 if it was delivered */
+static uint32_t multiEndFrame(ahdlc_multi_decoder_t *handle, uint32_t channel,
+                              const uint8_t *slot, uint32_t length,
+                              uint32_t end_offset) {
+  ahdlc_decoder_stats *stats = &handle->stats[channel];
+  ahdlc_decoded_frame_t frame;
+  uint16_t received;
+  uint32_t header = MULTI_HEADER_SIZE;
+
+  frame.control_bits.value = slot[0];
+  if (length && frame.control_bits.bit.frame_is_ack) {
+    /* ack_num follows the sequence */
+    ++header;
+  }
+  if (length < header + crc_size) {
+    ++stats->frame_too_small_cnt;
+    return 0;
+  }
+
+  length -= crc_size;
+  received = (uint16_t)((slot[length] << 8) | slot[length + 1]);
+  if (handle->crc_cb(initial_crc_value, slot, length) != received) {
+    ++stats->num_decoded_bad_crc;
+    return 0;
+  }
+
+  frame.sequence = slot[1];
+  frame.ack_num = (header > MULTI_HEADER_SIZE) ? slot[2] : 0;
+  ++stats->good_frame_cnt;
+  /* Ack frames repeat the sequence of the last data frame */
+  if (!frame.control_bits.bit.frame_is_ack) {
+    if (frame.sequence != stats->expected_sequence_number) {
+      ++stats->out_of_sequence_cnt;
+    }
+    stats->expected_sequence_number = (uint8_t)(frame.sequence + 1);
+  }
+  frame.payload = &slot[header];
+  frame.payload_len = length - header;
+  frame.end_offset = end_offset;
+  handle->frame_cb(handle->frame_ctx, channel, &frame);
+
+  return 1;
+}
+
+/* Flags the single decoder would accept */
+static uint8_t multiFlagsValid(uint8_t flags) {
+  frame_control_field_t control;
+
+  control.value = flags;
+  return control.bit.frame_valid && !control.bit.frame_is_encrypted &&
+      !control.bit.frame_is_compressed;
+}
+
+/*
+ * Decodes one input with the channel's state held in locals, so the state
+ * arrays are read and written once per input rather than once per byte.
+ */
+static uint32_t multiDecodeInput(ahdlc_multi_decoder_t *handle,
+                                 uint32_t channel, const uint8_t *data,
+                                 uint32_t len) {
+  ahdlc_decoder_stats *stats = &handle->stats[channel];
+  uint8_t *slot = &handle->slots[channel * handle->slot_size];
+  uint32_t slot_size = handle->slot_size;
+  uint8_t state = handle->state[channel];
+  uint32_t index = handle->index[channel];
+  uint32_t frames = 0;
+  uint32_t i = 0;
+
+  while (i < len) {
+    uint8_t byte;
+
+    if (state == MULTI_START || state == MULTI_HUNT) {
+      const uint8_t *marker = (const uint8_t*)memchr(&data[i], frame_marker,
+                                                     len - i);
+      uint32_t skip = marker ? (uint32_t)(marker - &data[i]) : len - i;
+
+      /* Counted as the single decoder and DecodeInPlace() do */
+      if (state == MULTI_START) {
+        stats->out_of_frame_byte_cnt += skip;
+      } else {
+        stats->resync_discard_byte_cnt += skip;
+      }
+      i += skip;
+      if (i == len) {
+        break;
+      }
+      ++i;
+      state = MULTI_IDLE;
+      index = 0;
+      continue;
+    }
+
+    /* The rest of an overflowed frame is skipped, but still unescaped */
+    if (state == MULTI_DISCARD) {
+      i += AhdlcScanSpecial(&data[i], len - i);
+      if (i == len) {
+        break;
+      }
+      byte = data[i++];
+      if (byte == frame_marker) {
+        /* Bad at the closing marker, as the single decoder counts it */
+        ++stats->num_decoded_bad_crc;
+        state = MULTI_IDLE;
+        index = 0;
+      } else {
+        state = MULTI_DISCARD_ESCAPE;
+      }
+      continue;
+    }
+    if (state == MULTI_DISCARD_ESCAPE) {
+      byte = data[i++];
+      if (byte == frame_marker) {
+        ++stats->num_decoded_bad_crc;
+        state = MULTI_IDLE;
+        index = 0;
+      } else if (byte == escaped_start || byte == escaped_escape) {
+        state = MULTI_DISCARD;
+      } else if (byte != escape_marker) {
+        ++stats->invalid_escape_cnt;
+        state = MULTI_HUNT;
+      }
+      continue;
+    }
+
+    /* Plain PDU bytes are copied a run at a time */
+    if (state == MULTI_FRAME && index >= MULTI_HEADER_SIZE) {
+      uint32_t run = AhdlcScanSpecial(&data[i], len - i);
+
+      if (run > slot_size - index) {
+        state = MULTI_DISCARD;
+        continue;
+      }
+      memcpy(&slot[index], &data[i], run);
+      index += run;
+      i += run;
+      if (i == len) {
+        break;
+      }
+    }
+
+    byte = data[i++];
+    if (byte == frame_marker) {
+      if (state != MULTI_IDLE) {
+        frames += multiEndFrame(handle, channel, slot, index, i);
+      }
+      state = MULTI_IDLE;
+      index = 0;
+      continue;
+    }
+
+    if (byte == escape_marker) {
+      state = MULTI_FRAME_ESCAPE;
+      continue;
+    }
+
+    if (state == MULTI_FRAME_ESCAPE) {
+      if (byte != escaped_start && byte != escaped_escape) {
+        ++stats->invalid_escape_cnt;
+        state = MULTI_HUNT;
+        continue;
+      }
+      byte = (byte == escaped_start) ? frame_marker : escape_marker;
+    }
+
+    state = MULTI_FRAME;
+    if (index == slot_size) {
+      state = MULTI_DISCARD;
+      continue;
+    }
+    slot[index++] = byte;
+    if (index == 1 && !multiFlagsValid(byte)) {
+      state = MULTI_HUNT;
+    }
+  }
+
+  handle->state[channel] = state;
+  handle->index[channel] = (uint16_t)index;
+
+  return frames;
+}
+
+ahdlc_op_return AhdlcMultiDecode(ahdlc_multi_decoder_t *handle,
+    const ahdlc_channel_input_t *inputs, uint32_t num_inputs) {
+  ahdlc_op_return code = AHDLC_OK;
+  uint32_t frames = 0;
+  uint32_t i;
+
+  for (i = 0; i < num_inputs; ++i) {
+    if (inputs[i].channel >= handle->num_channels) {
+      code = AHDLC_ERROR;
+      continue;
+    }
+    frames += multiDecodeInput(handle, inputs[i].channel, inputs[i].data,
+                               inputs[i].len);
+  }
+
+  if (code == AHDLC_OK && frames) {
+    code = AHDLC_COMPLETE;
+  }
+
+  return code;
+}
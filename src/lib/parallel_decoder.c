@@ -0,0 +1,352 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "inc/parallel_decoder.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "inc/frame_layer.h"
+
+/* Work item size when the caller leaves it to us */
+#define PARALLEL_DEFAULT_CHUNK  (16u << 20)
+/* DecoderBufferNext() takes 32 bit lengths */
+#define PARALLEL_MAX_PIECE      (1u << 30)
+/* First payload storage of a chunk, doubled as frames arrive */
+#define PARALLEL_FIRST_PAYLOADS (64u << 10)
+
+typedef struct {
+  const uint8_t *start;
+  size_t length;
+  uint64_t offset;               /* Of start within the capture */
+  ahdlc_capture_frame_t *frames;
+  uint64_t num_frames;
+  uint64_t max_frames;
+  uint8_t *payloads;             /* Payloads back to back, in frame order */
+  size_t payload_cap;
+  ahdlc_decoder_stats stats;
+  ahdlc_op_return code;
+}parallel_chunk_t;
+
+typedef struct {
+  const ahdlc_parallel_config_t *config;
+  parallel_chunk_t *chunks;
+  uint32_t num_chunks;
+  uint32_t next_chunk;
+  pthread_mutex_t lock;
+}parallel_job_t;
+
+/* Appends a good frame, its payload going after the previous one */
+static ahdlc_op_return parallelAddFrame(parallel_chunk_t *chunk,
+    size_t *payload_used, const ahdlc_decoded_frame_t *frame,
+    uint64_t end_offset) {
+  ahdlc_capture_frame_t *out;
+
+  if (chunk->num_frames == chunk->max_frames) {
+    uint64_t max_frames = chunk->max_frames ? 2 * chunk->max_frames : 64;
+    ahdlc_capture_frame_t *frames = (ahdlc_capture_frame_t*)realloc(
+        chunk->frames, max_frames * sizeof(ahdlc_capture_frame_t));
+    if (!frames) {
+      return AHDLC_ERROR;
+    }
+    chunk->frames = frames;
+    chunk->max_frames = max_frames;
+  }
+
+  /* Grown like frames, never past the chunk: a payload is at most its
+   * encoding, so the chunk's payloads fit in its length */
+  if (!chunk->payloads ||
+      *payload_used + frame->payload_len > chunk->payload_cap) {
+    size_t cap = chunk->payload_cap ? 2 * chunk->payload_cap
+                                    : PARALLEL_FIRST_PAYLOADS;
+    uint8_t *payloads;
+
+    if (cap < *payload_used + frame->payload_len) {
+      cap = *payload_used + frame->payload_len;
+    }
+    if (cap > chunk->length) {
+      cap = chunk->length;
+    }
+    payloads = (uint8_t*)realloc(chunk->payloads, cap);
+    if (!payloads) {
+      return AHDLC_ERROR;
+    }
+    chunk->payloads = payloads;
+    chunk->payload_cap = cap;
+  }
+
+  out = &chunk->frames[chunk->num_frames++];
+  out->payload = NULL;  /* Set once the payload storage stops moving */
+  out->payload_len = frame->payload_len;
+  out->end_offset = end_offset;
+  out->control_bits = frame->control_bits;
+  out->sequence = frame->sequence;
+  out->ack_num = frame->ack_num;
+  memcpy(&chunk->payloads[*payload_used], frame->payload, frame->payload_len);
+  *payload_used += frame->payload_len;
+
+  return AHDLC_OK;
+}
+
+static void parallelDecodeChunk(const ahdlc_parallel_config_t *config,
+                                parallel_chunk_t *chunk) {
+  ahdlc_frame_decoder_t decoder;
+  ahdlc_decoded_frame_t frame;
+  size_t payload_used = 0;
+  size_t done = 0;
+  uint64_t i;
+
+  chunk->code = AHDLC_ERROR;
+  decoder.buffer_len = config->pdu_buffer_len;
+  decoder.pdu_buffer = (uint8_t*)malloc(config->pdu_buffer_len);
+  if (!decoder.pdu_buffer) {
+    return;
+  }
+
+  AhdlcDecoderInit(&decoder, config->crc_cb, NULL);
+  AhdlcDecoderSetCrcMode(&decoder, DECODE_CRC_PER_FRAME);
+
+  while (done < chunk->length) {
+    uint32_t piece = (chunk->length - done > PARALLEL_MAX_PIECE)
+                     ? PARALLEL_MAX_PIECE : (uint32_t)(chunk->length - done);
+    uint32_t offset = 0;
+
+    while (DecoderBufferNext(&decoder, &chunk->start[done], piece, &offset,
+                             &frame) == AHDLC_COMPLETE) {
+      if (parallelAddFrame(chunk, &payload_used, &frame,
+                           chunk->offset + done + frame.end_offset)
+          != AHDLC_OK) {
+        free(decoder.pdu_buffer);
+        return;
+      }
+    }
+    done += piece;
+  }
+  free(decoder.pdu_buffer);
+
+  /* Give back what the payloads did not use, then point frames at them */
+  if (payload_used && payload_used < chunk->payload_cap) {
+    uint8_t *payloads = (uint8_t*)realloc(chunk->payloads, payload_used);
+    if (payloads) {
+      chunk->payloads = payloads;
+    }
+  }
+  payload_used = 0;
+  for (i = 0; i < chunk->num_frames; ++i) {
+    chunk->frames[i].payload = &chunk->payloads[payload_used];
+    payload_used += chunk->frames[i].payload_len;
+  }
+
+  chunk->stats = decoder.stats;
+  chunk->code = AHDLC_OK;
+}
+
+static void *parallelWorker(void *arg) {
+  parallel_job_t *job = (parallel_job_t*)arg;
+
+  for (;;) {
+    uint32_t next;
+
+    pthread_mutex_lock(&job->lock);
+    next = job->next_chunk++;
+    pthread_mutex_unlock(&job->lock);
+
+    if (next >= job->num_chunks) {
+      break;
+    }
+    parallelDecodeChunk(job->config, &job->chunks[next]);
+  }
+
+  return NULL;
+}
+
+/*
+ * Cuts the capture just after the first frame_marker at or beyond every
+ * multiple of chunk_size. Returns the number of chunks, 0 on no memory.
+ */
+static uint32_t parallelSplit(const uint8_t *buffer, size_t length,
+                              size_t chunk_size, parallel_chunk_t **chunks) {
+  uint64_t max_chunks = length / chunk_size + 1;
+  uint32_t num_chunks = 0;
+  size_t start = 0;
+  size_t nominal;
+
+  *chunks = (parallel_chunk_t*)calloc(max_chunks, sizeof(parallel_chunk_t));
+  if (!*chunks) {
+    return 0;
+  }
+
+  for (nominal = chunk_size; ; nominal += chunk_size) {
+    const uint8_t *marker = NULL;
+    size_t end = length;
+
+    if (nominal < length) {
+      if (nominal < start) {
+        continue;
+      }
+      marker = (const uint8_t*)memchr(&buffer[nominal], frame_marker,
+                                      length - nominal);
+    }
+    if (marker && marker + 1 < buffer + length) {
+      end = (size_t)(marker - buffer) + 1;
+    }
+
+    (*chunks)[num_chunks].start = &buffer[start];
+    (*chunks)[num_chunks].length = end - start;
+    (*chunks)[num_chunks].offset = start;
+    ++num_chunks;
+    start = end;
+
+    if (end == length) {
+      break;
+    }
+  }
+
+  return num_chunks;
+}
+
+/*
+ * Adds the stats of a chunk to those of the chunks before it. Each chunk
+ * checked its first data frame against sequence 0, redo that against the
+ * sequence the previous chunks left off at.
+ */
+static void parallelAddStats(ahdlc_decoder_stats *sum,
+                             const parallel_chunk_t *chunk) {
+  const ahdlc_decoder_stats *add = &chunk->stats;
+  uint64_t i;
+
+  sum->num_decoded_bad_crc += add->num_decoded_bad_crc;
+  sum->good_frame_cnt += add->good_frame_cnt;
+  sum->invalid_escape_cnt += add->invalid_escape_cnt;
+  sum->out_of_sequence_cnt += add->out_of_sequence_cnt;
+  sum->out_of_frame_byte_cnt += add->out_of_frame_byte_cnt;
+  sum->encryption_engine_callback_cnt += add->encryption_engine_callback_cnt;
+  sum->crc_calc_callback_cnt += add->crc_calc_callback_cnt;
+  sum->frame_too_small_cnt += add->frame_too_small_cnt;
+  sum->resync_discard_byte_cnt += add->resync_discard_byte_cnt;
+  sum->decompress_error_cnt += add->decompress_error_cnt;
+
+  for (i = 0; i < chunk->num_frames; ++i) {
+    uint8_t sequence = chunk->frames[i].sequence;
+
+    if (chunk->frames[i].control_bits.bit.frame_is_ack) {
+      continue;
+    }
+    sum->out_of_sequence_cnt -= (sequence != 0);
+    sum->out_of_sequence_cnt += (sequence != sum->expected_sequence_number);
+    sum->expected_sequence_number = add->expected_sequence_number;
+    break;
+  }
+}
+
+ahdlc_op_return AhdlcParallelDecode(const uint8_t *buffer, size_t length,
+    const ahdlc_parallel_config_t *config, ahdlc_parallel_result_t *result) {
+  size_t chunk_size = config->chunk_size ? config->chunk_size
+                                         : PARALLEL_DEFAULT_CHUNK;
+  uint32_t num_threads = config->num_threads ? config->num_threads : 1;
+  ahdlc_op_return code = AHDLC_OK;
+  pthread_t *threads = NULL;
+  uint32_t started = 0;
+  parallel_job_t job;
+  uint64_t frame;
+  uint32_t i;
+
+  memset(result, 0, sizeof(*result));
+  if (!config->crc_cb || !config->pdu_buffer_len) {
+    return AHDLC_ERROR;
+  }
+  if (!length) {
+    return AHDLC_OK;
+  }
+
+  job.config = config;
+  job.next_chunk = 0;
+  job.num_chunks = parallelSplit(buffer, length, chunk_size, &job.chunks);
+  if (!job.num_chunks) {
+    return AHDLC_ERROR;
+  }
+  pthread_mutex_init(&job.lock, NULL);
+
+  /* The calling thread is one of the workers */
+  if (num_threads > job.num_chunks) {
+    num_threads = job.num_chunks;
+  }
+  if (num_threads > 1) {
+    threads = (pthread_t*)malloc((num_threads - 1) * sizeof(pthread_t));
+  }
+  for (i = 0; threads && i < num_threads - 1; ++i) {
+    if (pthread_create(&threads[started], NULL, parallelWorker, &job)) {
+      break;
+    }
+    ++started;
+  }
+  parallelWorker(&job);
+  for (i = 0; i < started; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+  free(threads);
+  pthread_mutex_destroy(&job.lock);
+
+  /* Concatenate in capture order */
+  for (i = 0; i < job.num_chunks; ++i) {
+    if (job.chunks[i].code != AHDLC_OK) {
+      code = AHDLC_ERROR;
+    }
+    result->num_frames += job.chunks[i].num_frames;
+    parallelAddStats(&result->stats, &job.chunks[i]);
+  }
+
+  result->payload_blocks = (uint8_t**)calloc(job.num_chunks,
+                                             sizeof(uint8_t*));
+  if (result->num_frames) {
+    result->frames = (ahdlc_capture_frame_t*)malloc(
+        result->num_frames * sizeof(ahdlc_capture_frame_t));
+  }
+  if (!result->payload_blocks || (result->num_frames && !result->frames)) {
+    code = AHDLC_ERROR;
+  }
+
+  frame = 0;
+  for (i = 0; i < job.num_chunks; ++i) {
+    if (code == AHDLC_OK) {
+      memcpy(&result->frames[frame], job.chunks[i].frames,
+             job.chunks[i].num_frames * sizeof(ahdlc_capture_frame_t));
+      frame += job.chunks[i].num_frames;
+      result->payload_blocks[result->num_blocks++] = job.chunks[i].payloads;
+    } else {
+      free(job.chunks[i].payloads);
+    }
+    free(job.chunks[i].frames);
+  }
+  free(job.chunks);
+
+  if (code != AHDLC_OK) {
+    AhdlcParallelResultFree(result);
+  }
+
+  return code;
+}
+
+void AhdlcParallelResultFree(ahdlc_parallel_result_t *result) {
+  uint32_t i;
+
+  for (i = 0; i < result->num_blocks; ++i) {
+    free(result->payload_blocks[i]);
+  }
+  free(result->payload_blocks);
+  free(result->frames);
+  memset(result, 0, sizeof(*result));
+}
@@ -0,0 +1,438 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * Decodes a raw capture of a link: the file is mmapped and run through the
+ * bulk decoder one frame_marker to the next, and every good frame and every
+ * decode error is written out with its offset in the capture.
+ *
+ * CSV, the default, one row per event:
+ *
+ *   offset,end_offset,event,payload_len,control,sequence,ack_num[,payload]
+ *
+ * event is frame, bad_crc, invalid_escape, bad_control, too_small or
+ * bad_compression, a compressed frame with a good CRC that did not expand.
+ * offset is the opening frame_marker of a frame, or the byte at fault for
+ * invalid_escape and bad_control; end_offset is just past the closing
+ * marker. --payload adds the payload of frames in hex.
+ *
+ * --binary writes an indexed file instead, integers little endian:
+ *
+ *   "AHDLCRP1"
+ *   records, each replay_record_t followed by payload_len payload bytes
+ *   index, the file position of each record as a uint64
+ *   num_records uint64, index position uint64, "AHDLCIDX"
+ *
+ * Usage: ahdlc_replay [--ccitt] [--binary] [--payload] [--max-pdu N]
+ *                     capture [output]
+ *
+ * --max-pdu N is the largest payload, up to the default of 65533 bytes.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../lib/inc/crc_16.h"
+#include "../lib/inc/frame_layer.h"
+
+/* Bytes handed to the decoder per call, which takes 32 bit lengths */
+#define REPLAY_PIECE      (1u << 30)
+/* Capture bytes mapped in and read ahead at a time, a multiple of pages */
+#define REPLAY_WINDOW     (64u << 20)
+/* frame_info.buffer_index is 16 bits and counts the CRC with the payload */
+#define REPLAY_MAX_PDU    ((uint32_t)UINT16_MAX - crc_size)
+#define REPLAY_OUT_BUFFER (1u << 20)
+
+typedef enum {
+  REPLAY_FRAME           = 0,
+  REPLAY_BAD_CRC         = 1,
+  REPLAY_INVALID_ESCAPE  = 2,
+  REPLAY_BAD_CONTROL     = 3,
+  REPLAY_TOO_SMALL       = 4,
+  REPLAY_BAD_COMPRESSION = 5
+}replay_event;
+
+static const char *const replay_event_names[] = {
+  "frame", "bad_crc", "invalid_escape", "bad_control", "too_small",
+  "bad_compression"
+};
+
+typedef struct {
+  uint64_t offset;
+  uint64_t end_offset;
+  uint32_t payload_len;    /* Payload bytes following, frames only */
+  uint8_t event;           /* replay_event */
+  uint8_t control;
+  uint8_t sequence;
+  uint8_t ack_num;
+}__attribute__((packed)) replay_record_t;
+
+/* The frame being decoded, from its opening frame_marker */
+typedef struct {
+  uint64_t start;
+  uint8_t marked;          /* Clear for bytes before the first marker */
+  ahdlc_decoder_stats stats;  /* When it opened */
+}replay_frame_t;
+
+typedef struct {
+  FILE *out;
+  uint8_t binary;
+  uint8_t payload;
+  uint64_t position;       /* Bytes written to out */
+  uint64_t *index;         /* Record positions, --binary only */
+  uint64_t num_records;
+  uint64_t max_records;
+  uint64_t events[REPLAY_BAD_COMPRESSION + 1];
+}replay_output_t;
+
+static double replayNow(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int replayWrite(replay_output_t *out, const void *data, size_t len) {
+  if (len && fwrite(data, 1, len, out->out) != len) {
+    return -1;
+  }
+  out->position += len;
+  return 0;
+}
+
+static int replayEmit(replay_output_t *out, replay_event event,
+                      uint64_t offset, uint64_t end_offset,
+                      const ahdlc_decoded_frame_t *frame) {
+  static const char hex[] = "0123456789abcdef";
+  replay_record_t record;
+  uint32_t i;
+
+  memset(&record, 0, sizeof(record));
+  record.offset = offset;
+  record.end_offset = end_offset;
+  record.event = (uint8_t)event;
+  if (frame) {
+    record.payload_len = frame->payload_len;
+    record.control = frame->control_bits.value;
+    record.sequence = frame->sequence;
+    record.ack_num = frame->ack_num;
+  }
+  ++out->events[event];
+
+  if (!out->binary) {
+    if (fprintf(out->out, "%llu,%llu,%s,%u,%u,%u,%u",
+                (unsigned long long)offset, (unsigned long long)end_offset,
+                replay_event_names[event], record.payload_len,
+                record.control, record.sequence, record.ack_num) < 0) {
+      return -1;
+    }
+    if (out->payload) {
+      putc(',', out->out);
+      for (i = 0; i < record.payload_len; ++i) {
+        putc(hex[frame->payload[i] >> 4], out->out);
+        putc(hex[frame->payload[i] & 0xF], out->out);
+      }
+    }
+    return (putc('\n', out->out) == EOF) ? -1 : 0;
+  }
+
+  if (out->num_records == out->max_records) {
+    uint64_t max_records = out->max_records ? 2 * out->max_records : 4096;
+    uint64_t *index = (uint64_t*)realloc(out->index,
+                                         max_records * sizeof(uint64_t));
+    if (!index) {
+      return -1;
+    }
+    out->index = index;
+    out->max_records = max_records;
+  }
+  out->index[out->num_records++] = out->position;
+
+  if (replayWrite(out, &record, sizeof(record))) {
+    return -1;
+  }
+  return frame ? replayWrite(out, frame->payload, frame->payload_len) : 0;
+}
+
+/* The first escape_marker not followed by a byte that may be escaped */
+static uint64_t replayFindBadEscape(const uint8_t *base, uint64_t start,
+                                    uint64_t end) {
+  uint64_t i;
+
+  for (i = start; i + 1 < end; ++i) {
+    if (base[i] == escape_marker && base[i + 1] != escaped_start &&
+        base[i + 1] != escaped_escape) {
+      return i;
+    }
+  }
+  return start;
+}
+
+/*
+ * Decodes [start, end) of the mapping, which ends just past a frame_marker,
+ * at the end of a piece or at the end of the capture, so it closes at most
+ * one frame. Errors are told apart by the decoder stats the frame moved; a
+ * frame that ends with none of them and no good frame had a control byte
+ * the decoder would not take. A frame cut off by the end of the capture is
+ * not reported.
+ */
+static int replaySpan(replay_output_t *out, ahdlc_frame_decoder_t *dec,
+                      replay_frame_t *open, const uint8_t *base,
+                      uint64_t piece, uint64_t start, uint64_t end) {
+  ahdlc_decoder_stats before = open->stats;
+  ahdlc_decoded_frame_t frame;
+  uint32_t offset = (uint32_t)(start - piece);
+  uint64_t opened = open->start;
+  uint8_t marked = open->marked;
+
+  ahdlc_op_return code = DecoderBufferNext(dec, base + piece,
+      (uint32_t)(end - piece), &offset, &frame);
+
+  if (base[end - 1] != frame_marker) {
+    return 0;
+  }
+  /* The closing marker opens the next frame */
+  open->start = end - 1;
+  open->marked = 1;
+  open->stats = dec->stats;
+
+  if (code == AHDLC_COMPLETE) {
+    return replayEmit(out, REPLAY_FRAME, opened, end, &frame);
+  }
+
+  if (dec->stats.invalid_escape_cnt != before.invalid_escape_cnt) {
+    return replayEmit(out, REPLAY_INVALID_ESCAPE,
+                      replayFindBadEscape(base, opened, end), end, NULL);
+  }
+  if (dec->stats.num_decoded_bad_crc != before.num_decoded_bad_crc) {
+    return replayEmit(out, REPLAY_BAD_CRC, opened, end, NULL);
+  }
+  if (dec->stats.frame_too_small_cnt != before.frame_too_small_cnt) {
+    return replayEmit(out, REPLAY_TOO_SMALL, opened, end, NULL);
+  }
+  if (dec->stats.decompress_error_cnt != before.decompress_error_cnt) {
+    return replayEmit(out, REPLAY_BAD_COMPRESSION, opened, end, NULL);
+  }
+  /* Back to back markers are no frame at all */
+  if (marked && end - opened > 2) {
+    return replayEmit(out, REPLAY_BAD_CONTROL, opened + 1, end, NULL);
+  }
+  return 0;
+}
+
+/*
+ * Called as the decoder reaches window start: maps that window in one go,
+ * starts reading the one after it and unmaps the one before, so faults
+ * come a window at a time and resident memory stays a few windows.
+ */
+static void replayAdvise(const uint8_t *base, uint64_t size, uint64_t start) {
+  uint64_t len = (size - start < REPLAY_WINDOW) ? size - start : REPLAY_WINDOW;
+
+#ifdef MADV_POPULATE_READ
+  madvise((void*)(base + start), len, MADV_POPULATE_READ);
+#endif
+  if (start + len < size) {
+    uint64_t ahead = size - (start + len);
+    madvise((void*)(base + start + len),
+            (ahead < REPLAY_WINDOW) ? ahead : REPLAY_WINDOW, MADV_WILLNEED);
+  }
+  if (start >= REPLAY_WINDOW) {
+    madvise((void*)(base + start - REPLAY_WINDOW), REPLAY_WINDOW,
+            MADV_DONTNEED);
+  }
+}
+
+static int replayFinish(replay_output_t *out) {
+  static const char trailer[8] = {'A', 'H', 'D', 'L', 'C', 'I', 'D', 'X'};
+  uint64_t index_position = out->position;
+
+  if (!out->binary) {
+    return 0;
+  }
+  if (replayWrite(out, out->index, out->num_records * sizeof(uint64_t)) ||
+      replayWrite(out, &out->num_records, sizeof(out->num_records)) ||
+      replayWrite(out, &index_position, sizeof(index_position)) ||
+      replayWrite(out, trailer, sizeof(trailer))) {
+    return -1;
+  }
+  return 0;
+}
+
+static int usage(const char *name) {
+  fprintf(stderr, "usage: %s [--ccitt] [--binary] [--payload] "
+          "[--max-pdu N] capture [output]\n", name);
+  return 1;
+}
+
+int main(int argc, char **argv) {
+  static const char magic[8] = {'A', 'H', 'D', 'L', 'C', 'R', 'P', '1'};
+  ahdlc_frame_decoder_t dec;
+  replay_output_t out;
+  uint8_t *lz_scratch;
+  crc_callback crc_cb = CRC16Sliced;
+  uint32_t max_pdu = REPLAY_MAX_PDU;
+  const char *capture = NULL;
+  const char *output = NULL;
+  const uint8_t *base;
+  struct stat st;
+  uint64_t size;
+  uint64_t pos;
+  uint64_t piece;
+  uint64_t advised = 0;
+  replay_frame_t frame;
+  double start_time;
+  double elapsed;
+  int status = 0;
+  int fd;
+  int i;
+
+  memset(&out, 0, sizeof(out));
+  memset(&frame, 0, sizeof(frame));
+  for (i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--ccitt")) {
+      crc_cb = CRC16CCITT;
+    } else if (!strcmp(argv[i], "--binary")) {
+      out.binary = 1;
+    } else if (!strcmp(argv[i], "--payload")) {
+      out.payload = 1;
+    } else if (!strcmp(argv[i], "--max-pdu") && i + 1 < argc) {
+      max_pdu = (uint32_t)strtoul(argv[++i], NULL, 0);
+    } else if (argv[i][0] == '-' && argv[i][1]) {
+      return usage(argv[0]);
+    } else if (!capture) {
+      capture = argv[i];
+    } else if (!output) {
+      output = argv[i];
+    } else {
+      return usage(argv[0]);
+    }
+  }
+  if (max_pdu > REPLAY_MAX_PDU) {
+    fprintf(stderr, "--max-pdu is at most %u\n", (unsigned)REPLAY_MAX_PDU);
+    return 1;
+  }
+  if (!capture || !max_pdu) {
+    return usage(argv[0]);
+  }
+
+  fd = open(capture, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    fprintf(stderr, "%s: %s\n", capture, strerror(errno));
+    return 1;
+  }
+  size = (uint64_t)st.st_size;
+  base = NULL;
+  if (size) {
+    base = (const uint8_t*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) {
+      fprintf(stderr, "%s: mmap: %s\n", capture, strerror(errno));
+      return 1;
+    }
+    madvise((void*)base, size, MADV_SEQUENTIAL);
+  }
+
+  out.out = output ? fopen(output, "wb") : stdout;
+  if (!out.out) {
+    fprintf(stderr, "%s: %s\n", output, strerror(errno));
+    return 1;
+  }
+  setvbuf(out.out, NULL, _IOFBF, REPLAY_OUT_BUFFER);
+  if (out.binary) {
+    status = replayWrite(&out, magic, sizeof(magic));
+  } else {
+    status = (fprintf(out.out, "offset,end_offset,event,payload_len,control,"
+                      "sequence,ack_num%s\n",
+                      out.payload ? ",payload" : "") < 0);
+  }
+
+  dec.buffer_len = max_pdu + crc_size;
+  dec.pdu_buffer = (uint8_t*)malloc(dec.buffer_len);
+  /* Compressed payloads are copied out here and expanded into pdu_buffer */
+  lz_scratch = (uint8_t*)malloc(dec.buffer_len);
+  if (!dec.pdu_buffer || !lz_scratch ||
+      AhdlcDecoderInit(&dec, crc_cb, NULL) != AHDLC_OK ||
+      AhdlcDecoderSetCrcMode(&dec, DECODE_CRC_PER_FRAME) != AHDLC_OK ||
+      AhdlcDecoderSetCompression(&dec, lz_scratch,
+                                 dec.buffer_len) != AHDLC_OK) {
+    fprintf(stderr, "decoder init failed\n");
+    return 1;
+  }
+
+  start_time = replayNow();
+  for (pos = 0, piece = 0; pos < size && !status;) {
+    const uint8_t *marker;
+    uint64_t end;
+
+    if (pos - piece >= REPLAY_PIECE) {
+      /* Decoder state carries over, pieces may split a frame anywhere */
+      piece = pos;
+    }
+    while (pos >= advised) {
+      replayAdvise(base, size, advised);
+      advised += REPLAY_WINDOW;
+    }
+
+    end = piece + REPLAY_PIECE;
+    if (end > size) {
+      end = size;
+    }
+    marker = (const uint8_t*)memchr(base + pos, frame_marker, end - pos);
+    if (marker) {
+      end = (uint64_t)(marker - base) + 1;
+    }
+    status = replaySpan(&out, &dec, &frame, base, piece, pos, end);
+    pos = end;
+  }
+  elapsed = replayNow() - start_time;
+
+  if (!status) {
+    status = replayFinish(&out);
+  }
+  if (fflush(out.out) != 0 || status) {
+    fprintf(stderr, "write failed: %s\n", strerror(errno));
+    return 1;
+  }
+
+  fprintf(stderr, "%llu bytes in %.3f s, %.1f MB/s: %llu frames, "
+          "%llu bad_crc, %llu invalid_escape, %llu bad_control, "
+          "%llu too_small, %llu bad_compression\n",
+          (unsigned long long)size, elapsed,
+          elapsed > 0 ? size / elapsed / 1e6 : 0.0,
+          (unsigned long long)out.events[REPLAY_FRAME],
+          (unsigned long long)out.events[REPLAY_BAD_CRC],
+          (unsigned long long)out.events[REPLAY_INVALID_ESCAPE],
+          (unsigned long long)out.events[REPLAY_BAD_CONTROL],
+          (unsigned long long)out.events[REPLAY_TOO_SMALL],
+          (unsigned long long)out.events[REPLAY_BAD_COMPRESSION]);
+
+  if (output) {
+    fclose(out.out);
+  }
+  if (size) {
+    munmap((void*)base, size);
+  }
+  close(fd);
+  free(dec.pdu_buffer);
+  free(lz_scratch);
+  free(out.index);
+  return 0;
+}
@@ -0,0 +1,291 @@
+/* Copyright 2018 Google LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      https://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <pty.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "../../coro/ahdlc_link.h"
+
+using std::vector;
+
+static void setNonblocking(int fd) {
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+/* Payload i is i % 1500 bytes, specials included, tagged with i */
+static vector<uint8_t> testPayload(uint32_t i) {
+  vector<uint8_t> payload(2 + i % 1500);
+
+  payload[0] = (uint8_t)i;
+  payload[1] = (uint8_t)(i >> 8);
+  for (size_t b = 2; b < payload.size(); ++b) {
+    payload[b] = (uint8_t)(b * 7 + i);
+  }
+  return payload;
+}
+
+struct Peer {
+  ahdlc::Link *link;
+  uint32_t num_frames;
+  uint32_t received = 0;
+  uint32_t mismatches = 0;
+  bool done = false;
+  ahdlc_op_return last_status = AHDLC_OK;
+};
+
+static ahdlc::Task sendFrames(Peer *peer) {
+  for (uint32_t i = 0; i < peer->num_frames; ++i) {
+    vector<uint8_t> payload = testPayload(i);
+    if (co_await peer->link->Send(payload) != AHDLC_OK) {
+      ++peer->mismatches;
+    }
+  }
+}
+
+static ahdlc::Task echoFrames(Peer *peer) {
+  for (;;) {
+    ahdlc::Frame frame = co_await peer->link->NextFrame();
+    peer->last_status = frame.status;
+    if (frame.status != AHDLC_COMPLETE) {
+      break;
+    }
+    /* Straight from the read buffer into the write buffer */
+    if (co_await peer->link->Send(frame.payload) != AHDLC_OK) {
+      ++peer->mismatches;
+    }
+  }
+  peer->done = true;
+}
+
+static ahdlc::Task checkFrames(Peer *peer) {
+  while (peer->received < peer->num_frames) {
+    ahdlc::Frame frame = co_await peer->link->NextFrame();
+    peer->last_status = frame.status;
+    if (frame.status != AHDLC_COMPLETE) {
+      break;
+    }
+    vector<uint8_t> expected = testPayload(peer->received++);
+    if (frame.payload.size() != expected.size() ||
+        memcmp(frame.payload.data(), expected.data(), expected.size())) {
+      ++peer->mismatches;
+    }
+  }
+  peer->done = true;
+}
+
+static void runUntil(ahdlc::EventLoop *loop, const vector<Peer*> &peers) {
+  for (uint32_t turn = 0; turn < 100000; ++turn) {
+    bool done = true;
+    for (Peer *peer : peers) {
+      done = done && peer->done;
+    }
+    if (done) {
+      return;
+    }
+    ASSERT_GE(loop->RunOnce(100), 0);
+  }
+  FAIL() << "peers did not finish";
+}
+
+TEST(LinkTest, SocketPairEcho) {
+  ahdlc::EventLoop loop;
+  int fds[2];
+
+  ASSERT_TRUE(loop.ok());
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds));
+  {
+    ahdlc::Link client_link(&loop, fds[0]);
+    ahdlc::Link server_link(&loop, fds[1]);
+    ASSERT_TRUE(client_link.ok());
+    ASSERT_TRUE(server_link.ok());
+
+    Peer client = {&client_link, 2000};
+    Peer server = {&server_link, 0};
+    checkFrames(&client);
+    echoFrames(&server);
+    sendFrames(&client);
+    runUntil(&loop, {&client});
+
+    EXPECT_EQ(2000u, client.received);
+    EXPECT_EQ(0u, client.mismatches);
+    EXPECT_EQ(0u, server.mismatches);
+    EXPECT_EQ(2000u, server_link.stats().frames_received);
+    EXPECT_EQ(2000u, server_link.stats().frames_sent);
+    EXPECT_EQ(0u, server_link.decoder_stats().num_decoded_bad_crc);
+    /* Many frames per read() and per write() */
+    EXPECT_LT(server_link.stats().read_calls * 4, 2000u);
+    EXPECT_LT(server_link.stats().write_calls * 4, 2000u);
+
+    /* The server sees the end of the stream */
+    close(fds[0]);
+    client_link.Close();
+    runUntil(&loop, {&server});
+    EXPECT_EQ(AHDLC_ERROR, server.last_status);
+  }
+  close(fds[1]);
+}
+
+TEST(LinkTest, ManyLinksOneThread) {
+  const uint32_t num_pairs = 16;
+  ahdlc::EventLoop loop;
+  vector<ahdlc::Link*> links;
+  vector<Peer> peers;
+  vector<Peer*> receivers;
+  vector<int> fds;
+  ahdlc::LinkConfig config;
+
+  /* Small buffers, so writers wait for room and readers for data */
+  config.rx_buffer_size = 4096;
+  config.tx_buffer_size = 4096;
+  config.max_batch_frames = 4;
+  peers.reserve(2 * num_pairs);
+  for (uint32_t i = 0; i < num_pairs; ++i) {
+    int pair[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, pair));
+    fds.push_back(pair[0]);
+    fds.push_back(pair[1]);
+    links.push_back(new ahdlc::Link(&loop, pair[0], config));
+    links.push_back(new ahdlc::Link(&loop, pair[1], config));
+    peers.push_back(Peer{links[2 * i], 300});
+    peers.push_back(Peer{links[2 * i + 1], 300});
+    sendFrames(&peers[2 * i]);
+    checkFrames(&peers[2 * i + 1]);
+    receivers.push_back(&peers[2 * i + 1]);
+  }
+  runUntil(&loop, receivers);
+
+  for (Peer *peer : receivers) {
+    EXPECT_EQ(300u, peer->received);
+    EXPECT_EQ(0u, peer->mismatches);
+  }
+  for (uint32_t i = 0; i < links.size(); ++i) {
+    delete links[i];
+    close(fds[i]);
+  }
+}
+
+TEST(LinkTest, PtyPair) {
+  ahdlc::EventLoop loop;
+  struct termios raw;
+  int master;
+  int slave;
+
+  ASSERT_EQ(0, openpty(&master, &slave, NULL, NULL, NULL));
+  ASSERT_EQ(0, tcgetattr(slave, &raw));
+  cfmakeraw(&raw);
+  ASSERT_EQ(0, tcsetattr(slave, TCSANOW, &raw));
+  setNonblocking(master);
+  setNonblocking(slave);
+  {
+    ahdlc::Link master_link(&loop, master);
+    ahdlc::Link slave_link(&loop, slave);
+    Peer sender = {&master_link, 500};
+    Peer receiver = {&slave_link, 500};
+    Peer reply_sender = {&slave_link, 100};
+    Peer reply_receiver = {&master_link, 100};
+
+    checkFrames(&receiver);
+    checkFrames(&reply_receiver);
+    sendFrames(&sender);
+    sendFrames(&reply_sender);
+    runUntil(&loop, {&receiver, &reply_receiver});
+    EXPECT_EQ(500u, receiver.received);
+    EXPECT_EQ(0u, receiver.mismatches);
+    EXPECT_EQ(100u, reply_receiver.received);
+    EXPECT_EQ(0u, reply_receiver.mismatches);
+
+    /* Hanging up the slave side ends the master's reads */
+    Peer watcher = {&master_link, 1};
+    checkFrames(&watcher);
+    slave_link.Close();
+    close(slave);
+    runUntil(&loop, {&watcher});
+    EXPECT_EQ(AHDLC_ERROR, watcher.last_status);
+  }
+  close(master);
+}
+
+TEST(LinkTest, CloseAndOversizedSend) {
+  ahdlc::EventLoop loop;
+  ahdlc::LinkConfig config;
+  int fds[2];
+
+  config.tx_buffer_size = 256;
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds));
+  {
+    ahdlc::Link link(&loop, fds[0], config);
+    Peer reader = {&link, 1};
+    Peer writer = {&link, 200};
+
+    checkFrames(&reader);
+    EXPECT_FALSE(reader.done);
+    /* Frame 122 and on can never fit the write buffer */
+    sendFrames(&writer);
+    loop.RunOnce(0);
+    EXPECT_EQ(200u - 122u, writer.mismatches);
+
+    link.Close();
+    runUntil(&loop, {&reader});
+    EXPECT_EQ(AHDLC_ERROR, reader.last_status);
+  }
+  close(fds[0]);
+  close(fds[1]);
+}
+
+static ahdlc::Task sendOversized(Peer *peer) {
+  /* Every byte escaped, 80006 bytes encoded, more than a frame can hold */
+  vector<uint8_t> oversized(40000, 0x7E);
+
+  peer->last_status = co_await peer->link->Send(oversized);
+  sendFrames(peer);
+}
+
+TEST(LinkTest, OversizedFrameLargeBuffers) {
+  ahdlc::EventLoop loop;
+  ahdlc::LinkConfig config;
+  int fds[2];
+
+  config.tx_buffer_size = 1 << 20;
+  config.rx_buffer_size = 1 << 20;
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds));
+  {
+    ahdlc::Link sender_link(&loop, fds[0], config);
+    ahdlc::Link reader_link(&loop, fds[1], config);
+    Peer writer = {&sender_link, 100};
+    Peer reader = {&reader_link, 100};
+
+    checkFrames(&reader);
+    sendOversized(&writer);
+    EXPECT_EQ(AHDLC_ERROR, writer.last_status);
+    runUntil(&loop, {&reader});
+    EXPECT_EQ(0u, writer.mismatches);
+    EXPECT_EQ(0u, reader.mismatches);
+    EXPECT_EQ(100u, reader.received);
+    EXPECT_EQ(100u, sender_link.stats().frames_sent);
+    EXPECT_EQ(sender_link.stats().bytes_written,
+              reader_link.stats().bytes_read);
+    EXPECT_EQ(0u, reader_link.decoder_stats().num_decoded_bad_crc);
+  }
+  close(fds[0]);
+  close(fds[1]);
+}
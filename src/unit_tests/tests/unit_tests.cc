@@ -15,15 +15,35 @@
 
 #include <gtest/gtest.h>
 
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <deque>
 #include <string>
+#include <vector>
 
+#include "../../lib/inc/arq.h"
+#include "../../lib/inc/byte_ring.h"
 #include "../../lib/inc/crc_16.h"
+#include "../../lib/inc/crc_16_gen.h"
+#include "../../lib/inc/fragment.h"
 #include "../../lib/inc/frame_layer.h"
+#include "../../lib/inc/frame_pool.h"
+#include "../../lib/inc/frame_scan.h"
+#include "../../lib/inc/link_driver.h"
+#include "../../lib/inc/lz_compress.h"
+#include "../../lib/inc/multi_decoder.h"
+#include "../../lib/inc/parallel_decoder.h"
 
 using std::string;
+using std::vector;
 
 /* A simple string message including escape bytes */
 static const uint8_t test_ascii_message[] = "Sophie {~the~} Scientist";
@@ -439,6 +459,2358 @@ TEST_F(FrameTest, B34501481) {
 
 }
 
+/* Fills buffer with random bytes, roughly one in density being special */
+static void fillWithEscapes(uint8_t *buffer, uint32_t len, uint32_t density) {
+  for (uint32_t i = 0; i < len; ++i) {
+    buffer[i] = (uint8_t)(random() % 256);
+    if (density && (random() % density) == 0) {
+      buffer[i] = (random() % 2) ? frame_marker : escape_marker;
+    }
+  }
+}
+
+/* The number of CRC calls depends on the decode path taken */
+static bool sameDecoderStats(ahdlc_decoder_stats a, ahdlc_decoder_stats b) {
+  a.crc_calc_callback_cnt = b.crc_calc_callback_cnt = 0;
+  return !memcmp(&a, &b, sizeof(a));
+}
+
+static void expectSameDecoderState(const ahdlc_frame_decoder_t &a,
+                                   const ahdlc_frame_decoder_t &b) {
+  EXPECT_TRUE(sameDecoderStats(a.stats, b.stats));
+  EXPECT_EQ(0, memcmp(&a.crc_stack, &b.crc_stack, sizeof(a.crc_stack)));
+  EXPECT_EQ(a.decoder_state, b.decoder_state);
+  EXPECT_EQ(a.dfa_state, b.dfa_state);
+  EXPECT_EQ(a.frame_info.sequence, b.frame_info.sequence);
+  ASSERT_EQ(a.frame_info.buffer_index, b.frame_info.buffer_index);
+  EXPECT_EQ(0, memcmp(a.pdu_buffer, b.pdu_buffer, a.frame_info.buffer_index));
+}
+
+TEST_F(FrameTest, ScanSpecialTest) {
+  uint8_t buffer[300];
+
+  fillWithEscapes(buffer, sizeof(buffer), 40);
+
+  for (uint32_t start = 0; start < 64; ++start) {
+    for (uint32_t len = 0; start + len <= sizeof(buffer); len += 7) {
+      uint32_t expected = 0;
+      while (expected < len && buffer[start + expected] != frame_marker &&
+             buffer[start + expected] != escape_marker) {
+        ++expected;
+      }
+      ASSERT_EQ(expected, AhdlcScanSpecial(&buffer[start], len));
+    }
+  }
+}
+
+TEST_F(FrameTest, DecoderBufferMatchesBytePath) {
+  ahdlc_frame_decoder_t byte_dec;
+  ahdlc_frame_decoder_t bulk_dec;
+  ahdlc_frame_encoder_t enc;
+  uint8_t payload[700];
+
+  byte_dec.buffer_len = bulk_dec.buffer_len = 512;
+  byte_dec.pdu_buffer = (uint8_t*)malloc(byte_dec.buffer_len);
+  bulk_dec.pdu_buffer = (uint8_t*)malloc(bulk_dec.buffer_len);
+  enc.buffer_len = 2 * sizeof(payload) + 8;
+  enc.frame_buffer = (uint8_t*)malloc(enc.buffer_len);
+
+  ahdlcEncoderInit(&enc, CRC16);
+  AhdlcDecoderInit(&byte_dec, CRC16, NULL);
+  AhdlcDecoderInit(&bulk_dec, CRC16, NULL);
+
+  /* Escape density from none to every other byte, including frames that
+   * overflow pdu_buffer and frames split between the two entry points. */
+  for (uint32_t i = 0; i < 200; ++i) {
+    uint32_t len = random() % sizeof(payload);
+    fillWithEscapes(payload, len, i % 5 ? 1 + i % 50 : 0);
+
+    EncodeNewFrame(&enc);
+    EncodeBuffer(&enc, payload, len);
+    if (i % 7 == 3) {
+      /* Corrupt the CRC */
+      enc.frame_buffer[enc.frame_info.buffer_index - 2] ^= 0x01;
+    }
+
+    uint32_t split = (i % 3 == 0) ? random() % enc.frame_info.buffer_index : 0;
+
+    for (uint32_t j = 0; j < enc.frame_info.buffer_index; ++j) {
+      DecodeFrameByte(&byte_dec, enc.frame_buffer[j]);
+    }
+    for (uint32_t j = 0; j < split; ++j) {
+      DecodeFrameByte(&bulk_dec, enc.frame_buffer[j]);
+    }
+    DecoderBuffer(&bulk_dec, &enc.frame_buffer[split],
+        enc.frame_info.buffer_index - split);
+
+    expectSameDecoderState(byte_dec, bulk_dec);
+  }
+
+  EXPECT_LT(0u, bulk_dec.stats.good_frame_cnt);
+  EXPECT_LT(0u, bulk_dec.stats.num_decoded_bad_crc);
+  free(byte_dec.pdu_buffer);
+  free(bulk_dec.pdu_buffer);
+  free(enc.frame_buffer);
+}
+
+TEST_F(FrameTest, CRC16SlicedMatchesCRC16) {
+  uint8_t buffer[512];
+
+  fillWithEscapes(buffer, sizeof(buffer), 0);
+
+  for (uint32_t start = 0; start < 16; ++start) {
+    for (uint32_t len = 0; start + len <= sizeof(buffer); len += 1 + len / 8) {
+      uint16_t seed = (uint16_t)random();
+      ASSERT_EQ(CRC16(seed, &buffer[start], len),
+                CRC16Sliced(seed, &buffer[start], len));
+    }
+  }
+}
+
+TEST_F(FrameTest, CRC16FoldedMatchesCRC16) {
+  const uint32_t max_len = 5000;
+  uint8_t *buffer = (uint8_t*)malloc(max_len + 64);
+
+  fillWithEscapes(buffer, max_len + 64, 0);
+
+  for (uint32_t start = 0; start < 64; start += 3) {
+    for (uint32_t len = 0; len <= max_len; len += 1 + len / 16) {
+      uint16_t seed = (uint16_t)random();
+      ASSERT_EQ(CRC16(seed, &buffer[start], len),
+                CRC16Folded(seed, &buffer[start], len));
+    }
+  }
+  /* Every length around the fold span and threshold boundaries */
+  for (uint32_t len = 0; len < 200; ++len) {
+    ASSERT_EQ(CRC16(0, buffer, len), CRC16Folded(0, buffer, len));
+  }
+  free(buffer);
+}
+
+TEST_F(FrameTest, CRC16PeriodTest) {
+  /* The same bit flipped 16 bytes apart is invisible to CRC16(), which is
+   * what CRC16Folded() relies on. */
+  uint8_t buffer[100];
+
+  fillWithEscapes(buffer, sizeof(buffer), 0);
+  uint16_t crc = CRC16(0, buffer, sizeof(buffer));
+  buffer[10] ^= 0x5A;
+  buffer[26] ^= 0x5A;
+  EXPECT_EQ(crc, CRC16(0, buffer, sizeof(buffer)));
+}
+
+AHDLC_CRC16_DEFINE_KERNEL(testCrc16, 0xA001, REFLECTED, HIGH)
+AHDLC_CRC16_DEFINE_KERNEL(testKermit, 0x8408, REFLECTED, LOW)
+AHDLC_CRC16_DEFINE_KERNEL(testXmodem, 0x1021, NORMAL, HIGH)
+
+TEST_F(FrameTest, GeneratedCrcKernelsTest) {
+  const uint8_t check[] = "123456789";
+  uint8_t buffer[1000];
+
+  /* The preprocessor rebuilds the table CRC16() was written with */
+  fillWithEscapes(buffer, sizeof(buffer), 10);
+  EXPECT_EQ(CRC16(0x1234, buffer, sizeof(buffer)),
+            testCrc16(0x1234, buffer, sizeof(buffer)));
+
+  /* Published check values */
+  EXPECT_EQ(0x2189, testKermit(0, check, 9));
+  EXPECT_EQ(0x31C3, testXmodem(0, check, 9));
+  EXPECT_EQ(0x2189, CRC16CCITT(0, check, 9));
+  /* RFC 1662 FCS-16 */
+  EXPECT_EQ(0x906E, (uint16_t)~CRC16CCITT(0xFFFF, check, 9));
+}
+
+TEST_F(FrameTest, SpecializedByteCoresMatch) {
+  crc_callback crcs[] = {CRC16, CRC16CCITT};
+  uint8_t payload[300];
+  uint8_t generic_out[2 * sizeof(payload) + 8];
+  uint8_t special_out[sizeof(generic_out)];
+  ahdlc_frame_encoder_t generic_enc;
+  ahdlc_frame_encoder_t special_enc;
+  ahdlc_frame_decoder_t generic_dec;
+  ahdlc_frame_decoder_t special_dec;
+
+  generic_enc.frame_buffer = generic_out;
+  special_enc.frame_buffer = special_out;
+  generic_enc.buffer_len = special_enc.buffer_len = sizeof(generic_out);
+  generic_dec.buffer_len = special_dec.buffer_len = sizeof(payload) + 2;
+  generic_dec.pdu_buffer = (uint8_t*)malloc(generic_dec.buffer_len);
+  special_dec.pdu_buffer = (uint8_t*)malloc(special_dec.buffer_len);
+
+  for (uint32_t c = 0; c < 2; ++c) {
+    ahdlcEncoderInit(&generic_enc, crcs[c]);
+    ahdlcEncoderInit(&special_enc, crcs[c]);
+    AhdlcDecoderInit(&generic_dec, crcs[c], NULL);
+    AhdlcDecoderInit(&special_dec, crcs[c], NULL);
+
+    for (uint32_t i = 0; i < 50; ++i) {
+      uint32_t len = random() % sizeof(payload);
+      fillWithEscapes(payload, len, i);
+
+      EncodeNewFrame(&generic_enc);
+      EncodeNewFrame(&special_enc);
+      for (uint32_t j = 0; j < len; ++j) {
+        EncodeAddByteToFrameBuffer(&generic_enc, payload[j]);
+        if (c == 0) {
+          EncodeAddByteToFrameBufferCRC16(&special_enc, payload[j]);
+        } else {
+          EncodeAddByteToFrameBufferCRC16CCITT(&special_enc, payload[j]);
+        }
+      }
+      EncodeFinalize(&generic_enc);
+      EncodeFinalize(&special_enc);
+      ASSERT_EQ(generic_enc.frame_info.buffer_index,
+                special_enc.frame_info.buffer_index);
+      ASSERT_EQ(0, memcmp(generic_out, special_out,
+                          generic_enc.frame_info.buffer_index));
+
+      /* Corrupt some frames so the bad CRC path is compared too */
+      if (i % 5 == 4) {
+        generic_out[generic_enc.frame_info.buffer_index / 2] ^= 0x01;
+      }
+
+      for (uint32_t j = 0; j < generic_enc.frame_info.buffer_index; ++j) {
+        ahdlc_op_return generic_code =
+            DecodeFrameByte(&generic_dec, generic_out[j]);
+        ahdlc_op_return special_code = (c == 0)
+            ? DecodeFrameByteCRC16(&special_dec, generic_out[j])
+            : DecodeFrameByteCRC16CCITT(&special_dec, generic_out[j]);
+        ASSERT_EQ(generic_code, special_code);
+      }
+      expectSameDecoderState(generic_dec, special_dec);
+    }
+    EXPECT_EQ(40u, special_dec.stats.good_frame_cnt);
+  }
+  free(generic_dec.pdu_buffer);
+  free(special_dec.pdu_buffer);
+}
+
+TEST_F(FrameTest, PerFrameCrcMatchesPerByteCrc) {
+  ahdlc_frame_decoder_t byte_dec;
+  ahdlc_frame_decoder_t frame_dec;
+  ahdlc_frame_encoder_t enc;
+  uint8_t payload[600];
+
+  byte_dec.buffer_len = frame_dec.buffer_len = 512;
+  byte_dec.pdu_buffer = (uint8_t*)malloc(byte_dec.buffer_len);
+  frame_dec.pdu_buffer = (uint8_t*)malloc(frame_dec.buffer_len);
+  enc.buffer_len = 2 * sizeof(payload) + 8;
+  enc.frame_buffer = (uint8_t*)malloc(enc.buffer_len);
+
+  ahdlcEncoderInit(&enc, CRC16);
+  AhdlcDecoderInit(&byte_dec, CRC16, NULL);
+  AhdlcDecoderInit(&frame_dec, CRC16Folded, NULL);
+  EXPECT_EQ(AHDLC_OK, AhdlcDecoderSetCrcMode(&frame_dec, DECODE_CRC_PER_FRAME));
+
+  for (uint32_t i = 0; i < 300; ++i) {
+    uint32_t len = random() % sizeof(payload);
+    fillWithEscapes(payload, len, 1 + i % 30);
+
+    EncodeNewFrame(&enc);
+    EncodeBuffer(&enc, payload, len);
+    /* Corrupt some frames, truncate others to a couple of bytes */
+    if (i % 5 == 1) {
+      enc.frame_buffer[random() % enc.frame_info.buffer_index] ^= 0x10;
+    } else if (i % 11 == 2) {
+      enc.frame_info.buffer_index = 1 + i % 5;
+    }
+
+    for (uint32_t j = 0; j < enc.frame_info.buffer_index; ++j) {
+      ahdlc_op_return byte_code = DecodeFrameByte(&byte_dec,
+                                                  enc.frame_buffer[j]);
+      ahdlc_op_return frame_code = DecodeFrameByte(&frame_dec,
+                                                   enc.frame_buffer[j]);
+      if (enc.frame_buffer[j] == frame_marker) {
+        ASSERT_EQ(byte_code, frame_code);
+      }
+    }
+
+    EXPECT_TRUE(sameDecoderStats(byte_dec.stats, frame_dec.stats));
+    EXPECT_EQ(byte_dec.decoder_state, frame_dec.decoder_state);
+    ASSERT_EQ(byte_dec.frame_info.buffer_index,
+              frame_dec.frame_info.buffer_index);
+    EXPECT_EQ(0, memcmp(byte_dec.pdu_buffer, frame_dec.pdu_buffer,
+        byte_dec.frame_info.buffer_index));
+  }
+
+  EXPECT_LT(0u, frame_dec.stats.good_frame_cnt);
+  EXPECT_LT(0u, frame_dec.stats.num_decoded_bad_crc);
+  EXPECT_LT(0u, frame_dec.stats.frame_too_small_cnt);
+  free(byte_dec.pdu_buffer);
+  free(frame_dec.pdu_buffer);
+  free(enc.frame_buffer);
+}
+
+TEST_F(FrameTest, PerFrameCrcBulkDecode) {
+  ahdlc_frame_decoder_t dec;
+
+  dec.buffer_len = 1024;
+  dec.pdu_buffer = (uint8_t*)malloc(dec.buffer_len);
+  AhdlcDecoderInit(&dec, CRC16, NULL);
+  AhdlcDecoderSetCrcMode(&dec, DECODE_CRC_PER_FRAME);
+
+  encodeTestFrame(&encoder_handle);
+  EXPECT_EQ(AHDLC_COMPLETE, DecoderBuffer(&dec, encoder_handle.frame_buffer,
+      encoder_handle.frame_info.buffer_index));
+  EXPECT_EQ(sizeof(test_ascii_message), dec.frame_info.buffer_index);
+  EXPECT_EQ(0, memcmp(test_ascii_message, dec.pdu_buffer,
+      sizeof(test_ascii_message)));
+  EXPECT_EQ(AHDLC_ERROR, AhdlcDecoderSetCrcMode(&dec,
+      (ahdlc_decoder_crc_mode)7));
+  free(dec.pdu_buffer);
+}
+
+TEST_F(FrameTest, EncodeBufferMatchesBytePath) {
+  ahdlc_frame_encoder_t bulk_enc;
+  ahdlc_frame_encoder_t byte_enc;
+  uint8_t payload[400];
+
+  for (uint32_t i = 0; i < 200; ++i) {
+    /* Buffers from roomy down to too small for the escaped payload */
+    uint32_t len = random() % sizeof(payload);
+    bulk_enc.buffer_len = byte_enc.buffer_len = 8 + (i % 4 ? 2 * len : len);
+    bulk_enc.frame_buffer = (uint8_t*)malloc(bulk_enc.buffer_len);
+    byte_enc.frame_buffer = (uint8_t*)malloc(byte_enc.buffer_len);
+    ahdlcEncoderInit(&bulk_enc, CRC16);
+    ahdlcEncoderInit(&byte_enc, CRC16);
+    fillWithEscapes(payload, len, i % 3 ? 1 + i % 20 : 0);
+
+    EncodeNewFrame(&bulk_enc);
+    ahdlc_op_return bulk_code = EncodeBuffer(&bulk_enc, payload, len);
+
+    EncodeNewFrame(&byte_enc);
+    ahdlc_op_return byte_code = AHDLC_OK;
+    for (uint32_t j = 0; j < len && byte_code == AHDLC_OK; ++j) {
+      byte_code = EncodeAddByteToFrameBuffer(&byte_enc, payload[j]);
+    }
+    if (byte_code == AHDLC_OK) {
+      byte_code = EncodeFinalize(&byte_enc);
+    }
+
+    EXPECT_EQ(byte_code, bulk_code);
+    EXPECT_EQ(byte_enc.stats.encoder_state, bulk_enc.stats.encoder_state);
+    ASSERT_EQ(byte_enc.frame_info.buffer_index,
+              bulk_enc.frame_info.buffer_index);
+    EXPECT_EQ(0, memcmp(byte_enc.frame_buffer, bulk_enc.frame_buffer,
+        byte_enc.frame_info.buffer_index));
+    free(bulk_enc.frame_buffer);
+    free(byte_enc.frame_buffer);
+  }
+}
+
+/*
+ * Encodes random frames, with line noise between some of them, into stream.
+ * The noise never has the frame_valid bit set, so it cannot pass for a
+ * frame by chance.
+ */
+static void buildFrameStream(vector<uint8_t> *stream,
+                             vector<vector<uint8_t> > *payloads,
+                             uint32_t num_frames) {
+  ahdlc_frame_encoder_t enc;
+  uint8_t payload[300];
+
+  enc.buffer_len = 2 * sizeof(payload) + 8;
+  enc.frame_buffer = (uint8_t*)malloc(enc.buffer_len);
+  ahdlcEncoderInit(&enc, CRC16);
+
+  for (uint32_t i = 0; i < num_frames; ++i) {
+    uint32_t len = random() % sizeof(payload);
+    fillWithEscapes(payload, len, 1 + i % 40);
+    EncodeNewFrame(&enc);
+    EncodeBuffer(&enc, payload, len);
+
+    if (i % 4 == 3) {
+      uint8_t noise[16];
+      for (uint32_t j = 0; j < sizeof(noise); ++j) {
+        noise[j] = (uint8_t)(random() & 0xBF);
+      }
+      stream->insert(stream->end(), noise, noise + sizeof(noise));
+    }
+    stream->insert(stream->end(), enc.frame_buffer,
+                   enc.frame_buffer + enc.frame_info.buffer_index);
+    payloads->push_back(vector<uint8_t>(payload, payload + len));
+  }
+  free(enc.frame_buffer);
+}
+
+TEST_F(FrameTest, DecoderBufferNextTest) {
+  vector<uint8_t> stream;
+  vector<vector<uint8_t> > payloads;
+  ahdlc_frame_decoder_t dec;
+  ahdlc_decoded_frame_t frame;
+
+  buildFrameStream(&stream, &payloads, 150);
+  ASSERT_LE(stream.size(), 65536u);
+
+  dec.buffer_len = 1024;
+  dec.pdu_buffer = (uint8_t*)malloc(dec.buffer_len);
+
+  /* One big read, then the same stream cut into odd sized reads */
+  const uint32_t read_sizes[] = {(uint32_t)stream.size(), 1000, 97, 1};
+  for (uint32_t r = 0; r < sizeof(read_sizes) / sizeof(read_sizes[0]); ++r) {
+    uint32_t frames = 0;
+    AhdlcDecoderInit(&dec, CRC16, NULL);
+
+    for (uint32_t start = 0; start < stream.size(); start += read_sizes[r]) {
+      uint32_t len = std::min<uint32_t>(read_sizes[r], stream.size() - start);
+      uint32_t offset = 0;
+
+      while (DecoderBufferNext(&dec, &stream[start], len, &offset, &frame)
+             == AHDLC_COMPLETE) {
+        ASSERT_LT(frames, payloads.size());
+        ASSERT_EQ(payloads[frames].size(), frame.payload_len);
+        EXPECT_EQ(0, memcmp(payloads[frames].data(), frame.payload,
+            frame.payload_len));
+        EXPECT_EQ((uint8_t)frames, frame.sequence);
+        EXPECT_EQ(offset, frame.end_offset);
+        EXPECT_EQ(frame_marker, stream[start + offset - 1]);
+        ++frames;
+      }
+      EXPECT_EQ(len, offset);
+    }
+    EXPECT_EQ(payloads.size(), frames);
+  }
+  free(dec.pdu_buffer);
+}
+
+TEST_F(FrameTest, DecodeInPlaceTest) {
+  vector<uint8_t> stream;
+  vector<vector<uint8_t> > payloads;
+  ahdlc_frame_decoder_t dec;
+  ahdlc_decoded_frame_t frames[4];
+  uint8_t window[4096];
+
+  buildFrameStream(&stream, &payloads, 150);
+  dec.buffer_len = 0;
+  dec.pdu_buffer = NULL;
+
+  /* Reads land behind whatever the previous call left unconsumed */
+  const uint32_t read_sizes[] = {sizeof(window), 1000, 97, 1};
+  for (uint32_t mode = DECODE_CRC_PER_BYTE; mode <= DECODE_CRC_PER_FRAME;
+       ++mode) {
+    for (uint32_t r = 0; r < sizeof(read_sizes) / sizeof(read_sizes[0]);
+         ++r) {
+      uint32_t decoded = 0;
+      uint32_t kept = 0;
+      uint32_t start = 0;
+
+      AhdlcDecoderInit(&dec, CRC16, NULL);
+      AhdlcDecoderSetCrcMode(&dec, (ahdlc_decoder_crc_mode)mode);
+
+      while (start < stream.size() || kept) {
+        uint32_t len = std::min<uint32_t>(read_sizes[r],
+            std::min<uint32_t>(stream.size() - start, sizeof(window) - kept));
+        uint32_t num_frames;
+        uint32_t consumed;
+
+        memcpy(&window[kept], &stream[start], len);
+        start += len;
+        len += kept;
+
+        DecodeInPlace(&dec, window, len, frames, 4, &num_frames, &consumed);
+        for (uint32_t i = 0; i < num_frames; ++i) {
+          ASSERT_LT(decoded, payloads.size());
+          ASSERT_EQ(payloads[decoded].size(), frames[i].payload_len);
+          EXPECT_GE(frames[i].payload, window);
+          EXPECT_LT(frames[i].payload, window + len);
+          EXPECT_EQ(0, memcmp(payloads[decoded].data(), frames[i].payload,
+              frames[i].payload_len));
+          EXPECT_EQ((uint8_t)decoded, frames[i].sequence);
+          EXPECT_LE(frames[i].end_offset, consumed + 1);
+          ++decoded;
+        }
+
+        kept = len - consumed;
+        memmove(window, &window[consumed], kept);
+        /* Only the closing marker of the last frame is left at the end */
+        if (start == stream.size() && num_frames == 0) {
+          break;
+        }
+      }
+      EXPECT_EQ(1u, kept);
+      EXPECT_EQ(payloads.size(), decoded);
+      EXPECT_EQ(payloads.size(), dec.stats.good_frame_cnt);
+    }
+  }
+
+  /* A frame left open by the byte path is refused, not silently dropped */
+  uint8_t pdu[400];
+  uint32_t num_frames;
+  uint32_t consumed;
+  dec.pdu_buffer = pdu;
+  dec.buffer_len = sizeof(pdu);
+  const uint8_t open_frame[] = {frame_marker, 0x40, 0x00, 0x11, 0x22};
+  AhdlcDecoderInit(&dec, CRC16, NULL);
+  for (uint32_t i = 0; i < sizeof(open_frame); ++i) {
+    DecodeFrameByte(&dec, open_frame[i]);
+  }
+  memcpy(window, stream.data(), 100);
+  EXPECT_EQ(AHDLC_ERROR, DecodeInPlace(&dec, window, 100, frames, 4,
+                                       &num_frames, &consumed));
+  EXPECT_EQ(0u, num_frames);
+  EXPECT_EQ(0u, consumed);
+  EXPECT_EQ(0u, dec.stats.out_of_frame_byte_cnt);
+
+  /* While hunting, the bytes up to the marker are resync, as byte by byte */
+  const uint8_t bad_escape[] = {frame_marker, 0x40, 0x00, escape_marker, 0x11};
+  AhdlcDecoderInit(&dec, CRC16, NULL);
+  for (uint32_t i = 0; i < sizeof(bad_escape); ++i) {
+    DecodeFrameByte(&dec, bad_escape[i]);
+  }
+  const uint8_t rest[] = {0x12, 0x13, 0x14};
+  memcpy(window, rest, sizeof(rest));
+  memcpy(&window[sizeof(rest)], stream.data(), sizeof(window) - sizeof(rest));
+  /* Two frames, the noise before the fourth is not reached */
+  EXPECT_EQ(AHDLC_COMPLETE, DecodeInPlace(&dec, window, sizeof(window),
+                                          frames, 2, &num_frames, &consumed));
+  EXPECT_EQ(2u, num_frames);
+  EXPECT_EQ(sizeof(rest), dec.stats.resync_discard_byte_cnt);
+  EXPECT_EQ(0u, dec.stats.out_of_frame_byte_cnt);
+}
+
+TEST_F(FrameTest, EncodeSegmentsTest) {
+  uint8_t header[12];
+  uint8_t payload[600];
+  uint8_t flat[sizeof(header) + sizeof(payload)];
+  uint8_t expected[2 * sizeof(flat) + 8];
+  uint8_t scratch[2 * sizeof(flat) + 8];
+  ahdlc_frame_encoder_t enc;
+  ahdlc_segment_t iov[2 * sizeof(flat) + 4];
+
+  enc.buffer_len = sizeof(expected);
+  for (uint32_t density = 0; density <= 100; density += 5) {
+    fillWithEscapes(header, sizeof(header), density);
+    fillWithEscapes(payload, sizeof(payload), density);
+    memcpy(flat, header, sizeof(header));
+    memcpy(&flat[sizeof(header)], payload, sizeof(payload));
+    const ahdlc_segment_t segments[] = {
+      {header, sizeof(header)}, {payload, 0}, {payload, sizeof(payload)}};
+
+    /* Reference: everything copied into one buffer first */
+    enc.frame_buffer = expected;
+    ahdlcEncoderInit(&enc, CRC16);
+    EncodeNewFrame(&enc);
+    ASSERT_EQ(AHDLC_OK, EncodeBuffer(&enc, flat, sizeof(flat)));
+    uint32_t expected_len = enc.frame_info.buffer_index;
+
+    enc.frame_buffer = scratch;
+    ahdlcEncoderInit(&enc, CRC16);
+    EncodeNewFrame(&enc);
+    ASSERT_EQ(AHDLC_OK, EncodeSegments(&enc, segments, 3));
+    ASSERT_EQ(expected_len, enc.frame_info.buffer_index);
+    EXPECT_EQ(0, memcmp(expected, scratch, expected_len));
+
+    uint32_t num_iov;
+    ahdlcEncoderInit(&enc, CRC16);
+    EncodeNewFrame(&enc);
+    ASSERT_EQ(AHDLC_OK, EncodeSegmentsIovec(&enc, segments, 3, iov,
+        sizeof(iov) / sizeof(iov[0]), &num_iov));
+    vector<uint8_t> gathered;
+    for (uint32_t i = 0; i < num_iov; ++i) {
+      ASSERT_NE(0u, iov[i].len);
+      gathered.insert(gathered.end(), iov[i].base, iov[i].base + iov[i].len);
+    }
+    ASSERT_EQ(expected_len, gathered.size());
+    EXPECT_EQ(0, memcmp(expected, gathered.data(), expected_len));
+    /* Only the bytes that are not plain payload went to frame_buffer */
+    uint32_t plain = 0;
+    for (uint32_t i = 0; i < sizeof(flat); ++i) {
+      plain += (flat[i] != frame_marker && flat[i] != escape_marker);
+    }
+    EXPECT_EQ(expected_len - plain, enc.frame_info.buffer_index);
+  }
+
+  /* Too few entries is reported rather than truncated */
+  uint32_t num_iov;
+  const ahdlc_segment_t segment = {payload, sizeof(payload)};
+  fillWithEscapes(payload, sizeof(payload), 50);
+  ahdlcEncoderInit(&enc, CRC16);
+  EncodeNewFrame(&enc);
+  EXPECT_EQ(AHDLC_BUFFER_TOO_SMALL,
+            EncodeSegmentsIovec(&enc, &segment, 1, iov, 4, &num_iov));
+}
+
+static ahdlc_op_return appendToVector(void *ctx, const uint8_t *data,
+                                      uint32_t len) {
+  vector<uint8_t> *sent = (vector<uint8_t>*)ctx;
+  sent->insert(sent->end(), data, data + len);
+  return AHDLC_OK;
+}
+
+static ahdlc_op_return failingSink(void *, const uint8_t *, uint32_t) {
+  return AHDLC_ERROR;
+}
+
+TEST_F(FrameTest, EncoderSinkModesTest) {
+  uint8_t payload[1000];
+  uint8_t reference[2 * sizeof(payload) + 8];
+  uint8_t staging[16];
+  ahdlc_frame_encoder_t ref;
+  ahdlc_frame_encoder_t enc;
+  vector<uint8_t> sent;
+
+  ref.frame_buffer = reference;
+  ref.buffer_len = sizeof(reference);
+  ahdlcEncoderInit(&ref, CRC16);
+
+  enc.frame_buffer = staging;
+  enc.buffer_len = sizeof(staging);
+  ahdlcEncoderInit(&enc, CRC16);
+  ASSERT_EQ(AHDLC_OK, AhdlcEncoderSetSink(&enc, ENCODE_SEND_BYTE_TO_CALLBACK,
+                                          appendToVector, &sent));
+
+  for (uint32_t density = 0; density <= 100; density += 10) {
+    uint32_t len = 13 * density % sizeof(payload);
+    fillWithEscapes(payload, len, density);
+
+    EncodeNewFrame(&ref);
+    EncodeBuffer(&ref, payload, len);
+
+    /* Bulk path: bytes leave as soon as the staging buffer fills */
+    sent.clear();
+    EncodeNewFrame(&enc);
+    ASSERT_EQ(AHDLC_OK, EncodeBuffer(&enc, payload, len));
+    ASSERT_EQ(ref.frame_info.buffer_index, sent.size());
+    EXPECT_EQ(0, memcmp(reference, sent.data(), sent.size()));
+    EXPECT_EQ(0, enc.frame_info.buffer_index);
+
+    /* Byte path */
+    EncodeNewFrame(&ref);
+    EncodeBuffer(&ref, payload, len);
+    sent.clear();
+    EncodeNewFrame(&enc);
+    for (uint32_t i = 0; i < len; ++i) {
+      ASSERT_EQ(AHDLC_OK, EncodeAddByteToFrameBuffer(&enc, payload[i]));
+    }
+    if (len > 2 * sizeof(staging)) {
+      EXPECT_FALSE(sent.empty());
+    }
+    ASSERT_EQ(AHDLC_OK, EncodeFinalize(&enc));
+    ASSERT_EQ(ref.frame_info.buffer_index, sent.size());
+    EXPECT_EQ(0, memcmp(reference, sent.data(), sent.size()));
+  }
+
+  /* Whole frame at once */
+  uint8_t frame[sizeof(reference)];
+  enc.frame_buffer = frame;
+  enc.buffer_len = sizeof(frame);
+  ahdlcEncoderInit(&enc, CRC16);
+  ASSERT_EQ(AHDLC_OK, AhdlcEncoderSetSink(&enc, ENCODE_SEND_FRAME_TO_CALLBACK,
+                                          appendToVector, &sent));
+  ahdlcEncoderInit(&ref, CRC16);
+  fillWithEscapes(payload, sizeof(payload), 30);
+  EncodeNewFrame(&ref);
+  EncodeBuffer(&ref, payload, sizeof(payload));
+  sent.clear();
+  EncodeNewFrame(&enc);
+  ASSERT_EQ(AHDLC_OK, EncodeBuffer(&enc, payload, sizeof(payload)));
+  ASSERT_EQ(ref.frame_info.buffer_index, sent.size());
+  EXPECT_EQ(0, memcmp(reference, sent.data(), sent.size()));
+
+  /* Scatter-gather output needs the whole frame in frame_buffer */
+  uint32_t num_iov;
+  ahdlc_segment_t iov[4];
+  EncodeNewFrame(&enc);
+  EXPECT_EQ(AHDLC_ERROR, EncodeSegmentsIovec(&enc, iov, 0, iov, 4, &num_iov));
+
+  /* Sink errors stick */
+  ASSERT_EQ(AHDLC_OK, AhdlcEncoderSetSink(&enc, ENCODE_SEND_BYTE_TO_CALLBACK,
+                                          failingSink, NULL));
+  EncodeNewFrame(&enc);
+  EXPECT_EQ(AHDLC_ERROR, EncodeBuffer(&enc, payload, sizeof(payload)));
+  EXPECT_EQ(ENCODE_SINK_ERROR, enc.stats.encoder_state);
+
+  EXPECT_EQ(AHDLC_ERROR, AhdlcEncoderSetSink(&enc,
+      ENCODE_SEND_FRAME_TO_CALLBACK, NULL, NULL));
+  enc.buffer_len = 1;
+  EXPECT_EQ(AHDLC_BUFFER_TOO_SMALL, AhdlcEncoderSetSink(&enc,
+      ENCODE_SEND_BYTE_TO_CALLBACK, appendToVector, &sent));
+}
+
+static void collectChannelFrame(void *ctx, uint32_t channel,
+                                const ahdlc_decoded_frame_t *frame) {
+  vector<vector<vector<uint8_t> > > *frames =
+      (vector<vector<vector<uint8_t> > >*)ctx;
+  (*frames)[channel].push_back(
+      vector<uint8_t>(frame->payload, frame->payload + frame->payload_len));
+}
+
+TEST_F(FrameTest, MultiDecoderTest) {
+  const uint32_t channels = 64;
+  vector<vector<uint8_t> > streams(channels);
+  vector<vector<vector<uint8_t> > > payloads(channels);
+  vector<vector<vector<uint8_t> > > frames(channels);
+  vector<uint32_t> sent(channels, 0);
+  vector<uint32_t> storage(
+      AHDLC_MULTI_DECODER_STORAGE_SIZE(channels, 300) / sizeof(uint32_t));
+  ahdlc_multi_decoder_t multi;
+
+  for (uint32_t c = 0; c < channels; ++c) {
+    buildFrameStream(&streams[c], &payloads[c], 20);
+  }
+
+  EXPECT_EQ(AHDLC_BUFFER_TOO_SMALL, AhdlcMultiDecoderInit(&multi, channels,
+      300, storage.data(), storage.size() * 4 - 1, CRC16, collectChannelFrame,
+      &frames));
+  ASSERT_EQ(AHDLC_OK, AhdlcMultiDecoderInit(&multi, channels, 300,
+      storage.data(), storage.size() * 4, CRC16, collectChannelFrame,
+      &frames));
+
+  /* Batches of odd sized pieces from random channels */
+  bool done = false;
+  while (!done) {
+    ahdlc_channel_input_t batch[16];
+    for (uint32_t i = 0; i < 16; ++i) {
+      uint32_t c = random() % channels;
+      uint32_t len = std::min<uint32_t>(random() % 200,
+                                        streams[c].size() - sent[c]);
+      batch[i].channel = c;
+      batch[i].data = streams[c].data() + sent[c];
+      batch[i].len = len;
+      sent[c] += len;
+    }
+    EXPECT_NE(AHDLC_ERROR, AhdlcMultiDecode(&multi, batch, 16));
+
+    done = true;
+    for (uint32_t c = 0; c < channels; ++c) {
+      done = done && sent[c] == streams[c].size();
+    }
+  }
+
+  for (uint32_t c = 0; c < channels; ++c) {
+    ASSERT_EQ(payloads[c].size(), frames[c].size());
+    for (uint32_t f = 0; f < frames[c].size(); ++f) {
+      EXPECT_TRUE(payloads[c][f] == frames[c][f]);
+    }
+    EXPECT_EQ(payloads[c].size(), multi.stats[c].good_frame_cnt);
+    EXPECT_EQ(0u, multi.stats[c].num_decoded_bad_crc);
+  }
+
+  /* Frames larger than max_pdu are dropped, the next one still decodes */
+  uint8_t payload[64];
+  uint8_t encoded[2 * sizeof(payload) + 8];
+  ahdlc_frame_encoder_t enc;
+  enc.frame_buffer = encoded;
+  enc.buffer_len = sizeof(encoded);
+  ahdlcEncoderInit(&enc, CRC16);
+  fillWithEscapes(payload, sizeof(payload), 20);
+
+  vector<uint8_t> stream;
+  EncodeNewFrame(&enc);
+  EncodeBuffer(&enc, payload, sizeof(payload));
+  stream.insert(stream.end(), encoded, encoded + enc.frame_info.buffer_index);
+  EncodeNewFrame(&enc);
+  EncodeBuffer(&enc, payload, 10);
+  stream.insert(stream.end(), encoded, encoded + enc.frame_info.buffer_index);
+
+  for (uint32_t c = 0; c < channels; ++c) {
+    frames[c].clear();
+  }
+  ASSERT_EQ(AHDLC_OK, AhdlcMultiDecoderInit(&multi, 2, 32, storage.data(),
+      storage.size() * 4, CRC16, collectChannelFrame, &frames));
+  ahdlc_channel_input_t inputs[] = {
+    {1, stream.data(), (uint32_t)stream.size()},
+    {2, stream.data(), (uint32_t)stream.size()}};
+  EXPECT_EQ(AHDLC_ERROR, AhdlcMultiDecode(&multi, inputs, 2));
+  ASSERT_EQ(1u, frames[1].size());
+  EXPECT_EQ(0, memcmp(payload, frames[1][0].data(), 10));
+  EXPECT_EQ(1u, multi.stats[1].num_decoded_bad_crc);
+  EXPECT_TRUE(frames[0].empty());
+}
+
+TEST_F(FrameTest, ParallelDecodeMatchesSerial) {
+  vector<uint8_t> stream;
+  vector<vector<uint8_t> > payloads;
+  ahdlc_frame_decoder_t serial;
+  ahdlc_decoded_frame_t frame;
+  vector<vector<uint8_t> > serial_payloads;
+  vector<uint32_t> serial_ends;
+
+  buildFrameStream(&stream, &payloads, 2000);
+  /* Damage some frames: CRC errors, bad escapes, lost markers */
+  for (uint32_t i = 0; i < 200; ++i) {
+    stream[random() % stream.size()] = (uint8_t)random();
+  }
+
+  serial.buffer_len = 200;  /* Some payloads overflow */
+  serial.pdu_buffer = (uint8_t*)malloc(serial.buffer_len);
+  AhdlcDecoderInit(&serial, CRC16, NULL);
+  uint32_t offset = 0;
+  while (DecoderBufferNext(&serial, stream.data(), stream.size(), &offset,
+                           &frame) == AHDLC_COMPLETE) {
+    serial_payloads.push_back(
+        vector<uint8_t>(frame.payload, frame.payload + frame.payload_len));
+    serial_ends.push_back(frame.end_offset);
+  }
+  ASSERT_GT(serial_payloads.size(), 1000u);
+
+  const uint32_t threads[] = {1, 2, 4, 7};
+  const size_t chunks[] = {0, 1, 100, 4096};
+  for (uint32_t t = 0; t < 4; ++t) {
+    for (uint32_t c = 0; c < 4; ++c) {
+      ahdlc_parallel_config_t config = {threads[t], chunks[c], 200, CRC16};
+      ahdlc_parallel_result_t result;
+
+      ASSERT_EQ(AHDLC_OK, AhdlcParallelDecode(stream.data(), stream.size(),
+                                              &config, &result));
+      ASSERT_EQ(serial_payloads.size(), result.num_frames);
+      for (uint32_t f = 0; f < result.num_frames; ++f) {
+        ASSERT_EQ(serial_ends[f], result.frames[f].end_offset);
+        ASSERT_EQ(serial_payloads[f].size(), result.frames[f].payload_len);
+        EXPECT_EQ(0, memcmp(serial_payloads[f].data(),
+            result.frames[f].payload, result.frames[f].payload_len));
+      }
+      EXPECT_TRUE(sameDecoderStats(serial.stats, result.stats));
+      AhdlcParallelResultFree(&result);
+    }
+  }
+  free(serial.pdu_buffer);
+}
+
+struct ringProducer {
+  ahdlc_byte_ring_t *ring;
+  const vector<uint8_t> *stream;
+};
+
+/* Odd sized writes, retrying whatever the ring dropped */
+static void *ringProducerThread(void *arg) {
+  ringProducer *producer = (ringProducer*)arg;
+  const vector<uint8_t> &stream = *producer->stream;
+  uint32_t sent = 0;
+
+  while (sent < stream.size()) {
+    uint32_t len = std::min<uint32_t>(1 + random() % 100,
+                                      stream.size() - sent);
+    sent += AhdlcRingWrite(producer->ring, &stream[sent], len);
+    sched_yield();
+  }
+  return NULL;
+}
+
+TEST_F(FrameTest, ByteRingTest) {
+  ahdlc_byte_ring_t ring;
+  uint8_t storage[256];
+  uint8_t data[100];
+  const uint8_t *span;
+
+  EXPECT_EQ(AHDLC_ERROR, AhdlcRingInit(&ring, storage, 100));
+  EXPECT_EQ(AHDLC_ERROR, AhdlcRingInit(&ring, storage, 0));
+  ASSERT_EQ(AHDLC_OK, AhdlcRingInit(&ring, storage, 64));
+  for (uint32_t i = 0; i < sizeof(data); ++i) {
+    data[i] = (uint8_t)i;
+  }
+
+  /* Overflow drops the tail of the write and is counted */
+  EXPECT_EQ(64u, AhdlcRingWrite(&ring, data, sizeof(data)));
+  EXPECT_EQ(36u, ring.overflow_cnt);
+  EXPECT_EQ(64u, ring.high_water);
+  EXPECT_EQ(AHDLC_BUFFER_TOO_SMALL, AhdlcRingPutByte(&ring, 0));
+  EXPECT_EQ(37u, ring.overflow_cnt);
+
+  ASSERT_EQ(64u, AhdlcRingPeek(&ring, &span));
+  EXPECT_EQ(0, memcmp(data, span, 64));
+  AhdlcRingConsume(&ring, 60);
+
+  /* A write across the end of the buffer comes back as two spans */
+  EXPECT_EQ(20u, AhdlcRingWrite(&ring, &data[40], 20));
+  EXPECT_EQ(24u, AhdlcRingFill(&ring));
+  ASSERT_EQ(4u, AhdlcRingPeek(&ring, &span));
+  EXPECT_EQ(0, memcmp(&data[60], span, 4));
+  AhdlcRingConsume(&ring, 4);
+  ASSERT_EQ(20u, AhdlcRingPeek(&ring, &span));
+  EXPECT_EQ(0, memcmp(&data[40], span, 20));
+  AhdlcRingConsume(&ring, 20);
+  EXPECT_EQ(0u, AhdlcRingPeek(&ring, &span));
+  EXPECT_EQ(64u, ring.high_water);
+  EXPECT_EQ(37u, ring.overflow_cnt);
+
+  /* A producer thread feeding the decoder through a small ring */
+  vector<uint8_t> stream;
+  vector<vector<uint8_t> > payloads;
+  vector<vector<uint8_t> > decoded;
+  ahdlc_frame_decoder_t dec;
+  ahdlc_decoded_frame_t frame;
+  ringProducer producer = {&ring, &stream};
+  pthread_t thread;
+
+  buildFrameStream(&stream, &payloads, 500);
+  dec.buffer_len = 1024;
+  dec.pdu_buffer = (uint8_t*)malloc(dec.buffer_len);
+  AhdlcDecoderInit(&dec, CRC16, NULL);
+  ASSERT_EQ(AHDLC_OK, AhdlcRingInit(&ring, storage, sizeof(storage)));
+  ASSERT_EQ(0, pthread_create(&thread, NULL, ringProducerThread, &producer));
+
+  while (decoded.size() < payloads.size()) {
+    if (AhdlcRingDecodeNext(&ring, &dec, &frame) == AHDLC_COMPLETE) {
+      decoded.push_back(
+          vector<uint8_t>(frame.payload, frame.payload + frame.payload_len));
+    } else {
+      sched_yield();
+    }
+  }
+  pthread_join(thread, NULL);
+
+  EXPECT_EQ(0u, AhdlcRingFill(&ring));
+  EXPECT_LE(ring.high_water, sizeof(storage));
+  EXPECT_GT(ring.high_water, 0u);
+  for (uint32_t f = 0; f < payloads.size(); ++f) {
+    EXPECT_TRUE(payloads[f] == decoded[f]);
+  }
+  EXPECT_EQ(0u, dec.stats.num_decoded_bad_crc);
+  free(dec.pdu_buffer);
+}
+
+struct poolWorker {
+  ahdlc_frame_pool_t *pool;
+  const vector<vector<uint8_t> > *payloads;
+  pthread_mutex_t lock;
+  std::deque<std::pair<uint8_t*, uint32_t> > queue;
+  uint32_t checked;
+  uint32_t mismatches;
+};
+
+/* Checks and frees taken slots until every payload has been seen */
+static void *poolWorkerThread(void *arg) {
+  poolWorker *worker = (poolWorker*)arg;
+
+  while (worker->checked < worker->payloads->size()) {
+    std::pair<uint8_t*, uint32_t> frame(NULL, 0);
+    pthread_mutex_lock(&worker->lock);
+    if (!worker->queue.empty()) {
+      frame = worker->queue.front();
+      worker->queue.pop_front();
+    }
+    pthread_mutex_unlock(&worker->lock);
+    if (!frame.first) {
+      sched_yield();
+      continue;
+    }
+
+    const vector<uint8_t> &expected = (*worker->payloads)[worker->checked++];
+    if (expected.size() != frame.second ||
+        memcmp(expected.data(), frame.first, frame.second)) {
+      ++worker->mismatches;
+    }
+    if (AhdlcFramePoolFree(worker->pool, frame.first) != AHDLC_OK) {
+      ++worker->mismatches;
+    }
+  }
+  return NULL;
+}
+
+TEST_F(FrameTest, FramePoolTest) {
+  ahdlc_frame_pool_t pool;
+  uint8_t storage[4 * 320 + 10];
+  uint8_t *slots[4];
+
+  EXPECT_EQ(AHDLC_BUFFER_TOO_SMALL, AhdlcFramePoolInit(&pool, storage, 100,
+                                                       320));
+  EXPECT_EQ(AHDLC_ERROR, AhdlcFramePoolInit(&pool, storage, UINT32_MAX,
+                                            UINT16_MAX + 1));
+  ASSERT_EQ(AHDLC_OK, AhdlcFramePoolInit(&pool, storage, sizeof(storage),
+                                         320));
+  EXPECT_EQ(4u, pool.num_slots);
+  for (uint32_t i = 0; i < 4; ++i) {
+    slots[i] = AhdlcFramePoolAlloc(&pool);
+    ASSERT_TRUE(slots[i] != NULL);
+  }
+  EXPECT_TRUE(AhdlcFramePoolAlloc(&pool) == NULL);
+  EXPECT_EQ(1u, pool.stats.exhausted_cnt);
+  EXPECT_EQ(0u, pool.stats.min_free);
+
+  EXPECT_EQ(AHDLC_ERROR, AhdlcFramePoolFree(&pool, slots[1] + 1));
+  EXPECT_EQ(AHDLC_ERROR, AhdlcFramePoolFree(&pool, storage + 4 * 320));
+  EXPECT_EQ(AHDLC_OK, AhdlcFramePoolFree(&pool, slots[2]));
+  EXPECT_EQ(AHDLC_ERROR, AhdlcFramePoolFree(&pool, slots[2]));
+  EXPECT_EQ(1u, AhdlcFramePoolAvailable(&pool));
+  EXPECT_EQ(slots[2], AhdlcFramePoolAlloc(&pool));
+  for (uint32_t i = 0; i < 4; ++i) {
+    EXPECT_EQ(AHDLC_OK, AhdlcFramePoolFree(&pool, slots[i]));
+  }
+
+  /* Frames handed to a worker thread without copying */
+  vector<uint8_t> stream;
+  vector<vector<uint8_t> > payloads;
+  ahdlc_frame_decoder_t dec;
+  ahdlc_decoded_frame_t frame;
+  poolWorker worker;
+  pthread_t thread;
+  uint32_t offset = 0;
+
+  buildFrameStream(&stream, &payloads, 500);
+  ASSERT_EQ(AHDLC_OK, AhdlcFramePoolInit(&pool, storage, sizeof(storage),
+                                         320));
+  ASSERT_EQ(AHDLC_OK, AhdlcDecoderInitPool(&dec, CRC16, &pool));
+  EXPECT_EQ(3u, AhdlcFramePoolAvailable(&pool));
+  uint32_t len;
+  EXPECT_TRUE(AhdlcDecoderTakeFrame(&dec, &len) == NULL);
+
+  worker.pool = &pool;
+  worker.payloads = &payloads;
+  pthread_mutex_init(&worker.lock, NULL);
+  worker.checked = 0;
+  worker.mismatches = 0;
+  ASSERT_EQ(0, pthread_create(&thread, NULL, poolWorkerThread, &worker));
+
+  while (DecoderBufferNext(&dec, stream.data(), stream.size(), &offset,
+                           &frame) == AHDLC_COMPLETE) {
+    uint8_t *taken;
+    /* On exhaustion the frame stays put until a slot comes back */
+    while ((taken = AhdlcDecoderTakeFrame(&dec, &len)) == NULL) {
+      sched_yield();
+    }
+    EXPECT_EQ(frame.payload, taken);
+    EXPECT_TRUE(AhdlcDecoderTakeFrame(&dec, &len) == NULL);
+    pthread_mutex_lock(&worker.lock);
+    worker.queue.push_back(std::make_pair(taken, len));
+    pthread_mutex_unlock(&worker.lock);
+  }
+
+  /* Frames decoded in place were never in the pool slot */
+  vector<uint8_t> in_place(stream);
+  ahdlc_decoded_frame_t decoded[4];
+  uint32_t num_decoded;
+  uint32_t consumed;
+  EXPECT_EQ(AHDLC_COMPLETE, DecodeInPlace(&dec, in_place.data(),
+      (uint32_t)in_place.size(), decoded, 4, &num_decoded, &consumed));
+  EXPECT_TRUE(AhdlcDecoderTakeFrame(&dec, &len) == NULL);
+  pthread_join(thread, NULL);
+  pthread_mutex_destroy(&worker.lock);
+
+  EXPECT_EQ(payloads.size(), worker.checked);
+  EXPECT_EQ(0u, worker.mismatches);
+  EXPECT_EQ(payloads.size() + 1, pool.stats.alloc_cnt);
+  EXPECT_EQ(3u, AhdlcFramePoolAvailable(&pool));
+  EXPECT_EQ(AHDLC_OK, AhdlcFramePoolFree(&pool, dec.pdu_buffer));
+}
+
+static void collectDecodedFrame(vector<ahdlc_decoded_frame_t> *frames,
+                                vector<vector<uint8_t> > *payloads,
+                                const ahdlc_decoded_frame_t &frame) {
+  frames->push_back(frame);
+  payloads->push_back(
+      vector<uint8_t>(frame.payload, frame.payload + frame.payload_len));
+}
+
+TEST_F(FrameTest, AckFrameTest) {
+  ahdlc_frame_encoder_t enc;
+  uint8_t encoded[64];
+  const uint8_t sack[] = {0x05, 0x7E, 0x00, 0x80};
+  vector<uint8_t> stream;
+
+  enc.frame_buffer = encoded;
+  enc.buffer_len = sizeof(encoded);
+  ahdlcEncoderInit(&enc, CRC16);
+  enc.frame_info.sequence = 9;
+
+  /* A bare ack, then one with a selective ack payload */
+  enc.frame_info.control_bits.bit.frame_is_ack = AHDLC_TRUE;
+  enc.frame_info.ack_num = 0x7E;
+  ASSERT_EQ(AHDLC_OK, EncodeNewFrame(&enc));
+  ASSERT_EQ(AHDLC_OK, EncodeFinalize(&enc));
+  stream.insert(stream.end(), encoded, encoded + enc.frame_info.buffer_index);
+  enc.frame_info.ack_num = 3;
+  ASSERT_EQ(AHDLC_OK, EncodeNewFrame(&enc));
+  ASSERT_EQ(AHDLC_OK, EncodeBuffer(&enc, sack, sizeof(sack)));
+  EXPECT_EQ(ack_frame_size_unencrypted + 1 + sizeof(sack) + 1,
+            enc.frame_info.buffer_index);
+  stream.insert(stream.end(), encoded, encoded + enc.frame_info.buffer_index);
+  EXPECT_EQ(9, enc.frame_info.sequence);
+
+  /* Data frames still number themselves */
+  enc.frame_info.control_bits.value = 0;
+  ASSERT_EQ(AHDLC_OK, EncodeNewFrame(&enc));
+  ASSERT_EQ(AHDLC_OK, EncodeBuffer(&enc, sack, 2));
+  stream.insert(stream.end(), encoded, encoded + enc.frame_info.buffer_index);
+  EXPECT_EQ(10, enc.frame_info.sequence);
+
+  /* Every decoder agrees, whatever the CRC mode */
+  for (uint32_t mode = 0; mode < 2; ++mode) {
+    ahdlc_frame_decoder_t dec;
+    ahdlc_decoded_frame_t frame;
+    vector<ahdlc_decoded_frame_t> frames;
+    vector<vector<uint8_t> > payloads;
+    uint32_t offset = 0;
+
+    dec.buffer_len = 64;
+    dec.pdu_buffer = (uint8_t*)malloc(dec.buffer_len);
+    AhdlcDecoderInit(&dec, CRC16, NULL);
+    AhdlcDecoderSetCrcMode(&dec, (ahdlc_decoder_crc_mode)mode);
+    while (DecoderBufferNext(&dec, stream.data(), stream.size(), &offset,
+                             &frame) == AHDLC_COMPLETE) {
+      collectDecodedFrame(&frames, &payloads, frame);
+    }
+    free(dec.pdu_buffer);
+
+    ASSERT_EQ(3u, frames.size());
+    EXPECT_TRUE(frames[0].control_bits.bit.frame_is_ack);
+    EXPECT_EQ(9, frames[0].sequence);
+    EXPECT_EQ(0x7E, frames[0].ack_num);
+    EXPECT_EQ(0u, frames[0].payload_len);
+    EXPECT_EQ(3, frames[1].ack_num);
+    EXPECT_TRUE(payloads[1] == vector<uint8_t>(sack, sack + sizeof(sack)));
+    EXPECT_FALSE(frames[2].control_bits.bit.frame_is_ack);
+    EXPECT_EQ(9, frames[2].sequence);
+    EXPECT_EQ(2u, frames[2].payload_len);
+    EXPECT_EQ(3u, dec.stats.good_frame_cnt);
+  }
+
+  ahdlc_multi_decoder_t multi;
+  vector<uint32_t> storage(AHDLC_MULTI_DECODER_STORAGE_SIZE(1, 64) / 4 + 1);
+  vector<vector<vector<uint8_t> > > frames(1);
+  ahdlc_channel_input_t input = {0, stream.data(), (uint32_t)stream.size()};
+  ASSERT_EQ(AHDLC_OK, AhdlcMultiDecoderInit(&multi, 1, 64, storage.data(),
+      storage.size() * 4, CRC16, collectChannelFrame, &frames));
+  EXPECT_EQ(AHDLC_COMPLETE, AhdlcMultiDecode(&multi, &input, 1));
+  ASSERT_EQ(3u, frames[0].size());
+  EXPECT_TRUE(frames[0][0].empty());
+  EXPECT_TRUE(frames[0][1] == vector<uint8_t>(sack, sack + sizeof(sack)));
+
+  /* A max_pdu payload still fits the slot behind the longer ack header */
+  vector<uint32_t> exact(AHDLC_MULTI_DECODER_STORAGE_SIZE(1, sizeof(sack)) /
+                         4);
+  frames[0].clear();
+  ASSERT_EQ(AHDLC_OK, AhdlcMultiDecoderInit(&multi, 1, sizeof(sack),
+      exact.data(), exact.size() * 4, CRC16, collectChannelFrame, &frames));
+  EXPECT_EQ(AHDLC_COMPLETE, AhdlcMultiDecode(&multi, &input, 1));
+  ASSERT_EQ(3u, frames[0].size());
+  EXPECT_TRUE(frames[0][1] == vector<uint8_t>(sack, sack + sizeof(sack)));
+  EXPECT_EQ(0u, multi.stats[0].num_decoded_bad_crc);
+}
+
+struct arqEndpoint;
+
+/* One direction of a simulated radio link */
+struct arqLink {
+  std::deque<std::pair<uint32_t, vector<uint8_t> > > frames;
+  uint32_t latency_ms;
+  uint32_t loss_percent;
+  uint32_t *now;
+};
+
+struct arqEndpoint {
+  ahdlc_arq_t arq;
+  vector<uint8_t> storage;
+  ahdlc_frame_decoder_t dec;
+  uint8_t pdu[256];
+  arqLink *out;
+  vector<vector<uint8_t> > delivered;
+};
+
+static ahdlc_op_return arqLinkSend(void *ctx, const uint8_t *data,
+                                   uint32_t len) {
+  arqLink *link = ((arqEndpoint*)ctx)->out;
+  vector<uint8_t> frame(data, data + len);
+
+  if ((uint32_t)(random() % 100) < link->loss_percent) {
+    return AHDLC_OK;
+  }
+  if (random() % 20 == 0) {
+    frame[random() % len] ^= 0x01;
+  }
+  link->frames.push_back(std::make_pair(*link->now + link->latency_ms,
+                                        frame));
+  return AHDLC_OK;
+}
+
+static uint32_t arqClock(void *ctx) {
+  return *((arqEndpoint*)ctx)->out->now;
+}
+
+static void arqDeliver(void *ctx, const uint8_t *payload, uint32_t len) {
+  ((arqEndpoint*)ctx)->delivered.push_back(
+      vector<uint8_t>(payload, payload + len));
+}
+
+static void arqEndpointInit(arqEndpoint *end, arqLink *out, uint32_t window,
+                            uint32_t max_retries) {
+  ahdlc_arq_config_t config = {window, 200, 250, max_retries, CRC16,
+                               arqLinkSend, arqDeliver, arqClock, end};
+
+  end->out = out;
+  end->storage.resize(AHDLC_ARQ_STORAGE_SIZE(window, 200));
+  end->dec.pdu_buffer = end->pdu;
+  end->dec.buffer_len = sizeof(end->pdu);
+  AhdlcDecoderInit(&end->dec, CRC16, NULL);
+  ASSERT_EQ(AHDLC_OK, AhdlcArqInit(&end->arq, &config, end->storage.data(),
+                                   end->storage.size()));
+}
+
+/* Hands over whatever has arrived on link by now */
+static void arqLinkPump(arqLink *link, arqEndpoint *to) {
+  vector<vector<uint8_t> > arrived;
+
+  while (!link->frames.empty() && link->frames.front().first <= *link->now) {
+    arrived.push_back(link->frames.front().second);
+    link->frames.pop_front();
+  }
+  for (uint32_t i = 0; i < arrived.size(); ++i) {
+    ahdlc_decoded_frame_t frame;
+    uint32_t offset = 0;
+    while (DecoderBufferNext(&to->dec, arrived[i].data(), arrived[i].size(),
+                             &offset, &frame) == AHDLC_COMPLETE) {
+      AhdlcArqReceive(&to->arq, &frame);
+    }
+  }
+}
+
+TEST_F(FrameTest, ArqMaxPayloadTest) {
+  arqEndpoint end;
+  arqLink link;
+  uint32_t now = 0;
+  ahdlc_arq_config_t config = {2, AHDLC_ARQ_MAX_PAYLOAD, 250, 0, CRC16,
+                               arqLinkSend, arqDeliver, arqClock, &end};
+
+  link.latency_ms = 0;
+  link.loss_percent = 0;
+  link.now = &now;
+  end.out = &link;
+  EXPECT_GE((uint32_t)UINT16_MAX,
+            AHDLC_ARQ_ENCODED_SIZE(AHDLC_ARQ_MAX_PAYLOAD));
+  end.storage.resize(AHDLC_ARQ_STORAGE_SIZE(2, AHDLC_ARQ_MAX_PAYLOAD + 1));
+  ASSERT_EQ(AHDLC_OK, AhdlcArqInit(&end.arq, &config, end.storage.data(),
+                                   end.storage.size()));
+
+  /* A worst case payload still encodes to one whole frame */
+  vector<uint8_t> payload(AHDLC_ARQ_MAX_PAYLOAD, frame_marker);
+  ASSERT_EQ(AHDLC_OK, AhdlcArqSend(&end.arq, payload.data(),
+                                   (uint32_t)payload.size()));
+  ASSERT_EQ(1u, link.frames.size());
+  EXPECT_LT(2 * payload.size(), link.frames.front().second.size());
+  EXPECT_EQ(frame_marker, link.frames.front().second.back());
+
+  /* One more could wrap buffer_index */
+  config.max_payload = AHDLC_ARQ_MAX_PAYLOAD + 1;
+  EXPECT_EQ(AHDLC_ERROR, AhdlcArqInit(&end.arq, &config, end.storage.data(),
+                                      end.storage.size()));
+}
+
+TEST_F(FrameTest, ArqLossyLinkTest) {
+  uint32_t now = 0;
+  arqLink a_to_b = {std::deque<std::pair<uint32_t, vector<uint8_t> > >(),
+                    60, 20, &now};
+  arqLink b_to_a = a_to_b;
+  arqEndpoint a, b;
+  vector<vector<uint8_t> > to_b, to_a;
+  uint32_t sent_b = 0, sent_a = 0;
+
+  arqEndpointInit(&a, &a_to_b, 16, 0);
+  arqEndpointInit(&b, &b_to_a, 8, 0);
+  for (uint32_t i = 0; i < 400; ++i) {
+    uint8_t payload[200];
+    uint32_t len = 1 + random() % sizeof(payload);
+    fillWithEscapes(payload, len, 1 + i % 30);
+    (i % 2 ? to_a : to_b).push_back(vector<uint8_t>(payload, payload + len));
+  }
+
+  /* Both ends send at once, 20% loss and some corruption each way */
+  for (uint32_t step = 0; step < 100000; ++step, now += 5) {
+    while (sent_b < to_b.size() &&
+           AhdlcArqSend(&a.arq, to_b[sent_b].data(), to_b[sent_b].size())
+           == AHDLC_OK) {
+      ++sent_b;
+    }
+    while (sent_a < to_a.size() &&
+           AhdlcArqSend(&b.arq, to_a[sent_a].data(), to_a[sent_a].size())
+           == AHDLC_OK) {
+      ++sent_a;
+    }
+    arqLinkPump(&a_to_b, &b);
+    arqLinkPump(&b_to_a, &a);
+    EXPECT_EQ(AHDLC_OK, AhdlcArqPoll(&a.arq));
+    EXPECT_EQ(AHDLC_OK, AhdlcArqPoll(&b.arq));
+    EXPECT_LE(AhdlcArqInFlight(&a.arq), 16u);
+    EXPECT_LE(AhdlcArqInFlight(&b.arq), 8u);
+
+    if (sent_b == to_b.size() && sent_a == to_a.size() &&
+        !AhdlcArqInFlight(&a.arq) && !AhdlcArqInFlight(&b.arq)) {
+      break;
+    }
+  }
+
+  EXPECT_TRUE(to_b == b.delivered);
+  EXPECT_TRUE(to_a == a.delivered);
+  EXPECT_GT(a.arq.stats.retransmit_cnt, 0u);
+  EXPECT_GT(b.arq.stats.acks_sent, 0u);
+  EXPECT_EQ(to_b.size(), b.arq.stats.frames_delivered);
+  EXPECT_GT(b.dec.stats.num_decoded_bad_crc, 0u);
+
+  /* A dead link fills the window, then gives up */
+  arqEndpoint c;
+  arqLink dead = {std::deque<std::pair<uint32_t, vector<uint8_t> > >(),
+                  60, 100, &now};
+  arqEndpointInit(&c, &dead, 4, 2);
+  for (uint32_t i = 0; i < 4; ++i) {
+    EXPECT_EQ(AHDLC_OK, AhdlcArqSend(&c.arq, to_b[i].data(),
+                                     to_b[i].size()));
+  }
+  EXPECT_EQ(AHDLC_BUFFER_TOO_SMALL, AhdlcArqSend(&c.arq, to_b[4].data(),
+                                                 to_b[4].size()));
+  EXPECT_EQ(AHDLC_ERROR, AhdlcArqSend(&c.arq, to_b[0].data(), 201));
+  for (uint32_t i = 0; i < 2; ++i) {
+    now += 250;
+    EXPECT_EQ(AHDLC_OK, AhdlcArqPoll(&c.arq));
+  }
+  EXPECT_EQ(8u, c.arq.stats.retransmit_cnt);
+  now += 250;
+  EXPECT_EQ(AHDLC_ERROR, AhdlcArqPoll(&c.arq));
+  EXPECT_EQ(4u, c.arq.stats.retry_exhausted_cnt);
+}
+
+/* Reassembles every message in stream with a decoder smaller than them */
+static void reassembleStream(const vector<uint8_t> &stream,
+                             ahdlc_reassembler_t *reasm,
+                             vector<vector<uint8_t> > *messages,
+                             vector<ahdlc_op_return> *codes) {
+  ahdlc_frame_decoder_t dec;
+  ahdlc_decoded_frame_t frame;
+  uint8_t pdu[80];
+  uint32_t offset = 0;
+
+  dec.pdu_buffer = pdu;
+  dec.buffer_len = sizeof(pdu);
+  AhdlcDecoderInit(&dec, CRC16, NULL);
+  while (DecoderBufferNext(&dec, stream.data(), stream.size(), &offset,
+                           &frame) == AHDLC_COMPLETE) {
+    uint32_t len;
+    ahdlc_op_return code = AhdlcReassemble(reasm, &frame, &len);
+    if (code == AHDLC_COMPLETE) {
+      messages->push_back(vector<uint8_t>(reasm->buffer,
+                                          reasm->buffer + len));
+    } else if (code != AHDLC_OK) {
+      codes->push_back(code);
+    }
+  }
+}
+
+TEST_F(FrameTest, FragmentationTest) {
+  const uint32_t mtu = 64;
+  const uint32_t sizes[] = {5000, 0, 1, 64, 128, 129, 777};
+  const uint32_t num_messages = sizeof(sizes) / sizeof(sizes[0]);
+  vector<vector<uint8_t> > messages;
+  vector<vector<uint8_t> > frames;
+  vector<uint8_t> stream;
+  ahdlc_frame_encoder_t enc;
+  uint8_t encoded[2 * mtu + 8];
+
+  enc.frame_buffer = encoded;
+  enc.buffer_len = sizeof(encoded);
+  ahdlcEncoderInit(&enc, CRC16);
+  for (uint32_t m = 0; m < num_messages; ++m) {
+    vector<uint8_t> message(sizes[m]);
+    ahdlc_fragmenter_t frag;
+    ahdlc_op_return code;
+
+    fillWithEscapes(message.data(), message.size(), 10);
+    messages.push_back(message);
+    ASSERT_EQ(AHDLC_OK, AhdlcFragmenterInit(&frag, message.data(),
+                                            message.size(), mtu));
+    /* One fragment at a time through a frame_buffer sized for the mtu */
+    do {
+      code = AhdlcFragmentNext(&frag, &enc);
+      frames.push_back(vector<uint8_t>(encoded,
+                                       encoded + enc.frame_info.buffer_index));
+      stream.insert(stream.end(), frames.back().begin(), frames.back().end());
+    } while (code == AHDLC_OK);
+    ASSERT_EQ(AHDLC_COMPLETE, code);
+  }
+  EXPECT_FALSE(enc.frame_info.control_bits.bit.frame_is_continued);
+  EXPECT_EQ(79u + 1 + 1 + 1 + 2 + 3 + 13, frames.size());
+
+  vector<uint8_t> buffer(5000);
+  ahdlc_reassembler_t reasm;
+  vector<vector<uint8_t> > received;
+  vector<ahdlc_op_return> codes;
+  ASSERT_EQ(AHDLC_OK, AhdlcReassemblerInit(&reasm, buffer.data(),
+                                           buffer.size()));
+  reassembleStream(stream, &reasm, &received, &codes);
+  EXPECT_TRUE(messages == received);
+  EXPECT_TRUE(codes.empty());
+  EXPECT_EQ(frames.size(), reasm.stats.fragment_cnt);
+
+  /* The same through a sink, which buffer mode cannot do */
+  vector<uint8_t> sent;
+  EXPECT_EQ(AHDLC_ERROR, AhdlcEncodeMessage(&enc, messages[0].data(),
+                                            messages[0].size(), mtu));
+  ASSERT_EQ(AHDLC_OK, AhdlcEncoderSetSink(&enc, ENCODE_SEND_FRAME_TO_CALLBACK,
+                                          appendToVector, &sent));
+  for (uint32_t m = 0; m < num_messages; ++m) {
+    ASSERT_EQ(AHDLC_OK, AhdlcEncodeMessage(&enc, messages[m].data(),
+                                           messages[m].size(), mtu));
+  }
+  EXPECT_EQ(AHDLC_ERROR, AhdlcEncodeMessage(&enc, messages[0].data(), 1, 0));
+  received.clear();
+  reassembleStream(sent, &reasm, &received, &codes);
+  EXPECT_TRUE(messages == received);
+
+  /* A lost fragment drops its message only, as does one too large */
+  stream.clear();
+  for (uint32_t f = 0; f < frames.size(); ++f) {
+    if (f != 82) {  /* The first of the 128 byte message */
+      stream.insert(stream.end(), frames[f].begin(), frames[f].end());
+    }
+  }
+  AhdlcReassemblerInit(&reasm, buffer.data(), 1000);
+  received.clear();
+  codes.clear();
+  reassembleStream(stream, &reasm, &received, &codes);
+  ASSERT_EQ(2u, codes.size());
+  EXPECT_EQ(AHDLC_BUFFER_TOO_SMALL, codes[0]);
+  EXPECT_EQ(AHDLC_ERROR, codes[1]);
+  ASSERT_EQ(num_messages - 2, received.size());
+  for (uint32_t m = 1; m < num_messages; ++m) {
+    if (m != 4) {
+      EXPECT_TRUE(messages[m] == received[m < 4 ? m - 1 : m - 2]);
+    }
+  }
+  EXPECT_EQ(1u, reasm.stats.sequence_gap_cnt);
+  EXPECT_EQ(1u, reasm.stats.overflow_cnt);
+}
+
+/* Counter mode stand-in: key stream bytes from the counter and offset */
+static uint32_t stub_cipher_calls = 0;
+
+static ahdlc_op_return stubCipher(uint32_t ctr, uint32_t offset,
+                                  uint8_t *buffer, uint32_t length) {
+  ++stub_cipher_calls;
+  for (uint32_t i = 0; i < length; ++i) {
+    uint32_t x = ctr * 2654435761u + (offset + i) * 40503u;
+    x ^= x >> 13;
+    buffer[i] ^= (uint8_t)(x * 0x9E3779B1u >> 24) | 0x01;
+  }
+  return AHDLC_OK;
+}
+
+TEST_F(FrameTest, EncryptedFrameTest) {
+  const uint32_t sizes[] = {0, 1, 255, 256, 257, 1000};
+  const uint32_t num_frames = sizeof(sizes) / sizeof(sizes[0]);
+  vector<vector<uint8_t> > payloads;
+  vector<uint8_t> stream;
+  vector<uint8_t> sent;
+  ahdlc_frame_encoder_t enc;
+  ahdlc_frame_encoder_t staged;
+  uint8_t encoded[2 * 1000 + 16];
+  uint8_t staging[16];
+
+  enc.frame_buffer = encoded;
+  enc.buffer_len = sizeof(encoded);
+  ahdlcEncoderInit(&enc, CRC16);
+  enc.frame_info.control_bits.bit.frame_is_encrypted = AHDLC_TRUE;
+  EXPECT_EQ(AHDLC_ERROR, EncodeNewFrame(&enc));
+  AhdlcEncoderSetCipher(&enc, stubCipher, 0x7E7D0000);
+  staged.frame_buffer = staging;
+  staged.buffer_len = sizeof(staging);
+  ahdlcEncoderInit(&staged, CRC16);
+  AhdlcEncoderSetCipher(&staged, stubCipher, 0x7E7D0000);
+  staged.frame_info.control_bits.bit.frame_is_encrypted = AHDLC_TRUE;
+  AhdlcEncoderSetSink(&staged, ENCODE_SEND_BYTE_TO_CALLBACK, appendToVector,
+                      &sent);
+
+  for (uint32_t f = 0; f < num_frames; ++f) {
+    vector<uint8_t> payload(sizes[f]);
+    fillWithEscapes(payload.data(), payload.size(), 20);
+    payloads.push_back(payload);
+
+    /* One cipher call per block of up to 256 bytes, none per byte */
+    stub_cipher_calls = 0;
+    ASSERT_EQ(AHDLC_OK, EncodeNewFrame(&enc));
+    EXPECT_EQ(AHDLC_ERROR, EncodeAddByteToFrameBuffer(&enc, 0));
+    ASSERT_EQ(AHDLC_OK, EncodeBuffer(&enc, payload.data(), payload.size()));
+    EXPECT_EQ((sizes[f] + 255) / 256, stub_cipher_calls);
+    EXPECT_EQ(0x7E7D0000 + f, enc.frame_info.enc_ctr);
+    stream.insert(stream.end(), encoded, encoded + enc.frame_info.buffer_index);
+
+    ASSERT_EQ(AHDLC_OK, EncodeNewFrame(&staged));
+    ASSERT_EQ(AHDLC_OK, EncodeBuffer(&staged, payload.data(),
+                                     payload.size()));
+  }
+  EXPECT_TRUE(stream == sent);
+  EXPECT_EQ(1u + 1 + 1 + 2 + 4, enc.stats.encryption_engine_callback_count);
+
+  /* The payload is not on the wire in the clear */
+  EXPECT_TRUE(std::search(stream.begin(), stream.end(), payloads[5].begin(),
+                          payloads[5].begin() + 16) == stream.end());
+
+  /* Decrypted in one call per frame, after the CRC, in every CRC mode */
+  for (uint32_t mode = 0; mode < 2; ++mode) {
+    ahdlc_frame_decoder_t dec;
+    ahdlc_decoded_frame_t frame;
+    uint8_t pdu[1100];
+    uint32_t offset = 0;
+    uint32_t f = 0;
+
+    dec.pdu_buffer = pdu;
+    dec.buffer_len = sizeof(pdu);
+    AhdlcDecoderInit(&dec, CRC16, NULL);
+    AhdlcDecoderSetCrcMode(&dec, (ahdlc_decoder_crc_mode)mode);
+    AhdlcDecoderSetCipher(&dec, stubCipher);
+    stub_cipher_calls = 0;
+    while (DecoderBufferNext(&dec, stream.data(), stream.size(), &offset,
+                             &frame) == AHDLC_COMPLETE) {
+      ASSERT_LT(f, num_frames);
+      EXPECT_TRUE(payloads[f++] ==
+          vector<uint8_t>(frame.payload, frame.payload + frame.payload_len));
+    }
+    EXPECT_EQ(num_frames, f);
+    EXPECT_EQ(num_frames, stub_cipher_calls);
+    EXPECT_EQ(num_frames, dec.stats.encryption_engine_callback_cnt);
+  }
+
+  /* In place, and without a cipher */
+  ahdlc_frame_decoder_t dec;
+  ahdlc_decoded_frame_t frames[num_frames];
+  uint32_t decoded;
+  uint32_t consumed;
+  vector<uint8_t> copy(stream);
+  copy.push_back(frame_marker);
+  dec.pdu_buffer = NULL;
+  dec.buffer_len = 0;
+  AhdlcDecoderInit(&dec, CRC16, NULL);
+  AhdlcDecoderSetCipher(&dec, stubCipher);
+  DecodeInPlace(&dec, copy.data(), copy.size(), frames, num_frames, &decoded,
+                &consumed);
+  ASSERT_EQ(num_frames, decoded);
+  for (uint32_t f = 0; f < num_frames; ++f) {
+    EXPECT_TRUE(payloads[f] == vector<uint8_t>(frames[f].payload,
+        frames[f].payload + frames[f].payload_len));
+  }
+
+  uint8_t pdu[1100];
+  dec.pdu_buffer = pdu;
+  dec.buffer_len = sizeof(pdu);
+  AhdlcDecoderInit(&dec, CRC16, NULL);
+  for (uint32_t i = 0; i < stream.size(); ++i) {
+    EXPECT_NE(AHDLC_COMPLETE, DecodeFrameByte(&dec, stream[i]));
+  }
+  EXPECT_EQ(0u, dec.stats.good_frame_cnt);
+
+  /* A damaged frame never reaches the cipher */
+  stream[stream.size() / 2] ^= 0x01;
+  AhdlcDecoderInit(&dec, CRC16, NULL);
+  AhdlcDecoderSetCipher(&dec, stubCipher);
+  stub_cipher_calls = 0;
+  for (uint32_t i = 0; i < stream.size(); ++i) {
+    DecodeFrameByte(&dec, stream[i]);
+  }
+  EXPECT_EQ(num_frames - 1, dec.stats.good_frame_cnt);
+  EXPECT_EQ(num_frames - 1, stub_cipher_calls);
+
+  /* Acks are never encrypted */
+  enc.frame_info.control_bits.bit.frame_is_ack = AHDLC_TRUE;
+  EXPECT_EQ(AHDLC_ERROR, EncodeNewFrame(&enc));
+}
+
+/* Set by the test before each byte, so latency is a function of position */
+static uint64_t test_clock_now = 0;
+
+#ifdef AHDLC_INSTRUMENTATION
+static uint64_t testClock(void *) {
+  return test_clock_now;
+}
+
+static uint64_t testCycles(void *) {
+  return 2 * test_clock_now;
+}
+
+struct snapshotReader {
+  ahdlc_frame_decoder_t *dec;
+  uint32_t good_frames;  /* Stop once a snapshot shows this many */
+  uint32_t snapshots;
+  uint32_t torn;
+};
+
+/* Every snapshot must hold the stats and histograms of one publish */
+static void *snapshotReaderThread(void *arg) {
+  snapshotReader *reader = (snapshotReader*)arg;
+  ahdlc_decoder_snapshot_t snap;
+
+  do {
+    AhdlcDecoderSnapshot(reader->dec, &snap);
+    uint32_t buckets = 0;
+    for (uint32_t i = 0; i < AHDLC_HISTOGRAM_BUCKETS; ++i) {
+      buckets += snap.latency.bucket[i];
+    }
+    if (snap.latency.count != snap.stats.good_frame_cnt ||
+        snap.cycles.count != snap.latency.count ||
+        buckets != snap.latency.count ||
+        snap.cycles.sum != 2 * snap.latency.sum) {
+      ++reader->torn;
+    }
+    ++reader->snapshots;
+    sched_yield();
+  } while (snap.stats.good_frame_cnt < reader->good_frames);
+  return NULL;
+}
+#endif
+
+TEST_F(FrameTest, InstrumentationTest) {
+  ahdlc_frame_encoder_t enc;
+  ahdlc_frame_decoder_t dec;
+  uint8_t frame_buffer[2 * 200 + 20];
+  uint8_t payload[200];
+  vector<vector<uint8_t> > frames;
+  const uint32_t num_frames = 500;
+  uint64_t payload_bytes = 0;
+
+  enc.frame_buffer = frame_buffer;
+  enc.buffer_len = sizeof(frame_buffer);
+  ASSERT_EQ(AHDLC_OK, ahdlcEncoderInit(&enc, CRC16));
+#ifdef AHDLC_INSTRUMENTATION
+  AhdlcEncoderSetClock(&enc, testClock, testCycles, NULL);
+#endif
+  for (uint32_t i = 0; i < num_frames; ++i) {
+    uint32_t len = 1 + random() % sizeof(payload);
+    fillWithEscapes(payload, len, random() % 50);
+    test_clock_now = 100 * i;
+    ASSERT_EQ(AHDLC_OK, EncodeNewFrame(&enc));
+    test_clock_now += len;
+    payload_bytes += len;
+    ASSERT_EQ(AHDLC_OK, EncodeBuffer(&enc, payload, len));
+    frames.push_back(vector<uint8_t>(
+        frame_buffer, frame_buffer + enc.frame_info.buffer_index));
+  }
+
+  dec.pdu_buffer = (uint8_t*)malloc(sizeof(payload) + 2);
+  dec.buffer_len = sizeof(payload) + 2;
+  ASSERT_EQ(AHDLC_OK, AhdlcDecoderInit(&dec, CRC16, NULL));
+#ifdef AHDLC_INSTRUMENTATION
+  ahdlc_encoder_snapshot_t enc_snap;
+  AhdlcEncoderSnapshot(&enc, &enc_snap);
+  EXPECT_EQ(num_frames, enc_snap.latency.count);
+  EXPECT_EQ(payload_bytes, enc_snap.latency.sum);
+  EXPECT_GT(enc_snap.stats.crc_calc_callback_count, num_frames);
+  EXPECT_EQ(2 * enc_snap.latency.sum, enc_snap.cycles.sum);
+  EXPECT_GE(sizeof(payload), enc_snap.latency.max);
+
+  EXPECT_EQ(0u, AhdlcHistogramBucket(0));
+  EXPECT_EQ(1u, AhdlcHistogramBucket(1));
+  EXPECT_EQ(2u, AhdlcHistogramBucket(3));
+  EXPECT_EQ(3u, AhdlcHistogramBucket(4));
+  EXPECT_EQ(AHDLC_HISTOGRAM_BUCKETS - 1u, AhdlcHistogramBucket(~0ull));
+
+  snapshotReader reader = {&dec, num_frames - 1, 0, 0};
+  pthread_t thread;
+  AhdlcDecoderSetClock(&dec, testClock, testCycles, NULL);
+  ASSERT_EQ(0, pthread_create(&thread, NULL, snapshotReaderThread, &reader));
+#endif
+
+  /* Frame 5 is lost, the next one is out of sequence */
+  uint64_t expected_latency = 0;
+  uint32_t good = 0;
+  for (uint32_t i = 0; i < num_frames; ++i) {
+    if (i == 5) {
+      continue;
+    }
+    for (uint32_t b = 0; b < frames[i].size(); ++b) {
+      test_clock_now = 10 * b;
+      if (DecodeFrameByte(&dec, frames[i][b]) == AHDLC_COMPLETE) {
+        ++good;
+      }
+    }
+    /* Timed from the byte after the opening marker to the closing one */
+    expected_latency += 10 * (frames[i].size() - 2);
+    if (i % 50 == 0) {
+      sched_yield();
+    }
+  }
+  EXPECT_EQ(num_frames - 1, good);
+  EXPECT_EQ(1u, dec.stats.out_of_sequence_cnt);
+  EXPECT_EQ((uint8_t)num_frames, dec.stats.expected_sequence_number);
+
+#ifdef AHDLC_INSTRUMENTATION
+  pthread_join(thread, NULL);
+  EXPECT_GT(reader.snapshots, 0u);
+  EXPECT_EQ(0u, reader.torn);
+
+  ahdlc_decoder_snapshot_t snap;
+  AhdlcDecoderSnapshot(&dec, &snap);
+  EXPECT_EQ(0, memcmp(&dec.stats, &snap.stats, sizeof(snap.stats)));
+  EXPECT_EQ(good, snap.latency.count);
+  EXPECT_EQ(expected_latency, snap.latency.sum);
+  EXPECT_EQ(2 * expected_latency, snap.cycles.sum);
+  EXPECT_GT(dec.stats.crc_calc_callback_cnt, 0u);
+#else
+  (void)expected_latency;
+  (void)payload_bytes;
+#endif
+  free(dec.pdu_buffer);
+}
+
+TEST_F(FrameTest, HuntResyncTest) {
+  ahdlc_frame_encoder_t enc;
+  uint8_t frame_buffer[100];
+  uint8_t payload[40];
+  vector<uint8_t> stream;
+  const uint32_t num_frames = 100;
+  const uint32_t garbage_len = 37;
+  uint32_t expected_discard = 0;
+  uint32_t corrupted = 0;
+
+  enc.frame_buffer = frame_buffer;
+  enc.buffer_len = sizeof(frame_buffer);
+  ASSERT_EQ(AHDLC_OK, ahdlcEncoderInit(&enc, CRC16));
+  for (uint32_t i = 0; i < num_frames; ++i) {
+    for (uint32_t b = 0; b < sizeof(payload); ++b) {
+      payload[b] = (uint8_t)('a' + (i + b) % 26);
+    }
+    ASSERT_EQ(AHDLC_OK, EncodeNewFrame(&enc));
+    ASSERT_EQ(AHDLC_OK, EncodeBuffer(&enc, payload, sizeof(payload)));
+    vector<uint8_t> frame(frame_buffer,
+                          frame_buffer + enc.frame_info.buffer_index);
+
+    if (i % 10 == 3) {
+      /* Invalid escape, the rest of the frame up to its marker is dropped */
+      uint32_t bad = 5 + i % 20;
+      frame[bad] = escape_marker;
+      frame[bad + 1] = 0x11;
+      expected_discard += frame.size() - (bad + 3);
+      ++corrupted;
+    }
+    stream.insert(stream.end(), frame.begin(), frame.end());
+
+    if (i % 7 == 6) {
+      /* Line noise, its first byte is an invalid control byte */
+      for (uint32_t b = 0; b < garbage_len; ++b) {
+        stream.push_back((uint8_t)((i + b) % 0x40));
+      }
+      expected_discard += garbage_len - 1;
+    }
+  }
+
+  /* One byte at a time */
+  ahdlc_frame_decoder_t byte_dec;
+  vector<vector<uint8_t> > byte_frames;
+  byte_dec.buffer_len = sizeof(payload) + 2;
+  byte_dec.pdu_buffer = (uint8_t*)malloc(byte_dec.buffer_len);
+  ASSERT_EQ(AHDLC_OK, AhdlcDecoderInit(&byte_dec, CRC16, NULL));
+  for (uint32_t i = 0; i < stream.size(); ++i) {
+    if (DecodeFrameByte(&byte_dec, stream[i]) == AHDLC_COMPLETE) {
+      byte_frames.push_back(vector<uint8_t>(byte_dec.pdu_buffer,
+          byte_dec.pdu_buffer + byte_dec.frame_info.buffer_index));
+    }
+  }
+  EXPECT_EQ(num_frames - corrupted, byte_frames.size());
+  EXPECT_EQ(corrupted, byte_dec.stats.invalid_escape_cnt);
+  EXPECT_EQ(expected_discard, byte_dec.stats.resync_discard_byte_cnt);
+  /* Noise no longer opens frames of its own */
+  EXPECT_EQ(0u, byte_dec.stats.frame_too_small_cnt);
+  EXPECT_EQ(0u, byte_dec.stats.num_decoded_bad_crc);
+
+  /* Bulk, in reads that split frames and noise anywhere */
+  ahdlc_frame_decoder_t bulk_dec;
+  ahdlc_decoded_frame_t frame;
+  vector<vector<uint8_t> > bulk_frames;
+  bulk_dec.buffer_len = byte_dec.buffer_len;
+  bulk_dec.pdu_buffer = (uint8_t*)malloc(bulk_dec.buffer_len);
+  ASSERT_EQ(AHDLC_OK, AhdlcDecoderInit(&bulk_dec, CRC16, NULL));
+  for (uint32_t start = 0; start < stream.size();) {
+    uint32_t len = std::min<uint32_t>(1 + random() % 64,
+                                      stream.size() - start);
+    uint32_t offset = 0;
+    while (DecoderBufferNext(&bulk_dec, &stream[start], len, &offset,
+                             &frame) == AHDLC_COMPLETE) {
+      bulk_frames.push_back(vector<uint8_t>(frame.payload,
+          frame.payload + frame.payload_len));
+    }
+    start += len;
+  }
+  EXPECT_TRUE(byte_frames == bulk_frames);
+  EXPECT_TRUE(sameDecoderStats(byte_dec.stats, bulk_dec.stats));
+
+  /* Noise before the first marker is out of frame, not resync */
+  vector<uint8_t> noisy(garbage_len, 0x11);
+  noisy.insert(noisy.end(), stream.begin(), stream.end());
+  vector<uint8_t> in_place(noisy);
+  vector<ahdlc_decoded_frame_t> decoded(num_frames);
+  ahdlc_frame_decoder_t in_place_dec;
+  uint32_t num_decoded;
+  uint32_t consumed;
+  in_place_dec.buffer_len = 0;
+  in_place_dec.pdu_buffer = in_place.data();
+  ASSERT_EQ(AHDLC_OK, AhdlcDecoderInit(&in_place_dec, CRC16, NULL));
+  ASSERT_EQ(AHDLC_COMPLETE, DecodeInPlace(&in_place_dec, in_place.data(),
+      (uint32_t)in_place.size(), decoded.data(), num_frames, &num_decoded,
+      &consumed));
+  EXPECT_EQ(byte_frames.size(), num_decoded);
+
+  /* The multi-channel decoder counts every skipped byte the same way */
+  vector<uint32_t> storage(AHDLC_MULTI_DECODER_STORAGE_SIZE(2,
+      sizeof(payload)) / sizeof(uint32_t));
+  vector<vector<vector<uint8_t> > > multi_frames(2);
+  ahdlc_multi_decoder_t multi;
+  ASSERT_EQ(AHDLC_OK, AhdlcMultiDecoderInit(&multi, 2, sizeof(payload),
+      storage.data(), storage.size() * 4, CRC16, collectChannelFrame,
+      &multi_frames));
+  for (uint32_t c = 0; c < 2; ++c) {
+    const vector<uint8_t> &input = c ? noisy : stream;
+    for (uint32_t start = 0; start < input.size();) {
+      uint32_t len = std::min<uint32_t>(1 + random() % 64,
+                                        input.size() - start);
+      ahdlc_channel_input_t piece = {c, &input[start], len};
+      EXPECT_NE(AHDLC_ERROR, AhdlcMultiDecode(&multi, &piece, 1));
+      start += len;
+    }
+    EXPECT_TRUE(byte_frames == multi_frames[c]);
+  }
+  const ahdlc_decoder_stats *expected[] = {&byte_dec.stats,
+                                           &in_place_dec.stats};
+  for (uint32_t c = 0; c < 2; ++c) {
+    EXPECT_EQ(c ? garbage_len : 0u, expected[c]->out_of_frame_byte_cnt);
+    EXPECT_EQ(expected_discard, expected[c]->resync_discard_byte_cnt);
+    EXPECT_EQ(expected[c]->out_of_frame_byte_cnt,
+              multi.stats[c].out_of_frame_byte_cnt);
+    EXPECT_EQ(expected[c]->resync_discard_byte_cnt,
+              multi.stats[c].resync_discard_byte_cnt);
+    EXPECT_EQ(corrupted, multi.stats[c].invalid_escape_cnt);
+    EXPECT_EQ(byte_frames.size(), multi.stats[c].good_frame_cnt);
+    EXPECT_EQ(0u, multi.stats[c].frame_too_small_cnt);
+    EXPECT_EQ(0u, multi.stats[c].num_decoded_bad_crc);
+  }
+  EXPECT_TRUE(sameDecoderStats(byte_dec.stats, multi.stats[0]));
+
+  free(byte_dec.pdu_buffer);
+  free(bulk_dec.pdu_buffer);
+}
+
+TEST_F(FrameTest, MultiDecoderStatsTest) {
+  ahdlc_frame_encoder_t enc;
+  uint8_t frame_buffer[200];
+  uint8_t payload[64];
+  const uint32_t max_pdu = 24;
+  vector<uint8_t> stream;
+
+  enc.frame_buffer = frame_buffer;
+  enc.buffer_len = sizeof(frame_buffer);
+  ASSERT_EQ(AHDLC_OK, ahdlcEncoderInit(&enc, CRC16));
+  for (uint32_t i = 0; i < 12; ++i) {
+    /* Every third frame overflows, escapes in its tail included */
+    uint32_t len = (i % 3 == 1) ? sizeof(payload) : max_pdu;
+    for (uint32_t b = 0; b < len; ++b) {
+      payload[b] = (b % 5 == 4) ? frame_marker : (uint8_t)(i + b);
+    }
+    ASSERT_EQ(AHDLC_OK, EncodeNewFrame(&enc));
+    ASSERT_EQ(AHDLC_OK, EncodeBuffer(&enc, payload, len));
+    vector<uint8_t> frame(frame_buffer,
+                          frame_buffer + enc.frame_info.buffer_index);
+    if (i == 7) {
+      /* Invalid escape past the overflow, the tail becomes resync bytes */
+      frame[frame.size() - 6] = escape_marker;
+      frame[frame.size() - 5] = 0x11;
+    }
+    /* Lost frames, the next good one is out of sequence */
+    if (i % 4 != 2) {
+      stream.insert(stream.end(), frame.begin(), frame.end());
+    }
+  }
+  /* An overflowing frame still open at the end of the input */
+  stream.insert(stream.end(), frame_buffer,
+                frame_buffer + enc.frame_info.buffer_index - 1);
+
+  ahdlc_frame_decoder_t dec;
+  dec.buffer_len = max_pdu + crc_size;
+  dec.pdu_buffer = (uint8_t*)malloc(dec.buffer_len);
+  ASSERT_EQ(AHDLC_OK, AhdlcDecoderInit(&dec, CRC16, NULL));
+  for (uint32_t i = 0; i < stream.size(); ++i) {
+    DecodeFrameByte(&dec, stream[i]);
+  }
+  EXPECT_EQ(2u, dec.stats.num_decoded_bad_crc);
+  EXPECT_EQ(1u, dec.stats.invalid_escape_cnt);
+  EXPECT_NE(0u, dec.stats.resync_discard_byte_cnt);
+  EXPECT_EQ(4u, dec.stats.out_of_sequence_cnt);
+
+  vector<uint32_t> storage(AHDLC_MULTI_DECODER_STORAGE_SIZE(1, max_pdu) /
+                           sizeof(uint32_t));
+  vector<vector<vector<uint8_t> > > frames(1);
+  ahdlc_multi_decoder_t multi;
+  ASSERT_EQ(AHDLC_OK, AhdlcMultiDecoderInit(&multi, 1, max_pdu,
+      storage.data(), storage.size() * 4, CRC16, collectChannelFrame,
+      &frames));
+  for (uint32_t start = 0; start < stream.size();) {
+    uint32_t len = std::min<uint32_t>(1 + random() % 16,
+                                      stream.size() - start);
+    ahdlc_channel_input_t piece = {0, &stream[start], len};
+    EXPECT_NE(AHDLC_ERROR, AhdlcMultiDecode(&multi, &piece, 1));
+    start += len;
+  }
+  EXPECT_EQ(dec.stats.good_frame_cnt, frames[0].size());
+  EXPECT_TRUE(sameDecoderStats(dec.stats, multi.stats[0]));
+
+  free(dec.pdu_buffer);
+}
+
+/* Collects payloads, or echoes them when link is set */
+struct LinkPeer {
+  ahdlc_link_t *link;
+  vector<vector<uint8_t> > frames;
+  uint32_t send_failures;
+};
+
+static void linkPeerFrame(void *ctx, const ahdlc_decoded_frame_t *frame) {
+  LinkPeer *peer = static_cast<LinkPeer*>(ctx);
+
+  peer->frames.push_back(vector<uint8_t>(frame->payload,
+      frame->payload + frame->payload_len));
+  if (peer->link && AhdlcLinkSend(peer->link, frame->payload,
+                                  frame->payload_len) != AHDLC_OK) {
+    ++peer->send_failures;
+  }
+}
+
+static vector<uint8_t> linkTestPayload(uint32_t i) {
+  vector<uint8_t> payload(1 + (i * 37) % 120);
+
+  for (uint32_t b = 0; b < payload.size(); ++b) {
+    /* Plenty of frame_marker and escape_marker bytes */
+    payload[b] = (uint8_t)(((i + b) % 5 == 0) ? 0x7e :
+                           ((i + b) % 7 == 0) ? 0x7d : i + b);
+  }
+  return payload;
+}
+
+TEST_F(FrameTest, LinkDriverPtyEchoTest) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  ASSERT_GE(master, 0);
+  ASSERT_EQ(0, grantpt(master));
+  ASSERT_EQ(0, unlockpt(master));
+  int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+  ASSERT_GE(slave, 0);
+  struct termios tio;
+  ASSERT_EQ(0, tcgetattr(slave, &tio));
+  cfmakeraw(&tio);
+  ASSERT_EQ(0, tcsetattr(slave, TCSANOW, &tio));
+
+  vector<uint8_t> a_rx(8192), a_tx(8192), b_rx(8192), b_tx(65536);
+  ahdlc_link_t a, b;
+  LinkPeer a_peer = {NULL, vector<vector<uint8_t> >(), 0};
+  LinkPeer b_peer = {&b, vector<vector<uint8_t> >(), 0};
+  ahdlc_link_config_t config = {CRC16, a_rx.data(), (uint32_t)a_rx.size(),
+      a_tx.data(), (uint32_t)a_tx.size(), linkPeerFrame, &a_peer};
+  ASSERT_EQ(AHDLC_OK, AhdlcLinkInit(&a, master, &config));
+  config.rx_buffer = b_rx.data();
+  config.rx_buffer_len = (uint32_t)b_rx.size();
+  config.tx_buffer = b_tx.data();
+  config.tx_buffer_len = (uint32_t)b_tx.size();
+  config.frame_ctx = &b_peer;
+  ASSERT_EQ(AHDLC_OK, AhdlcLinkInit(&b, slave, &config));
+
+  /* Bursts from a, each echoed by b as it arrives */
+  const uint32_t num_frames = 2000;
+  uint32_t sent = 0;
+  for (uint32_t turn = 0; turn < 100000 &&
+       a_peer.frames.size() < num_frames; ++turn) {
+    while (sent < num_frames && sent - a_peer.frames.size() < 50) {
+      vector<uint8_t> payload = linkTestPayload(sent);
+      ahdlc_op_return status = AhdlcLinkSend(&a, payload.data(),
+                                             (uint32_t)payload.size());
+      if (status == AHDLC_BUFFER_TOO_SMALL) {
+        break;
+      }
+      ASSERT_EQ(AHDLC_OK, status);
+      ++sent;
+    }
+    ASSERT_LE(AHDLC_OK, AhdlcLinkPoll(&b, 1));
+    ASSERT_LE(AHDLC_OK, AhdlcLinkPoll(&a, 1));
+  }
+
+  ASSERT_EQ(num_frames, a_peer.frames.size());
+  for (uint32_t i = 0; i < num_frames; ++i) {
+    EXPECT_TRUE(linkTestPayload(i) == a_peer.frames[i]) << i;
+  }
+  EXPECT_EQ(0u, b_peer.send_failures);
+  EXPECT_EQ(num_frames, b.stats.rx_frames);
+  EXPECT_EQ(num_frames, b.stats.tx_frames);
+  EXPECT_EQ(0u, a.decoder.stats.num_decoded_bad_crc);
+  EXPECT_EQ(0u, b.decoder.stats.num_decoded_bad_crc);
+  /* Reads and writes carry many frames each */
+  EXPECT_GT(b.stats.max_tx_batch, 1u);
+  EXPECT_LT(AhdlcLinkSyscallsPerFrame(&b.stats), 1.0);
+
+  /* The other side going away ends the link */
+  AhdlcLinkClose(&b);
+  close(slave);
+  ahdlc_op_return status = AHDLC_OK;
+  for (uint32_t turn = 0; turn < 100 && status != AHDLC_ERROR; ++turn) {
+    status = AhdlcLinkPoll(&a, 10);
+  }
+  EXPECT_EQ(AHDLC_ERROR, status);
+  AhdlcLinkClose(&a);
+  close(master);
+}
+
+TEST_F(FrameTest, LinkDriverBackpressureTest) {
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  int small = 4096;
+  ASSERT_EQ(0, setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &small,
+                          sizeof(small)));
+
+  /* A small tx ring that wraps all the time */
+  vector<uint8_t> a_rx(512), a_tx(8192), b_rx(2048), b_tx(512);
+  ahdlc_link_t a, b;
+  LinkPeer a_peer = {NULL, vector<vector<uint8_t> >(), 0};
+  LinkPeer b_peer = {NULL, vector<vector<uint8_t> >(), 0};
+  ahdlc_link_config_t config = {CRC16, a_rx.data(), (uint32_t)a_rx.size(),
+      a_tx.data(), (uint32_t)a_tx.size(), linkPeerFrame, &a_peer};
+  ASSERT_EQ(AHDLC_OK, AhdlcLinkInit(&a, fds[0], &config));
+  config.rx_buffer = b_rx.data();
+  config.rx_buffer_len = (uint32_t)b_rx.size();
+  config.tx_buffer = b_tx.data();
+  config.tx_buffer_len = (uint32_t)b_tx.size();
+  config.frame_ctx = &b_peer;
+  ASSERT_EQ(AHDLC_OK, AhdlcLinkInit(&b, fds[1], &config));
+
+  vector<uint8_t> big(a_tx.size() / 2);
+  EXPECT_EQ(AHDLC_ERROR, AhdlcLinkSend(&a, big.data(), (uint32_t)big.size()));
+
+  /* b only reads every few turns, so a fills the socket and waits */
+  const uint32_t num_frames = 3000;
+  uint32_t sent = 0;
+  uint32_t full = 0;
+  for (uint32_t turn = 0; turn < 100000 &&
+       b_peer.frames.size() < num_frames; ++turn) {
+    while (sent < num_frames) {
+      vector<uint8_t> payload = linkTestPayload(sent);
+      ahdlc_op_return status = AhdlcLinkSend(&a, payload.data(),
+                                             (uint32_t)payload.size());
+      if (status == AHDLC_BUFFER_TOO_SMALL) {
+        ++full;
+        break;
+      }
+      ASSERT_EQ(AHDLC_OK, status);
+      ++sent;
+    }
+    ASSERT_LE(AHDLC_OK, AhdlcLinkPoll(&a, 0));
+    if (turn % 4 == 3) {
+      ASSERT_LE(AHDLC_OK, AhdlcLinkPoll(&b, 1));
+    }
+  }
+
+  ASSERT_EQ(num_frames, b_peer.frames.size());
+  for (uint32_t i = 0; i < num_frames; ++i) {
+    EXPECT_TRUE(linkTestPayload(i) == b_peer.frames[i]) << i;
+  }
+  EXPECT_GT(full, 0u);
+  EXPECT_GT(a.stats.epoll_ctl_calls, 0u);
+  EXPECT_EQ(b.stats.rx_bytes, a.stats.tx_bytes);
+  EXPECT_EQ(0u, b.stats.rx_dropped_bytes);
+  EXPECT_EQ(0u, b.decoder.stats.num_decoded_bad_crc);
+
+  AhdlcLinkClose(&a);
+  AhdlcLinkClose(&b);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST_F(FrameTest, LinkDriverOversizedRxTest) {
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+  /* b can never hold the 1000 escaped bytes of the first frame */
+  vector<uint8_t> a_rx(512), a_tx(4096), b_rx(512), b_tx(512);
+  ahdlc_link_t a, b;
+  LinkPeer a_peer = {NULL, vector<vector<uint8_t> >(), 0};
+  LinkPeer b_peer = {NULL, vector<vector<uint8_t> >(), 0};
+  ahdlc_link_config_t config = {CRC16, a_rx.data(), (uint32_t)a_rx.size(),
+      a_tx.data(), (uint32_t)a_tx.size(), linkPeerFrame, &a_peer};
+  ASSERT_EQ(AHDLC_OK, AhdlcLinkInit(&a, fds[0], &config));
+  config.rx_buffer = b_rx.data();
+  config.rx_buffer_len = (uint32_t)b_rx.size();
+  config.tx_buffer = b_tx.data();
+  config.tx_buffer_len = (uint32_t)b_tx.size();
+  config.frame_ctx = &b_peer;
+  ASSERT_EQ(AHDLC_OK, AhdlcLinkInit(&b, fds[1], &config));
+
+  vector<uint8_t> oversized(500, 0x7e);
+  ASSERT_EQ(AHDLC_OK, AhdlcLinkSend(&a, oversized.data(),
+                                    (uint32_t)oversized.size()));
+  for (uint32_t i = 0; i < 10; ++i) {
+    vector<uint8_t> payload = linkTestPayload(i);
+    ASSERT_EQ(AHDLC_OK, AhdlcLinkSend(&a, payload.data(),
+                                      (uint32_t)payload.size()));
+  }
+  ASSERT_EQ(AHDLC_OK, AhdlcLinkFlush(&a));
+
+  for (uint32_t turn = 0; turn < 100 && b_peer.frames.size() < 10; ++turn) {
+    ASSERT_LE(AHDLC_OK, AhdlcLinkPoll(&b, 10));
+  }
+  ASSERT_EQ(10u, b_peer.frames.size());
+  for (uint32_t i = 0; i < 10; ++i) {
+    EXPECT_TRUE(linkTestPayload(i) == b_peer.frames[i]) << i;
+  }
+  EXPECT_EQ(b_rx.size(), b.stats.rx_dropped_bytes);
+  EXPECT_EQ(0u, b.decoder.stats.num_decoded_bad_crc);
+
+  AhdlcLinkClose(&a);
+  AhdlcLinkClose(&b);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST_F(FrameTest, LinkDriverFailedInitTest) {
+  vector<uint8_t> rx(512), tx(512);
+  ahdlc_link_t link;
+  ahdlc_link_config_t config = {CRC16, rx.data(), (uint32_t)rx.size(),
+      tx.data(), (uint32_t)tx.size(), linkPeerFrame, NULL};
+
+  /* fcntl() fails on the bad fd, before any epoll instance exists */
+  EXPECT_EQ(AHDLC_ERROR, AhdlcLinkInit(&link, -1, &config));
+  EXPECT_EQ(-1, link.epoll_fd);
+  AhdlcLinkClose(&link);
+}
+
+/* Sensor records: slow counters and readings, much like telemetry */
+static vector<uint8_t> telemetryPayload(uint32_t frame, uint32_t records) {
+  vector<uint8_t> payload;
+
+  for (uint32_t r = 0; r < records; ++r) {
+    uint32_t t = frame * records + r;
+    uint8_t record[12] = {0xA5, (uint8_t)r, 0, 0,
+                          (uint8_t)t, (uint8_t)(t >> 8), 0, 0,
+                          (uint8_t)(100 + (t % 3)), 0x7e, 0x00, 0x7d};
+    payload.insert(payload.end(), record, record + sizeof(record));
+  }
+  return payload;
+}
+
+TEST_F(FrameTest, LzCompressTest) {
+  vector<uint16_t> table(AHDLC_LZ_TABLE_SIZE / sizeof(uint16_t));
+  vector<vector<uint8_t> > inputs;
+  vector<uint8_t> packed(2 * AHDLC_LZ_MAX_INPUT);
+  vector<uint8_t> out(AHDLC_LZ_MAX_INPUT + 1);
+  uint32_t used;
+
+  for (uint32_t len = 0; len < 20; ++len) {
+    inputs.push_back(vector<uint8_t>(len, 'a'));
+  }
+  inputs.push_back(telemetryPayload(7, 20));
+  /* Literal and match lengths past the 15 of a nibble and 255 of a byte */
+  vector<uint8_t> mixed;
+  for (uint32_t i = 0; i < 600; ++i) {
+    mixed.push_back((uint8_t)random());
+  }
+  mixed.insert(mixed.end(), 700, 'z');
+  mixed.insert(mixed.end(), mixed.begin(), mixed.begin() + 300);
+  inputs.push_back(mixed);
+  vector<uint8_t> largest(AHDLC_LZ_MAX_INPUT);
+  for (uint32_t i = 0; i < largest.size(); ++i) {
+    largest[i] = (uint8_t)((i % 1000 < 500) ? random() : i / 7);
+  }
+  inputs.push_back(largest);
+
+  for (uint32_t i = 0; i < inputs.size(); ++i) {
+    const vector<uint8_t> &in = inputs[i];
+    uint32_t len = AhdlcLzCompress(in.data(), (uint32_t)in.size(),
+        packed.data(), (uint32_t)packed.size(), table.data());
+    ASSERT_GT(len, 0u) << i;
+    ASSERT_EQ(AHDLC_OK, AhdlcLzDecompress(packed.data(), len, out.data(),
+                                          (uint32_t)in.size(), &used)) << i;
+    ASSERT_EQ(in.size(), used) << i;
+    EXPECT_TRUE(std::equal(in.begin(), in.end(), out.begin())) << i;
+    /* One byte less room is not enough */
+    if (used) {
+      EXPECT_EQ(AHDLC_ERROR, AhdlcLzDecompress(packed.data(), len,
+          out.data(), used - 1, &used)) << i;
+    }
+  }
+
+  /* Repetitive data shrinks, noise does not fit in fewer bytes */
+  vector<uint8_t> telemetry = telemetryPayload(3, 40);
+  EXPECT_LT(AhdlcLzCompress(telemetry.data(), (uint32_t)telemetry.size(),
+      packed.data(), (uint32_t)packed.size(), table.data()),
+      telemetry.size() * 3 / 4);
+  vector<uint8_t> noise(1000);
+  for (uint32_t i = 0; i < noise.size(); ++i) {
+    noise[i] = (uint8_t)random();
+  }
+  EXPECT_EQ(0u, AhdlcLzCompress(noise.data(), (uint32_t)noise.size(),
+      packed.data(), (uint32_t)noise.size() - 1, table.data()));
+  EXPECT_EQ(0u, AhdlcLzCompress(packed.data(), AHDLC_LZ_MAX_INPUT + 1,
+      out.data(), (uint32_t)out.size(), table.data()));
+
+  /* Garbage and cut short streams stay inside out */
+  const uint32_t out_len = 256;
+  for (uint32_t trial = 0; trial < 20000; ++trial) {
+    uint32_t len;
+    if (trial & 1) {
+      len = AhdlcLzCompress(telemetry.data(), (uint32_t)telemetry.size(),
+          packed.data(), (uint32_t)packed.size(), table.data());
+      len = (uint32_t)random() % len;
+      packed[random() % (len + 1)] ^= (uint8_t)random();
+    } else {
+      len = (uint32_t)random() % 64;
+      for (uint32_t b = 0; b < len; ++b) {
+        packed[b] = (uint8_t)random();
+      }
+    }
+    std::fill(out.begin(), out.end(), 0xCC);
+    ahdlc_op_return status = AhdlcLzDecompress(packed.data(), len,
+                                               out.data(), out_len, &used);
+    EXPECT_TRUE(status == AHDLC_OK || status == AHDLC_ERROR);
+    EXPECT_LE(used, out_len);
+    EXPECT_EQ(out.end(), std::find_if(out.begin() + out_len, out.end(),
+        [](uint8_t b) { return b != 0xCC; })) << trial;
+  }
+}
+
+TEST_F(FrameTest, CompressedFrameTest) {
+  vector<uint8_t> frame_buffer(4096), plain_buffer(4096);
+  vector<uint16_t> work_words(
+      (AHDLC_LZ_TABLE_SIZE + 2048) / sizeof(uint16_t));
+  uint8_t *work = reinterpret_cast<uint8_t*>(work_words.data());
+  ahdlc_frame_encoder_t enc, plain;
+  vector<vector<uint8_t> > payloads;
+  vector<uint8_t> stream;
+  uint32_t compressed = 0;
+  uint32_t wire = 0;
+  uint32_t plain_wire = 0;
+
+  enc.frame_buffer = frame_buffer.data();
+  enc.buffer_len = (uint32_t)frame_buffer.size();
+  ASSERT_EQ(AHDLC_OK, ahdlcEncoderInit(&enc, CRC16));
+  EXPECT_EQ(AHDLC_ERROR, AhdlcEncoderSetCompression(&enc, work + 1,
+                                                    AHDLC_LZ_TABLE_SIZE));
+  EXPECT_EQ(AHDLC_BUFFER_TOO_SMALL, AhdlcEncoderSetCompression(&enc, work,
+                                                    AHDLC_LZ_TABLE_SIZE));
+  ASSERT_EQ(AHDLC_OK, AhdlcEncoderSetCompression(&enc, work,
+      (uint32_t)(work_words.size() * sizeof(uint16_t))));
+  plain.frame_buffer = plain_buffer.data();
+  plain.buffer_len = (uint32_t)plain_buffer.size();
+  ASSERT_EQ(AHDLC_OK, ahdlcEncoderInit(&plain, CRC16));
+
+  for (uint32_t i = 0; i < 60; ++i) {
+    vector<uint8_t> payload;
+    if (i % 3 == 2) {
+      /* Noise, and payloads too short or too long to compress */
+      payload.resize((i % 4) ? 1 + i * 3 : 2500);
+      for (uint32_t b = 0; b < payload.size(); ++b) {
+        payload[b] = (uint8_t)random();
+      }
+    } else {
+      payload = telemetryPayload(i, 1 + i % 50);
+    }
+    payloads.push_back(payload);
+
+    ASSERT_EQ(AHDLC_OK, EncodeNewFrame(&enc));
+    ASSERT_EQ(AHDLC_OK, EncodeBuffer(&enc, payload.data(),
+                                     (uint32_t)payload.size()));
+    ASSERT_EQ(AHDLC_OK, EncodeNewFrame(&plain));
+    ASSERT_EQ(AHDLC_OK, EncodeBuffer(&plain, payload.data(),
+                                     (uint32_t)payload.size()));
+    uint32_t len = enc.frame_info.buffer_index;
+    uint32_t plain_len = plain.frame_info.buffer_index;
+    frame_control_field_t control;
+    control.value = (frame_buffer[1] == escape_marker) ? frame_buffer[2] ^ 0x20
+                                                       : frame_buffer[1];
+    if (control.bit.frame_is_compressed) {
+      ++compressed;
+      EXPECT_LT(len, plain_len) << i;
+    } else {
+      /* Left alone, byte for byte */
+      ASSERT_EQ(plain_len, len) << i;
+      EXPECT_EQ(0, memcmp(frame_buffer.data(), plain_buffer.data(), len));
+    }
+    /* The flag is per frame, the next one starts clear */
+    EXPECT_FALSE(enc.frame_info.control_bits.bit.frame_is_compressed);
+    if (i % 3 != 2) {
+      wire += len;
+      plain_wire += plain_len;
+    }
+    stream.insert(stream.end(), frame_buffer.begin(),
+                  frame_buffer.begin() + len);
+  }
+  EXPECT_EQ(compressed, enc.stats.compressed_frame_cnt);
+  EXPECT_GE(compressed, 35u);
+  EXPECT_LT(wire, plain_wire * 3 / 4);
+
+  /* Byte path and bulk path both hand back the original payloads */
+  vector<uint8_t> pdu(3000), scratch(3000);
+  ahdlc_frame_decoder_t dec;
+  dec.pdu_buffer = pdu.data();
+  dec.buffer_len = (uint32_t)pdu.size();
+  ASSERT_EQ(AHDLC_OK, AhdlcDecoderInit(&dec, CRC16, NULL));
+  ASSERT_EQ(AHDLC_OK, AhdlcDecoderSetCompression(&dec, scratch.data(),
+                                                 (uint32_t)scratch.size()));
+  uint32_t decoded = 0;
+  for (uint32_t i = 0; i < stream.size(); ++i) {
+    if (DecodeFrameByte(&dec, stream[i]) == AHDLC_COMPLETE) {
+      ASSERT_LT(decoded, payloads.size());
+      ASSERT_EQ(payloads[decoded].size(), dec.frame_info.buffer_index);
+      EXPECT_EQ(0, memcmp(payloads[decoded].data(), dec.pdu_buffer,
+                          dec.frame_info.buffer_index)) << decoded;
+      ++decoded;
+    }
+  }
+  EXPECT_EQ(payloads.size(), decoded);
+  EXPECT_EQ(0u, dec.stats.out_of_sequence_cnt);
+
+  ASSERT_EQ(AHDLC_OK, AhdlcDecoderInit(&dec, CRC16, NULL));
+  ASSERT_EQ(AHDLC_OK, AhdlcDecoderSetCompression(&dec, scratch.data(),
+                                                 (uint32_t)scratch.size()));
+  ASSERT_EQ(AHDLC_OK, AhdlcDecoderSetCrcMode(&dec, DECODE_CRC_PER_FRAME));
+  ahdlc_decoded_frame_t frame;
+  uint32_t offset = 0;
+  decoded = 0;
+  while (DecoderBufferNext(&dec, stream.data(), (uint32_t)stream.size(),
+                           &offset, &frame) == AHDLC_COMPLETE) {
+    ASSERT_LT(decoded, payloads.size());
+    ASSERT_EQ(payloads[decoded].size(), frame.payload_len);
+    EXPECT_EQ(0, memcmp(payloads[decoded].data(), frame.payload,
+                        frame.payload_len)) << decoded;
+    ++decoded;
+  }
+  EXPECT_EQ(payloads.size(), decoded);
+
+  /* Without scratch, and in place, compressed frames are turned away */
+  ASSERT_EQ(AHDLC_OK, AhdlcDecoderInit(&dec, CRC16, NULL));
+  offset = 0;
+  decoded = 0;
+  while (DecoderBufferNext(&dec, stream.data(), (uint32_t)stream.size(),
+                           &offset, &frame) == AHDLC_COMPLETE) {
+    EXPECT_FALSE(frame.control_bits.bit.frame_is_compressed);
+    ++decoded;
+  }
+  EXPECT_EQ(payloads.size() - compressed, decoded);
+
+  ASSERT_EQ(AHDLC_OK, AhdlcDecoderSetCompression(&dec, scratch.data(),
+                                                 (uint32_t)scratch.size()));
+  vector<uint8_t> in_place(stream);
+  vector<ahdlc_decoded_frame_t> frames(payloads.size());
+  uint32_t num_frames, consumed;
+  DecodeInPlace(&dec, in_place.data(), (uint32_t)in_place.size(),
+                frames.data(), (uint32_t)frames.size(), &num_frames,
+                &consumed);
+  EXPECT_EQ(payloads.size() - compressed, num_frames);
+  EXPECT_EQ(scratch.data(), dec.lz_scratch);
+
+  /* Scratch too small to hold the compressed payload */
+  ASSERT_EQ(AHDLC_OK, AhdlcDecoderInit(&dec, CRC16, NULL));
+  ASSERT_EQ(AHDLC_OK, AhdlcDecoderSetCompression(&dec, scratch.data(), 8));
+  for (uint32_t i = 0; i < stream.size(); ++i) {
+    DecodeFrameByte(&dec, stream[i]);
+  }
+  EXPECT_EQ(compressed, dec.stats.decompress_error_cnt);
+  EXPECT_EQ(payloads.size() - compressed, dec.stats.good_frame_cnt);
+
+  /* Compressed, then encrypted */
+  ASSERT_EQ(AHDLC_OK, AhdlcEncoderSetCipher(&enc, stubCipher, 1));
+  enc.frame_info.control_bits.bit.frame_is_encrypted = AHDLC_TRUE;
+  ASSERT_EQ(AHDLC_OK, AhdlcDecoderInit(&dec, CRC16, NULL));
+  ASSERT_EQ(AHDLC_OK, AhdlcDecoderSetCipher(&dec, stubCipher));
+  ASSERT_EQ(AHDLC_OK, AhdlcDecoderSetCompression(&dec, scratch.data(),
+                                                 (uint32_t)scratch.size()));
+  vector<uint8_t> payload = telemetryPayload(1, 30);
+  ASSERT_EQ(AHDLC_OK, EncodeNewFrame(&enc));
+  ASSERT_EQ(AHDLC_OK, EncodeBuffer(&enc, payload.data(),
+                                   (uint32_t)payload.size()));
+  offset = 0;
+  ASSERT_EQ(AHDLC_COMPLETE, DecoderBufferNext(&dec, frame_buffer.data(),
+      enc.frame_info.buffer_index, &offset, &frame));
+  EXPECT_TRUE(frame.control_bits.bit.frame_is_encrypted);
+  EXPECT_TRUE(frame.control_bits.bit.frame_is_compressed);
+  ASSERT_EQ(payload.size(), frame.payload_len);
+  EXPECT_EQ(0, memcmp(payload.data(), frame.payload, frame.payload_len));
+}
+
 TEST_F(FrameTest, DecodeRandomDataTest1Gig) {
   double good_frames = decoder_handle.stats.good_frame_cnt;
 